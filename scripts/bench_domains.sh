@@ -0,0 +1,42 @@
+#!/bin/bash
+
+# Compare two domains on every program under a directory: agreement of the
+# results, total analysis time and peak memory.
+#
+# Usage:
+#    scripts/bench_domains.sh ebpf-samples [zoneCrab] [zoneDense] | tee bench.csv
+
+dir=${1:-ebpf-samples}
+base=${2:-zoneCrab}
+other=${3:-zoneDense}
+test -d $dir || (echo "first argument should be a directory"; exit 1)
+
+with_timeout() {
+    if hash gtimeout 2>/dev/null; then gtimeout "$@"; else timeout "$@"; fi
+}
+
+files=($(find ${dir} -name '*.o' -exec ls -Sd {} + ))
+
+rows=$(mktemp)
+echo file,section,${base}?,${base}_sec,${base}_kb,${other}?,${other}_sec,${other}_kb
+for f in "${files[@]}"
+do
+	for s in $(./check $f -l)
+	do
+		a=$(with_timeout 10m ./check $f $s --domain=$base 2>/dev/null)
+		b=$(with_timeout 10m ./check $f $s --domain=$other 2>/dev/null)
+		echo $f,$s,${a:=0,-1,-1},${b:=0,-1,-1}
+	done
+done | tee $rows
+
+# summary on stderr, so that stdout stays a csv file
+awk -F, -v base=$base -v other=$other '
+	{ n++; ta += $4; tb += $7; if ($5 > ma) ma = $5; if ($8 > mb) mb = $8 }
+	$3 != $6 { diff++; print "differ: " $1 " " $2 }
+	END {
+		printf "programs=%d differ=%d\n", n, diff
+		printf "%s: %.3f sec, max %d kb\n", base, ta, ma
+		printf "%s: %.3f sec, max %d kb\n", other, tb, mb
+		if (tb > 0) printf "speedup=%.2f\n", ta / tb
+	}' $rows 1>&2
+rm -f $rows
@@ -2,7 +2,6 @@
 #include <assert.h>
 
 #include <vector>
-#include <list>
 #include <string>
 #include <algorithm>
 #include <map>
@@ -12,6 +11,10 @@
 #include <optional>
 #include <bitset>
 #include <functional>
+#include <set>
+#include <memory>
+#include <ctime>
+#include <tuple>
 
 #include "config.hpp"
 #include "asm_syntax.hpp"
@@ -23,6 +26,8 @@
 #include "ai_dom_set.hpp"
 #include "ai_dom_rcp.hpp"
 #include "ai_dom_mem.hpp"
+#include "redundant_assertions.hpp"
+#include "wto.hpp"
 
 using std::optional;
 using std::to_string;
@@ -39,12 +44,20 @@ bool operator==(const Assert& a, const Assert& b) { return *a.p == *b.p && a.sat
 constexpr Reg DATA_END_REG = Reg{13};
 constexpr Reg META_REG = Reg{14};
 
+/** Registers hold shared values: copying the state copies pointers, and a
+ *  value is only copied when it is updated while shared. Joins keep the
+ *  pointer of an operand when the result equals it, so the registers that
+ *  did not change stay shared across blocks and compare by pointer.
+ */
 struct RegsDom {
     using ValDom = RCP_domain;
-    std::array<std::optional<ValDom>, 16> regs;
+    using Ptr = std::shared_ptr<ValDom>;
+    // null if uninitialized
+    std::array<Ptr, 16> regs;
 
     RegsDom() {
-        for (auto& r : regs) r = ValDom{};
+        static const Ptr bot = std::make_shared<ValDom>();
+        for (auto& r : regs) r = bot;
     }
 
     friend std::ostream& operator<<(std::ostream& os, const RegsDom& d) {
@@ -61,13 +74,13 @@ struct RegsDom {
 
     void init(const ValDom& ctx, const ValDom& stack_end, const ValDom& top_num) {
         for (auto& r : regs) r = {};
-        regs[1] = ctx;
-        regs[10] = stack_end;
+        regs[1] = std::make_shared<ValDom>(ctx);
+        regs[10] = std::make_shared<ValDom>(stack_end);
 
         // initialized to num to be consistent with other bound checks that assume num
         // (therefore region->zero is added before checking assertion)
-        regs[13] = top_num;
-        regs[14] = top_num;
+        regs[13] = std::make_shared<ValDom>(top_num);
+        regs[14] = regs[13];
     }
 
     bool is_bot() const {
@@ -78,21 +91,36 @@ struct RegsDom {
         return false;
     }
 
-    void operator|=(const RegsDom& o) {
+    // Set r to v, sharing the value of r or of other if it is equal
+    static void share(Ptr& r, ValDom&& v, const Ptr& other) {
+        if (v == *r) return;
+        if (v == *other) r = other;
+        else r = std::make_shared<ValDom>(std::move(v));
+    }
+
+    template <typename F>
+    void combine(const RegsDom& o, const F& f) {
         for (size_t i=0; i < regs.size(); i++) {
-            if (!regs[i] || !o.regs[i])
+            if (!regs[i] || !o.regs[i]) {
                 regs[i] = {};
-            else
-                *regs[i] |= *o.regs[i];
+            } else if (regs[i] != o.regs[i]) {
+                ValDom v = *regs[i];
+                f(v, *o.regs[i]);
+                share(regs[i], std::move(v), o.regs[i]);
+            }
         }
     }
 
+    void operator|=(const RegsDom& o) {
+        combine(o, [](ValDom& a, const ValDom& b) { a |= b; });
+    }
+
     void operator&=(const RegsDom& o) {
-        for (size_t i=0; i < regs.size(); i++)
-            if (!regs[i] || !o.regs[i])
-                regs[i] = {};
-            else
-                *regs[i] &= *o.regs[i];
+        combine(o, [](ValDom& a, const ValDom& b) { a &= b; });
+    }
+
+    void widen(const RegsDom& o) {
+        combine(o, [](ValDom& a, const ValDom& b) { a.widen(b); });
     }
 
     void scratch_regs() {
@@ -101,11 +129,19 @@ struct RegsDom {
     }
 
     void assign(Reg r, const ValDom& v) {
-        regs[r.v] = v;
+        regs[r.v] = std::make_shared<ValDom>(v);
+    }
+
+    const ValDom& at(Reg r) const {
+        if (!regs[r.v]) throw std::runtime_error{std::string("Uninitialized register r") + std::to_string(r.v)};
+        return *regs[r.v];
     }
 
-    ValDom& at(Reg r) {
+    /** The value of r, for updating in place. */
+    ValDom& update(Reg r) {
         if (!regs[r.v]) throw std::runtime_error{std::string("Uninitialized register r") + std::to_string(r.v)};
+        if (regs[r.v].use_count() > 1)
+            regs[r.v] = std::make_shared<ValDom>(*regs[r.v]);
         return *regs[r.v];
     }
 
@@ -113,17 +149,24 @@ struct RegsDom {
         regs[r.v] = {};
     }
 
-    bool operator==(const RegsDom& o) const { return regs == o.regs; }
+    bool operator==(const RegsDom& o) const {
+        for (size_t i=0; i < regs.size(); i++) {
+            if (regs[i] == o.regs[i]) continue;
+            if (!regs[i] || !o.regs[i] || !(*regs[i] == *o.regs[i])) return false;
+        }
+        return true;
+    }
 };
 
 struct Machine {
     RegsDom regs;
     MemDom stack_arr;
 
-    program_info info;
+    // shared by all the states of an analysis
+    std::shared_ptr<const program_info> info;
     RCP_domain BOT;
 
-    Machine(program_info info) : info{info} {
+    Machine(std::shared_ptr<const program_info> info) : info{std::move(info)} {
     }
 
     static inline const RCP_domain numtop = RCP_domain{}.with_num(TOP);
@@ -164,8 +207,13 @@ struct Machine {
         stack_arr &= o.stack_arr;
     }
 
-    bool operator==(Machine o) const { return regs == o.regs && stack_arr == o.stack_arr; }
-    bool operator!=(Machine o) const { return !(*this == o); }
+    void widen(const Machine& o) {
+        regs.widen(o.regs);
+        stack_arr.widen(o.stack_arr);
+    }
+
+    bool operator==(const Machine& o) const { return regs == o.regs && stack_arr == o.stack_arr; }
+    bool operator!=(const Machine& o) const { return !(*this == o); }
 
     void operator()(Undefined const& a) { assert(false); }
 
@@ -177,16 +225,16 @@ struct Machine {
     void operator()(Bin const& a) { 
         switch (a.op) {
             case Bin::Op::MOV: regs.assign(a.dst, eval(a.v)); return;
-            case Bin::Op::ADD: regs.at(a.dst) += eval(a.v); return;
-            case Bin::Op::SUB: regs.at(a.dst) -= eval(a.v); return;
-            default: regs.at(a.dst).exec(a.op, eval(a.v)); return;
+            case Bin::Op::ADD: regs.update(a.dst) += eval(a.v); return;
+            case Bin::Op::SUB: regs.update(a.dst) -= eval(a.v); return;
+            default: regs.update(a.dst).exec(a.op, eval(a.v)); return;
         }
         assert(false);
         return;
     }
 
     void operator()(Assume const& a) {
-        RCP_domain::assume(regs.at(a.cond.left), a.cond.op, eval(a.cond.right));
+        RCP_domain::assume(regs.update(a.cond.left), a.cond.op, eval(a.cond.right));
     }
 
     void operator()(Assert const& a) {
@@ -196,10 +244,10 @@ struct Machine {
                 assert((lc.when_types & TypeSet::num).none()
                     || (lc.when_types & TypeSet::ptr).none());
                 const RCP_domain right = regs.at(lc.reg).zero() + (eval(lc.v) - eval(lc.width) - eval(lc.offset));
-                RCP_domain::assume(regs.at(lc.reg), lc.op, right, lc.when_types);
+                RCP_domain::assume(regs.update(lc.reg), lc.op, right, lc.when_types);
             },
             [this](const TypeConstraint& tc) {
-                auto& r = regs.at(tc.then.reg);
+                auto& r = regs.update(tc.then.reg);
                 auto t = tc.then.types;
                 if (tc.given) {
                     RCP_domain::assume(r, t, regs.at(tc.given->reg), tc.given->types);
@@ -260,7 +308,7 @@ struct Machine {
             }
         }
         if (call.returns_map) {
-            regs.assign(Reg{0}, regs.at(Reg{1}).map_lookup_elem(info.map_defs));
+            regs.assign(Reg{0}, regs.at(Reg{1}).map_lookup_elem(info->map_defs));
         } else {
             regs.assign(Reg{0}, numtop);
         }
@@ -305,7 +353,7 @@ struct Machine {
         if (as_ctx.is_bot()) return {};
         RCP_domain r;
         if (as_ctx.is_single()) {
-            auto d = info.descriptor;
+            auto d = info->descriptor;
             auto data_start = BOT.with_packet(3);
             if (d.data > -1 && as_ctx.contains(d.data))
                 r |= data_start;
@@ -356,9 +404,10 @@ struct Analyzer {
     std::unordered_map<Label, Machine> post;
 
     Analyzer(const Cfg& cfg, program_info info)  {
+        auto shared_info = std::make_shared<const program_info>(std::move(info));
         for (auto l : cfg.keys()) {
-            pre.emplace(l, info);
-            post.emplace(l, info);
+            pre.emplace(l, shared_info);
+            post.emplace(l, shared_info);
         }
         pre.at(cfg.keys().front()).init();
     }
@@ -376,41 +425,57 @@ struct Analyzer {
             // }
         }
         bool res = post.at(l) != dom;
-        post.insert_or_assign(l, dom);
+        post.insert_or_assign(l, std::move(dom));
         return res;
     }
 
-    void join(const std::vector<Label>& prevs, Label into) {
+    /** Join the posts of prevs into the pre of `into`, widening if asked.
+     *  Returns whether the pre changed. */
+    bool join(const std::vector<Label>& prevs, Label into, bool widen) {
         Machine new_pre = pre.at(into);
-        // std::cerr << "\n";
-        // std::cerr << into << ":\n";
-        // std::cerr << new_pre << "\n";
         for (Label l : prevs) {
             new_pre |= post.at(l);
-            // std::cerr << new_pre << "\n";
         }
-        // std::cerr << "\n\n";
-        pre.insert_or_assign(into, new_pre);
+        if (widen) {
+            Machine widened = pre.at(into);
+            widened.widen(new_pre);
+            new_pre = std::move(widened);
+        }
+        bool res = pre.at(into) != new_pre;
+        pre.insert_or_assign(into, std::move(new_pre));
+        return res;
     }
 };
 
+// Joins at a loop head before widening
+constexpr unsigned int WIDENING_DELAY = 2;
+
+/** Chaotic iteration in weak topological order: the pending block that
+ *  comes first in the WTO is visited next, so inner loops stabilize before
+ *  the blocks after them. Every cycle goes through a head, where the pre is
+ *  widened after WIDENING_DELAY joins. A block is only recomputed if its pre
+ *  changed since it was last computed.
+ */
 void worklist(const Cfg& cfg, Analyzer& analyzer) {
-    // Only works with DAGs
-    std::list<Label> w{cfg.keys().front()};
-    std::unordered_map<Label, int> count;
-    for (auto l : cfg.keys()) count[l] = 0;
+    const Label& entry = cfg.keys().front();
+    Wto<Label> wto(entry, [&cfg](const Label& l) { return cfg.at(l).nextlist; });
+    auto by_position = [&wto](const Label& a, const Label& b) { return wto.position(a) < wto.position(b); };
+    std::set<Label, decltype(by_position)> w(by_position);
+    std::unordered_map<Label, unsigned int> joins;
+    std::unordered_set<Label> computed;
+    w.insert(entry);
     while (!w.empty()) {
-        Label label = w.front();
-        w.pop_front();
+        Label label = *w.begin();
+        w.erase(w.begin());
         const BasicBlock& bb = cfg.at(label);
-        analyzer.join(bb.prevlist, label);
+        bool widen = wto.is_head(label) && joins[label]++ >= WIDENING_DELAY;
+        bool changed = analyzer.join(bb.prevlist, label, widen);
+        bool first = computed.insert(label).second;
+        if (!changed && !first)
+            continue;
         if (analyzer.recompute(label, bb)) {
-            for (Label next_label : bb.nextlist) {
-                count[next_label]++;
-                if (count[next_label] >= (int)cfg.at(next_label).prevlist.size())
-                    w.push_back(next_label);
-            }
-            w.erase(std::unique(w.begin(), w.end()), w.end());
+            for (Label next_label : bb.nextlist)
+                w.insert(next_label);
         }
     }
 }
@@ -448,13 +513,50 @@ void analyze_rcp(Cfg& cfg, program_info info) {
     }
 }
 
+std::tuple<bool, double> rcp_validate(Cfg& cfg, program_info info) {
+    explicate_assertions(cfg, info);
+
+    clock_t begin = clock();
+    vector<redundant_assertion> redundant;
+    if (global_options.drop_redundant_assertions)
+        redundant = remove_redundant_assertions(cfg);
+    analyze_rcp(cfg, info);
+    clock_t end = clock();
+    double elapsed_secs = double(end - begin) / CLOCKS_PER_SEC;
+
+    // A removed assertion is checked by the one that implies it, so it is
+    // reported as implied by that one and never as a warning of its own
+    std::map<Label, vector<const redundant_assertion*>> implied;
+    for (const redundant_assertion& r : redundant)
+        implied[r.label].push_back(&r);
+
+    int nwarn = 0;
+    for (const Label& l : cfg.keys()) {
+        for (const Instruction& ins : cfg.at(l).insts) {
+            if (!std::holds_alternative<Assert>(ins))
+                continue;
+            const Assert& a = std::get<Assert>(ins);
+            if (global_options.print_all_checks || global_options.print_all_checks_verbose ||
+                (global_options.print_failures && !a.satisfied)) {
+                std::cout << l << ": " << (a.satisfied ? "safe" : "warning") << ": " << ins << "\n";
+            }
+            if (!a.satisfied)
+                nwarn++;
+        }
+        if (global_options.print_all_checks || global_options.print_all_checks_verbose) {
+            for (const redundant_assertion* r : implied[l])
+                std::cout << l << ": implied by " << r->implied_by << ": " << Instruction{r->assertion} << "\n";
+        }
+    }
+    return {nwarn == 0, elapsed_secs};
+}
+
 class AssertionExtractor {
     program_info info;
-    std::vector<size_t> type_indices;
+    std::vector<int> type_indices;
     bool is_priviledged = false;
     
     auto type_of(Reg r, const Types t) {
-        assert(t.size() == TypeSet::all.size());
         return Assertion{TypeConstraint{{r, t}}};
     };
 
@@ -463,13 +565,13 @@ class AssertionExtractor {
         assumptions.push_back(
             Assertion{LinearConstraint{Op::GE, reg, offset, Imm{0}, Imm{0}, t}}
         );
-        for (size_t i : type_indices) {
+        for (int i : type_indices) {
             if (!t[i]) continue;
             Types s = TypeSet::single(i);
             if (s == TypeSet::num) continue;
 
             Value end;
-            if (i < info.map_defs.size()) end = Imm{info.map_defs.at(i).value_size};
+            if (i >= 0) end = Imm{info.map_defs.at(i).value_size};
             else if (s == TypeSet::packet) end = DATA_END_REG;
             else if (s == TypeSet::stack) end = Imm{STACK_SIZE};
             else if (s == TypeSet::ctx) end = Imm{static_cast<uint64_t>(info.descriptor.size)};
@@ -486,11 +588,11 @@ public:
         for (size_t i=0; i < info.map_defs.size(); i++) {
             type_indices.push_back(i);
         }
-        type_indices.push_back(ALL_TYPES + T_CTX);
-        type_indices.push_back(ALL_TYPES + T_STACK);
-        type_indices.push_back(ALL_TYPES + T_DATA);
-        type_indices.push_back(ALL_TYPES + T_NUM);
-        type_indices.push_back(ALL_TYPES + T_FD);
+        type_indices.push_back(T_CTX);
+        type_indices.push_back(T_STACK);
+        type_indices.push_back(T_DATA);
+        type_indices.push_back(T_NUM);
+        type_indices.push_back(T_FD);
     }
 
     template <typename T>
@@ -610,7 +712,7 @@ public:
     };
 
     void same_type(vector<Assertion>& res, Types ts, Reg r1, Reg r2) {
-        for (size_t i : type_indices) {
+        for (int i : type_indices) {
             if (ts[i]) {
                 Types t = TypeSet::single(i);
                 res.push_back( Assertion{TypeConstraint{{r1, t}, {r2, t}} });
@@ -648,13 +750,17 @@ public:
     }
 };
 
+vector<Assertion> assertions_of(const Instruction& ins, const program_info& info) {
+    return std::visit(AssertionExtractor{info}, ins);
+}
+
 void explicate_assertions(Cfg& cfg, program_info info) {
     for (auto const& this_label : cfg.keys()) {
         vector<Instruction>& old_insts = cfg[this_label].insts;
         vector<Instruction> insts;
 
         for (auto ins : old_insts) {
-            for (auto a : std::visit(AssertionExtractor{info}, ins))
+            for (auto a : assertions_of(ins, info))
                 insts.emplace_back(std::make_unique<Assertion>(a));
             insts.push_back(ins);
         }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <tuple>
+
 #include "asm_syntax.hpp"
 #include "spec_assertions.hpp"
 
@@ -8,3 +10,9 @@
  * Removes safe assertions in-place.
  */
 void analyze_rcp(Cfg& cfg, program_info info);
+
+/** Insert the assertions of the program into cfg, then analyze it with RCP.
+ * 
+ * \return A pair (passed, number_of_seconds)
+ */
+std::tuple<bool, double> rcp_validate(Cfg& cfg, program_info info);
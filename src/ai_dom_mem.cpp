@@ -1,6 +1,7 @@
-#include <set>
 #include <vector>
 #include <limits>
+#include <algorithm>
+#include <iterator>
 
 #include "ai_dom_rcp.hpp"
 #include "ai_dom_mem.hpp"
@@ -9,6 +10,14 @@ using std::min;
 using std::max;
 using std::minmax;
 
+using Cell = MemDom::Cell;
+
+// The first cell that ends after offset
+template <typename It>
+static It first_ending_after(It begin, It end, int64_t offset) {
+    return std::upper_bound(begin, end, offset, [](int64_t offset, const Cell& c) { return offset < c.end(); });
+}
+
 RCP_domain MemDom::load(const OffsetDomSet& offset_dom, uint64_t _width) const {
     int64_t width = static_cast<int64_t>(_width);
     if (!offset_dom.is_single()) {
@@ -16,16 +25,19 @@ RCP_domain MemDom::load(const OffsetDomSet& offset_dom, uint64_t _width) const {
     }
     int64_t offset = offset_dom.elems.front();
 
+    const std::vector<Cell>& cells = this->cells();
+    auto it = first_ending_after(cells.begin(), cells.end(), offset);
+    if (it != cells.end() && it->offset == offset && it->width == width) {
+        return it->dom;
+    }
     int64_t min_offset = std::numeric_limits<int64_t>().max();
     int64_t total_width = 0;
     int64_t max_end = 0;
     bool all_must_be_num = true;
-    for (const Cell& cell : cells) {
+    for (; it != cells.end() && it->offset < offset + width; ++it) {
+        const Cell& cell = *it;
         if (!cell.overlapping(offset, width)) continue;
 
-        if (cell.offset == offset && cell.width == width) {
-            return cell.dom;
-        }
         min_offset = min(cell.offset, min_offset);
         total_width += cell.width;
         max_end = max(cell.end(), max_end);
@@ -64,29 +76,45 @@ void MemDom::store(const OffsetDomSet& offset_dom, uint64_t _width, const RCP_do
         havoc();
         return;
     }
+    if (width <= 0) return;
     Cell new_cell{ .offset = offset_dom.elems.front(), .width = width, .dom = value };
-    std::vector<Cell> to_remove;
-    std::vector<Cell> pieces;
-    for (const Cell& cell : cells) {
-        if (cell.end() <= new_cell.offset) continue;
-        if (cell.offset >= new_cell.end()) continue;
-
-        to_remove.push_back(cell);
-
-        RCP_domain content = cell.dom.must_be_num() ? numtop() : RCP_domain(TOP);
-        // If content is TOP, we can remove, unless we want to track initialization
-        if (cell.offset < new_cell.offset) {
-            pieces.push_back(Cell::from_range(cell.offset, new_cell.offset, content));
-        }
-        if (cell.end() > new_cell.end()) {
-            pieces.push_back(Cell::from_range(new_cell.end(), cell.end(), content));
+    std::vector<Cell>& cells = edit_cells();
+    auto first = first_ending_after(cells.begin(), cells.end(), new_cell.offset);
+    auto last = first;
+    while (last != cells.end() && last->offset < new_cell.end())
+        ++last;
+
+    // If content is TOP, we can remove, unless we want to track initialization
+    std::vector<Cell> replacement;
+    if (first != last && first->offset < new_cell.offset)
+        replacement.push_back(Cell::from_range(first->offset, new_cell.offset, first->partial()));
+    replacement.push_back(new_cell);
+    if (first != last && std::prev(last)->end() > new_cell.end())
+        replacement.push_back(Cell::from_range(new_cell.end(), std::prev(last)->end(), std::prev(last)->partial()));
+
+    auto pos = cells.erase(first, last);
+    cells.insert(pos, replacement.begin(), replacement.end());
+}
+
+void MemDom::widen(const MemDom& b) {
+    MemDom joined = *this;
+    joined |= b;
+    if (bot || joined.is_top() || joined == *this) {
+        *this = joined;
+        return;
+    }
+    const std::vector<Cell>& cells = this->cells();
+    for (Cell& c : joined.edit_cells()) {
+        auto old = first_ending_after(cells.begin(), cells.end(), c.offset);
+        if (old == cells.end() || old->offset != c.offset || old->width != c.width) {
+            c.dom = c.partial();
+        } else {
+            RCP_domain dom = old->dom;
+            dom.widen(c.dom);
+            c.dom = dom;
         }
     }
-    assert(pieces.size() <= 2);
-    for (auto p : to_remove) cells.erase(std::remove(cells.begin(), cells.end(), p), cells.end());
-    for (auto p : pieces) cells.push_back(p);
-    cells.push_back(new_cell);
-    std::sort(cells.begin(), cells.end());
+    *this = joined;
 }
 
 void MemDom::operator|=(const MemDom& b) {
@@ -95,37 +123,57 @@ void MemDom::operator|=(const MemDom& b) {
     if (b.bot) return;
     if (is_top()) { return; }
     if (b.is_top()) { havoc(); return; }
-    
-    std::copy(b.cells.begin(), b.cells.end(), std::back_inserter(cells));
-    std::sort(cells.begin(), cells.end());
-    // There's at least one cell
-    std::vector<Cell> new_cells;
-    int to_remove = 0;
-    auto remove = [&](Cell& c) {
-        c.offset = std::numeric_limits<int64_t>().max();
-        c.width = 0;
-        to_remove++;
-    };
-    cells.emplace_back();
-    remove(cells.back());
-    for (auto it = cells.begin(); std::next(it) < cells.end(); ++it) {
-        Cell& current = *it;
-        Cell& after = *std::next(it);
-
-        if (current.end() <= after.offset || current.width == 0) {
-            remove(current);
-            continue;
+    if (_cells == b._cells) return;
+
+    // A byte is only known if both sides know it
+    std::vector<Cell> joined;
+    auto i = cells().begin(), i_end = cells().end();
+    auto j = b.cells().begin(), j_end = b.cells().end();
+    while (i != i_end && j != j_end) {
+        int64_t lb = max(i->offset, j->offset);
+        int64_t ub = min(i->end(), j->end());
+        if (lb < ub) {
+            RCP_domain dom = i->part(lb, ub);
+            dom |= j->part(lb, ub);
+            joined.push_back(Cell::from_range(lb, ub, dom));
         }
-        
-        auto [_, mid1, mid2, right] = Cell::split(current, after);
-        mid1.dom |= mid2.dom;
+        int64_t i_end_offset = i->end();
+        int64_t j_end_offset = j->end();
+        if (i_end_offset <= j_end_offset) ++i;
+        if (j_end_offset <= i_end_offset) ++j;
+    }
+    if (joined != cells())
+        _cells = std::make_shared<std::vector<Cell>>(std::move(joined));
+}
 
-        current = mid1;
+void MemDom::operator&=(const MemDom& o) {
+    if (this == &o) return;
+    if (is_bot() || o.is_bot()) { to_bot(); return; }
+    if (o.is_top()) return;
+    if (is_top()) { *this = o; return; }
+    if (_cells == o._cells) return;
 
-        // right should stay for next iteration
-        after = right;
+    std::vector<Cell> met;
+    auto i = cells().begin(), i_end = cells().end();
+    auto j = o.cells().begin(), j_end = o.cells().end();
+    while (i != i_end || j != j_end) {
+        if (j == j_end || (i != i_end && i->end() <= j->offset)) {
+            met.push_back(*i++);
+        } else if (i == i_end || j->end() <= i->offset) {
+            met.push_back(*j++);
+        } else if (i->offset == j->offset && i->width == j->width) {
+            Cell c = *i++;
+            c.dom &= (j++)->dom;
+            if (c.dom.is_bot()) {
+                to_bot();
+                return;
+            }
+            met.push_back(c);
+        } else {
+            while (j != j_end && j->offset < i->end())
+                ++j;
+            met.push_back(*i++);
+        }
     }
-    std::move(new_cells.begin(), new_cells.end(), std::back_inserter(cells));
-    std::sort(cells.begin(), cells.end());
-    cells.resize(cells.size() - to_remove);
+    _cells = std::make_shared<std::vector<Cell>>(std::move(met));
 }
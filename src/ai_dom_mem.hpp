@@ -2,6 +2,7 @@
 
 #include <set>
 #include <vector>
+#include <memory>
 
 #include "ai_dom_rcp.hpp"
 
@@ -9,6 +10,11 @@ using std::min;
 using std::max;
 using std::minmax;
 
+/** The stack as a map from byte ranges to values. Cells are sorted by offset
+ *  and never overlap, so their ends are sorted too: loads and stores find the
+ *  cells they touch by binary search, and joins and meets walk both maps in
+ *  order.
+ */
 struct MemDom {
     struct Cell {
         int64_t offset;
@@ -25,38 +31,35 @@ struct MemDom {
             return {start, max(int64_t(0), end - start), dom};
         }
 
-        std::tuple<Cell, Cell> split(int64_t upper_start) const {
-            assert(upper_start >= offset);
-            assert(upper_start <= end());
-            RCP_domain partial_dom = dom.must_be_num() ? numtop() : RCP_domain(TOP);
-            Cell lower = Cell::from_range(offset, upper_start, upper_start >= end() ? dom : partial_dom);
-            Cell upper = Cell::from_range(upper_start, end(), offset >= upper_start ? dom : partial_dom);
-            assert(lower.width + upper.width == width);
-            return {lower, upper};
-        }
+        // What is known about a part of the cell
+        RCP_domain partial() const { return dom.must_be_num() ? numtop() : RCP_domain(TOP); }
 
-        static std::tuple<Cell, Cell, Cell, Cell> split(const Cell& a, const Cell& b) {
-            auto [lower_start, higher_start] = minmax(a, b, [](auto& a, auto& b) {
-                                                                    return a.offset < a.offset; });
-            auto [lower_end, higher_end] = minmax(a, b, [](auto& a, auto& b) {
-                                                              return a.end() < b.end(); });
-            auto [left, mid1] = lower_start.split(higher_start.offset);
-            if (&lower_start == &higher_end) {
-                assert(higher_start.end() >= mid1.offset);
-                auto [mid2, right] = mid1.split(higher_start.end());
-                return {left, mid2, higher_start, right};
-            } else {
-                assert(lower_end.end() >= higher_end.offset);
-                auto [mid2, right] = higher_end.split(lower_end.end());
-                return {left, mid1, mid2, right};
-            }
+        // What is known about [lb, ub), which is inside the cell
+        RCP_domain part(int64_t lb, int64_t ub) const {
+            return lb == offset && ub == end() ? dom : partial();
         }
 
         bool operator==(const Cell& o) const { return offset == o.offset && dom == o.dom && width == o.width; }
-        bool operator<(const Cell& o) const { return offset < o.offset; } // TODO: reverse order // TODO: make overlapping equivalent
+        bool operator<(const Cell& o) const { return offset < o.offset; }
     };
     bool bot = true;
-    std::vector<Cell> cells;
+private:
+    // Shared between copies until one of them changes its cells
+    std::shared_ptr<std::vector<Cell>> _cells = empty_cells();
+
+    static const std::shared_ptr<std::vector<Cell>>& empty_cells() {
+        static const auto empty = std::make_shared<std::vector<Cell>>();
+        return empty;
+    }
+
+public:
+    const std::vector<Cell>& cells() const { return *_cells; }
+    /** The cells, for changing in place. */
+    std::vector<Cell>& edit_cells() {
+        if (_cells.use_count() > 1)
+            _cells = std::make_shared<std::vector<Cell>>(*_cells);
+        return *_cells;
+    }
 
     MemDom() { }
     MemDom(const Top& _) { havoc(); }
@@ -73,24 +76,26 @@ struct MemDom {
 
     void operator|=(const MemDom& b);
 
-    void operator&=(const MemDom& o) {
-        if (this == &o) return;
-        if (is_bot() || o.is_bot()) { to_bot(); return; }
-        if (is_top()) { *this = o; return; }
-    }
+    /** Join, widening the contents of the cells that were already there.
+     *  New cells, which come from splitting old ones, lose their contents. */
+    void widen(const MemDom& b);
+
+    /** Keeps the cells of both sides, meeting those on the same range. Of
+     *  two cells that overlap otherwise, only the one of this is kept. */
+    void operator&=(const MemDom& o);
 
     bool is_bot() const { return bot; }
-    bool is_top() const { return !bot && cells.empty(); }
+    bool is_top() const { return !bot && cells().empty(); }
 
-    void havoc() { cells.clear(); bot = false; }
-    void to_bot() { cells.clear(); bot = true; }
+    void havoc() { _cells = empty_cells(); bot = false; }
+    void to_bot() { _cells = empty_cells(); bot = true; }
 
-    bool operator==(const MemDom& o) const { return bot == o.bot && cells == o.cells; }
+    bool operator==(const MemDom& o) const { return bot == o.bot && (_cells == o._cells || cells() == o.cells()); }
 
     friend std::ostream& operator<<(std::ostream& os, const MemDom& d) {
         if (d.bot) return os << "{BOT}";
         os << "{";
-        for (auto cell : d.cells) {
+        for (const auto& cell : d.cells()) {
             os << cell.offset << ":" << (int64_t)cell.width << "->" << cell.dom << ", ";
         }
         os << "}";
@@ -10,9 +10,9 @@
 #include "asm_ostream.hpp"
 
 void RCP_domain::operator+=(const RCP_domain& rhs) {
-    for (size_t t=0; t < maps.size(); t++) {
-        maps[t] = (num + rhs.maps[t]) | (maps[t] + rhs.num);
-    }
+    update_maps(TypeSet::maps, rhs, [&](auto& map, const auto& rhs_map) {
+        map = (num + rhs_map) | (map + rhs.num);
+    });
     ctx = (num + rhs.ctx) | (ctx + rhs.num);
     stack = (num + rhs.stack) | (stack + rhs.num);
     packet = (num + rhs.packet) | (packet + rhs.num);
@@ -28,16 +28,15 @@ void RCP_domain::operator-=(const RCP_domain& rhs) {
         return;
     }
     num.exec(Bin::Op::SUB, rhs.num);
-    for (size_t t=0; t < rhs.maps.size(); t++) {
-        num |= maps[t] - rhs.maps[t];
-    }
+    all_maps(TypeSet::maps, rhs, [&](const auto& map, const auto& rhs_map) {
+        num |= map - rhs_map;
+        return true;
+    });
     num |= ctx - rhs.ctx;
     num |= stack - rhs.stack;
     num |= packet - rhs.packet;
 
-    for (size_t t=0; t < maps.size(); t++) {
-        maps[t] -= rhs.num;
-    }
+    update_maps(TypeSet::maps, rhs, [&](auto& map, const auto&) { map -= rhs.num; });
     packet -= rhs.num;
     stack -= rhs.num;
     ctx -= rhs.num;
@@ -50,7 +49,7 @@ void RCP_domain::assume(RCP_domain& then_reg, Types then_types, const RCP_domain
 }
 
 void RCP_domain::assume(RCP_domain& reg, Types t) {
-    reg.pointwise_if(t.flip(), [](auto& a){ a.to_bot(); });
+    reg.pointwise_if(~t, [](auto& a){ a.to_bot(); });
 }
 
 void RCP_domain::assume(RCP_domain& left, Condition::Op op, const RCP_domain& right, Types where_types) {
@@ -1,24 +1,95 @@
 #pragma once
 
 #include <vector>
-#include <array>
+#include <algorithm>
+#include <utility>
 
 #include "ai_dom_set.hpp"
 
 #include "spec_assertions.hpp"
 #include "spec_type_descriptors.hpp"
 
+/** Only the maps whose offsets differ from other_maps are stored, sorted by
+ *  index, so a value that does not point to a map holds no map offsets and
+ *  the pointwise operations only visit the maps that are listed. Map indices
+ *  are not bounded: the listed maps are those of the program that some
+ *  operation singled out.
+ */
 class RCP_domain {
     using NumDom = NumDomSet;
     using OffsetDom = OffsetDomSet;
 
-    std::array<OffsetDom, NMAPS> maps;
+    std::vector<std::pair<size_t, OffsetDom>> maps;
+    // The offsets of every map that is not in maps
+    OffsetDom other_maps;
     OffsetDom ctx;
     OffsetDom stack;
     OffsetDom packet;
     NumDom num;
     FdSetDom fd;
 
+    MapSet listed_maps() const {
+        MapSet res;
+        for (const auto& [i, _] : maps)
+            res.set(i);
+        return res;
+    }
+
+    const OffsetDom& map(size_t n) const {
+        auto it = std::lower_bound(maps.begin(), maps.end(), n, [](const auto& m, size_t n) { return m.first < n; });
+        return it != maps.end() && it->first == n ? it->second : other_maps;
+    }
+
+    OffsetDom& map_ref(size_t n) {
+        auto it = std::lower_bound(maps.begin(), maps.end(), n, [](const auto& m, size_t n) { return m.first < n; });
+        if (it == maps.end() || it->first != n)
+            it = maps.insert(it, {n, other_maps});
+        return it->second;
+    }
+
+    // Drop the maps that are back to other_maps
+    void compact() {
+        maps.erase(std::remove_if(maps.begin(), maps.end(), [this](const auto& m) { return m.second == other_maps; }),
+                   maps.end());
+    }
+
+    /** p on the offsets of each map in t and those of the same map in o,
+     *  until it fails. The maps that neither side lists are checked once. */
+    template <typename P>
+    bool all_maps(Types t, const RCP_domain& o, const P& p) const {
+        const MapSet& in_t = t.maps();
+        MapSet listed = listed_maps() | o.listed_maps();
+        for (size_t i : (listed & in_t).elements()) {
+            if (!p(map(i), o.map(i))) return false;
+        }
+        if ((in_t & ~listed).any() && !p(other_maps, o.other_maps)) return false;
+        return true;
+    }
+
+    /** f on the offsets of each map in t and those of the same map in o.
+     *  The maps that neither side lists are updated at once through
+     *  other_maps, after listing those of them that t does not have; if t
+     *  has only finitely many of them, these are listed and updated instead. */
+    template <typename F>
+    void update_maps(Types t, const RCP_domain& o, const F& f) {
+        const MapSet& in_t = t.maps();
+        MapSet listed = listed_maps() | o.listed_maps();
+        MapSet others = ~listed;
+        bool update_others = !(others & in_t).is_finite();
+        if (update_others) {
+            // finite, as in_t is not
+            for (size_t i : (others & ~in_t).elements())
+                map_ref(i);
+        } else {
+            listed |= others & in_t;
+        }
+        for (size_t i : (listed & in_t).elements())
+            f(map_ref(i), o.map(i));
+        if (update_others)
+            f(other_maps, o.other_maps);
+        compact();
+    }
+
     template <typename F>
     void pointwise(const RCP_domain& o, const F& f) {
         pointwise_if(TypeSet::all, o, f);
@@ -31,27 +102,24 @@ class RCP_domain {
 
     template <typename P>
     bool pointwise_all(Types t, const P& p) const {
-        for (size_t i=0; i < maps.size(); i++) {
-            if (t[i] && !p(maps[i])) return false;
-        }
-        if (t[t.size() + T_CTX]) if (!p(ctx)) return false;
-        if (t[t.size() + T_STACK]) if (!p(stack)) return false;
-        if (t[t.size() + T_DATA]) if (!p(packet)) return false;
-        if (t[t.size() + T_NUM]) if (!p(num)) return false;
-        if (t[t.size() + T_FD]) if (!p(fd)) return false;
+        static const RCP_domain none;
+        if (!all_maps(t, none, [&p](const auto& a, const auto&) { return p(a); })) return false;
+        if (t[T_CTX]) if (!p(ctx)) return false;
+        if (t[T_STACK]) if (!p(stack)) return false;
+        if (t[T_DATA]) if (!p(packet)) return false;
+        if (t[T_NUM]) if (!p(num)) return false;
+        if (t[T_FD]) if (!p(fd)) return false;
         return true;
     }
 
     template <typename P>
     bool pointwise_all_pairs(Types t, const RCP_domain& o, const P& p) const {
-        for (size_t i=0; i < maps.size(); i++) {
-            if (t[i] && !p(maps[i], o.maps[i])) return false;
-        }
-        if (t[t.size() + T_CTX]) if (!p(ctx, o.ctx)) return false;
-        if (t[t.size() + T_STACK]) if (!p(stack, o.stack)) return false;
-        if (t[t.size() + T_DATA]) if (!p(packet, o.packet)) return false;
-        if (t[t.size() + T_NUM]) if (!p(num, o.num)) return false;
-        if (t[t.size() + T_FD]) if (!p(fd, o.fd)) return false;
+        if (!all_maps(t, o, p)) return false;
+        if (t[T_CTX]) if (!p(ctx, o.ctx)) return false;
+        if (t[T_STACK]) if (!p(stack, o.stack)) return false;
+        if (t[T_DATA]) if (!p(packet, o.packet)) return false;
+        if (t[T_NUM]) if (!p(num, o.num)) return false;
+        if (t[T_FD]) if (!p(fd, o.fd)) return false;
         return true;
     }
 
@@ -62,33 +130,28 @@ class RCP_domain {
 
     template <typename F>
     void pointwise_if(Types t, const RCP_domain& o, const F& f) {
-        for (size_t i=0; i < maps.size(); i++) {
-            if (t[i])
-                f(maps[i], o.maps[i]);
-        }
-        if (t[t.size() + T_CTX]) f(ctx, o.ctx);
-        if (t[t.size() + T_STACK]) f(stack, o.stack);
-        if (t[t.size() + T_DATA]) f(packet, o.packet);
-        if (t[t.size() + T_NUM]) f(num, o.num);
-        if (t[t.size() + T_FD]) f(fd, o.fd);
+        update_maps(t, o, f);
+        if (t[T_CTX]) f(ctx, o.ctx);
+        if (t[T_STACK]) f(stack, o.stack);
+        if (t[T_DATA]) f(packet, o.packet);
+        if (t[T_NUM]) f(num, o.num);
+        if (t[T_FD]) f(fd, o.fd);
     }
 
     template <typename F>
     void pointwise_if(Types t, const F& f) {
-        for (size_t i=0; i < maps.size(); i++) {
-            if (t[i])
-                f(maps[i]);
-        }
-        if (t[t.size() + T_CTX]) f(ctx);
-        if (t[t.size() + T_STACK]) f(stack);
-        if (t[t.size() + T_DATA]) f(packet);
-        if (t[t.size() + T_NUM]) f(num);
-        if (t[t.size() + T_FD]) f(fd);
+        static const RCP_domain none;
+        update_maps(t, none, [&f](auto& a, const auto&) { f(a); });
+        if (t[T_CTX]) f(ctx);
+        if (t[T_STACK]) f(stack);
+        if (t[T_DATA]) f(packet);
+        if (t[T_NUM]) f(num);
+        if (t[T_FD]) f(fd);
     }
 
 public:
-    RCP_domain with_map(size_t n, const OffsetDom& map) const { auto res = *this; res.maps[n] = map; return res; }
-    RCP_domain with_maps(const OffsetDom& map) const { auto res = *this; for (auto& m : res.maps) m = map; return res; }
+    RCP_domain with_map(size_t n, const OffsetDom& map) const { auto res = *this; res.map_ref(n) = map; res.compact(); return res; }
+    RCP_domain with_maps(const OffsetDom& map) const { auto res = *this; res.maps.clear(); res.other_maps = map; return res; }
     RCP_domain with_ctx(const OffsetDom& ctx) const { auto res = *this; res.ctx = ctx; return res; }
     RCP_domain with_stack(const OffsetDom& stack) const { auto res = *this; res.stack = stack; return res; }
     RCP_domain with_packet(const OffsetDom& packet) const { auto res = *this; res.packet = packet; return res; }
@@ -99,8 +162,9 @@ public:
     
     Types get_types() const {
         Types res;
-        for (size_t i=0; i < maps.size(); i++) {
-            if (!maps[i].is_bot()) res |= TypeSet::single(i);
+        if (!other_maps.is_bot()) res = Types{~listed_maps()};
+        for (const auto& [i, offsets] : maps) {
+            if (!offsets.is_bot()) res.set(i);
         }
         if (!ctx.is_bot()) res |= TypeSet::ctx;
         if (!stack.is_bot()) res |= TypeSet::stack;
@@ -112,7 +176,6 @@ public:
 
     void set_mapfd(int mapfd) {
         assert(mapfd >= 0);
-        assert(mapfd < (int)fd.fds.size());
         fd.assign(mapfd);
     }
 
@@ -143,7 +206,7 @@ public:
         return !packet.is_bot();
     }
     bool maybe_map() const {
-        return std::any_of(maps.cbegin(), maps.cend(), [](const auto& m) { return !m.is_bot(); });
+        return !is_of_type(~TypeSet::maps);
     }
     NumDom get_num() const {
         return num;
@@ -162,9 +225,7 @@ public:
     RCP_domain() {
         // starts as bot
     }
-    RCP_domain(const Top& _) : ctx{TOP}, stack{TOP}, packet{TOP}, num{TOP}, fd{TOP}  {
-        for (auto& v : maps) v.havoc();
-    }
+    RCP_domain(const Top& _) : other_maps{TOP}, ctx{TOP}, stack{TOP}, packet{TOP}, num{TOP}, fd{TOP}  { }
 
     void operator|=(const RCP_domain& o) {
         pointwise(o, [](auto& a, const auto& b) { a |= b; });
@@ -174,6 +235,10 @@ public:
         pointwise(o, [](auto& a, const auto& b) { a &= b; });
     }
 
+    void widen(const RCP_domain& o) {
+        pointwise(o, [](auto& a, const auto& b) { a.widen(b); });
+    }
+
     void havoc() {
         pointwise([](auto& a) { a.havoc(); });
     }
@@ -227,9 +292,10 @@ public:
         if (a.is_top()) return os << "T";
         if (a.with_fd(TOP).is_top()) return os << "NON-FD";
         os << "[";
-        for (size_t t=0; t < a.maps.size(); t++) {
-            if (!a.maps[t].is_bot()) os << "MAP" << t << "->" << a.maps[t] << "; ";
+        for (const auto& [t, offsets] : a.maps) {
+            if (!offsets.is_bot()) os << "MAP" << t << "->" << offsets << "; ";
         }
+        if (!a.other_maps.is_bot()) os << "MAPS->" << a.other_maps << "; ";
         if (!a.ctx.is_bot()) os << "CTX->" << a.ctx << "; ";
         if (!a.packet.is_bot()) os << "PKT->" << a.packet << "; ";
         if (!a.stack.is_bot()) os << "STK->" << a.stack << "; ";
@@ -1,35 +1,114 @@
 #include <vector>
 #include <algorithm>
 #include <iostream> 
-#include <set>
+#include <limits>
 
 #include <bitset>
 
+#include "config.hpp"
 #include "asm_syntax.hpp"
 #include "ai_dom_set.hpp"
 
-using Set = std::vector<uint64_t>;
-
-template <typename T>
-static std::vector<T> set_union(const std::vector<T>& a, const std::vector<T>& b) {
-    std::vector<T> res;
+template <typename V>
+static V set_union(const V& a, const V& b) {
+    V res;
+    res.reserve(a.size() + b.size());
     std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
     return res;
 }
 
-template <typename T>
-static std::vector<T> set_intersection(const std::vector<T>& a, const std::vector<T>& b) {
-    std::vector<T> res;
+template <typename V>
+static V set_intersection(const V& a, const V& b) {
+    V res;
     std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(res));
     return res;
 }
 
+// The elements of a that are in [lb, ub]
+template <typename V, typename T>
+static V filter(const V& a, T lb, T ub) {
+    V res;
+    for (auto e : a)
+        if (lb <= e && e <= ub) res.push_back(e);
+    return res;
+}
+
+// f(k, n) for all k in a and n in b
+template <typename V, typename F>
+static V cross(const V& a, const V& b, F f) {
+    V res;
+    res.reserve(a.size() * b.size());
+    for (auto k : a)
+        for (auto n : b)
+            res.push_back(f(k, n));
+    return res;
+}
+
+template <typename V>
+static void normalize(V& elems, bool& range) {
+    if (range) {
+        if (elems.front() > elems.back()) {
+            elems.clear();
+            range = false;
+        } else if (global_options.max_set_size > 0
+                   && (uint64_t)(elems.back() - elems.front()) < (uint64_t)global_options.max_set_size) {
+            // small enough to enumerate
+            auto lb = elems.front();
+            auto ub = elems.back();
+            elems.clear();
+            for (auto e = lb; e != ub; e++)
+                elems.push_back(e);
+            elems.push_back(ub);
+            range = false;
+        }
+        return;
+    }
+    std::sort(elems.begin(), elems.end());
+    elems.erase(std::unique(elems.begin(), elems.end()), elems.end());
+    if (global_options.max_set_size > 0 && elems.size() > (size_t)global_options.max_set_size) {
+        auto lb = elems.front();
+        auto ub = elems.back();
+        elems.clear();
+        elems.push_back(lb);
+        elems.push_back(ub);
+        range = true;
+    }
+}
+
+NumDomSet NumDomSet::make_range(uint64_t lb, uint64_t ub) {
+    NumDomSet res{lb, ub};
+    res.range = true;
+    res.normalize();
+    return res;
+}
+
+void NumDomSet::normalize() {
+    if (top) return;
+    ::normalize(elems, range);
+}
+
+bool NumDomSet::contains(uint64_t e) const {
+    if (top) return true;
+    if (range) return elems.front() <= e && e <= elems.back();
+    return std::binary_search(elems.begin(), elems.end(), e);
+}
+
 void NumDomSet::operator|=(const NumDomSet& o) {
     if (top || o.top) {
         havoc();
         return;
     }
+    if (o.is_bot()) return;
+    if (is_bot()) {
+        (*this) = o;
+        return;
+    }
+    if (range || o.range) {
+        (*this) = make_range(std::min(elems.front(), o.elems.front()), std::max(elems.back(), o.elems.back()));
+        return;
+    }
     elems = set_union(elems, o.elems);
+    normalize();
 }
 
 void NumDomSet::operator&=(const NumDomSet& o) {
@@ -40,7 +119,34 @@ void NumDomSet::operator&=(const NumDomSet& o) {
         (*this) = o;
         return;
     }
-    elems = set_intersection(elems, o.elems);
+    if (is_bot() || o.is_bot()) {
+        to_bot();
+    } else if (range && o.range) {
+        (*this) = make_range(std::max(elems.front(), o.elems.front()), std::min(elems.back(), o.elems.back()));
+    } else if (range) {
+        elems = filter(o.elems, elems.front(), elems.back());
+        range = false;
+    } else if (o.range) {
+        elems = filter(elems, o.elems.front(), o.elems.back());
+    } else {
+        elems = set_intersection(elems, o.elems);
+    }
+}
+
+void NumDomSet::widen(const NumDomSet& o) {
+    if (top) {
+        return;
+    }
+    if (o.top) {
+        havoc();
+        return;
+    }
+    if (o.is_bot()) return;
+    bool included = range
+        ? elems.front() <= o.elems.front() && o.elems.back() <= elems.back()
+        : !o.range && std::includes(elems.begin(), elems.end(), o.elems.begin(), o.elems.end());
+    if (!included)
+        havoc();
 }
 
 void NumDomSet::exec(const Bin::Op op, const NumDomSet& o) {
@@ -53,43 +159,87 @@ void NumDomSet::exec(const Bin::Op op, const NumDomSet& o) {
         havoc();
         return;
     }
-    std::set<uint64_t> res;
-    for (auto k : elems) {
-        for (auto n : o.elems) {
-            switch (op) {
-                case Op::MOV : assert(false); break;
-                case Op::ADD : res.insert(k + n); break;
-                case Op::SUB : res.insert(k - n); break;
-                case Op::MUL : res.insert(k * n); break;
-                case Op::DIV : res.insert(k / n); break;
-                case Op::MOD : res.insert(k % n); break;
-                case Op::OR  : res.insert(k | n); break;
-                case Op::AND : res.insert(k & n); break;
-                case Op::LSH : res.insert(k << n); break;
-                case Op::RSH : res.insert((int64_t)k >> n); break;
-                case Op::ARSH: res.insert(k >> n); break;
-                case Op::XOR : res.insert(k ^ n); break;
-            }
+    if (range || o.range) {
+        exec_range(op, o);
+        return;
+    }
+    switch (op) {
+        case Op::MOV : assert(false); break;
+        case Op::ADD : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k + n; }); break;
+        case Op::SUB : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k - n; }); break;
+        case Op::MUL : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k * n; }); break;
+        case Op::DIV : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k / n; }); break;
+        case Op::MOD : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k % n; }); break;
+        case Op::OR  : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k | n; }); break;
+        case Op::AND : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k & n; }); break;
+        case Op::LSH : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k << n; }); break;
+        case Op::RSH : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return (uint64_t)((int64_t)k >> n); }); break;
+        case Op::ARSH: elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k >> n; }); break;
+        case Op::XOR : elems = cross(elems, o.elems, [](uint64_t k, uint64_t n) { return k ^ n; }); break;
+    }
+    normalize();
+}
+
+// Addition and subtraction wrap around; the result is an interval as long as
+// it does not wrap in the middle.
+void NumDomSet::exec_range(const Bin::Op op, const NumDomSet& o) {
+    using Op = Bin::Op;
+    uint64_t width = elems.back() - elems.front();
+    uint64_t o_width = o.elems.back() - o.elems.front();
+    switch (op) {
+        case Op::ADD:
+        case Op::SUB: {
+            uint64_t lb = op == Op::ADD ? elems.front() + o.elems.front() : elems.front() - o.elems.back();
+            uint64_t ub = lb + width + o_width;
+            if (width + o_width < width || ub < lb)
+                havoc();
+            else
+                (*this) = make_range(lb, ub);
+            return;
         }
+        case Op::AND:
+            (*this) = make_range(0, std::min(elems.back(), o.elems.back()));
+            return;
+        default:
+            havoc();
+            return;
     }
-    elems.clear();
-    for (uint64_t e : res)
-        elems.push_back(e);
 }
 
-NumDomSet NumDomSet::from_elems(std::vector<uint64_t>&& elems) {
-    NumDomSet res;
-    res.elems = elems;
-    res.elems.erase(std::unique(res.elems.begin(), res.elems.end()), res.elems.end());
+OffsetDomSet OffsetDomSet::make_range(int64_t lb, int64_t ub) {
+    OffsetDomSet res{lb, ub};
+    res.range = true;
+    res.normalize();
     return res;
 }
 
+void OffsetDomSet::normalize() {
+    if (top) return;
+    ::normalize(elems, range);
+}
+
+bool OffsetDomSet::contains(int64_t e) const {
+    if (top) return true;
+    if (range) return elems.front() <= e && e <= elems.back();
+    return std::binary_search(elems.begin(), elems.end(), e);
+}
+
 void OffsetDomSet::operator|=(const OffsetDomSet& o) {
     if (top || o.top) {
         havoc();
         return;
     }
+    if (o.is_bot()) return;
+    if (is_bot()) {
+        (*this) = o;
+        return;
+    }
+    if (range || o.range) {
+        (*this) = make_range(std::min(elems.front(), o.elems.front()), std::max(elems.back(), o.elems.back()));
+        return;
+    }
     elems = set_union(elems, o.elems);
+    normalize();
 }
 
 void OffsetDomSet::operator&=(const OffsetDomSet& o) {
@@ -100,7 +250,34 @@ void OffsetDomSet::operator&=(const OffsetDomSet& o) {
         (*this) = o;
         return;
     }
-    elems = set_intersection(elems, o.elems);
+    if (is_bot() || o.is_bot()) {
+        to_bot();
+    } else if (range && o.range) {
+        (*this) = make_range(std::max(elems.front(), o.elems.front()), std::min(elems.back(), o.elems.back()));
+    } else if (range) {
+        elems = filter(o.elems, elems.front(), elems.back());
+        range = false;
+    } else if (o.range) {
+        elems = filter(elems, o.elems.front(), o.elems.back());
+    } else {
+        elems = set_intersection(elems, o.elems);
+    }
+}
+
+void OffsetDomSet::widen(const OffsetDomSet& o) {
+    if (top) {
+        return;
+    }
+    if (o.top) {
+        havoc();
+        return;
+    }
+    if (o.is_bot()) return;
+    bool included = range
+        ? elems.front() <= o.elems.front() && o.elems.back() <= elems.back()
+        : !o.range && std::includes(elems.begin(), elems.end(), o.elems.begin(), o.elems.end());
+    if (!included)
+        havoc();
 }
 
 void OffsetDomSet::exec(bool add, const NumDomSet& o) {
@@ -112,7 +289,25 @@ void OffsetDomSet::exec(bool add, const NumDomSet& o) {
         havoc();
         return;
     }
-    std::set<int64_t> res;
+    if (range || o.range) {
+        // Numbers are truncated to int, which only preserves their order
+        // within a block of 2^31 values.
+        uint64_t nlb = o.elems.front(), nub = o.elems.back();
+        if ((nlb >> 31) != (nub >> 31)) {
+            havoc();
+            return;
+        }
+        int64_t lb = add ? elems.front() + (int)nlb : elems.front() - (int)nub;
+        int64_t ub = add ? elems.back() + (int)nub : elems.back() - (int)nlb;
+        if (ub > (1 << 30)) {
+            havoc();
+            return;
+        }
+        (*this) = make_range(lb, ub);
+        return;
+    }
+    Elems res;
+    res.reserve(elems.size() * o.elems.size());
     for (auto k : elems) {
         for (auto n : o.elems) {
             int64_t x = add ? k + (int)n : k - (int)n;
@@ -120,13 +315,11 @@ void OffsetDomSet::exec(bool add, const NumDomSet& o) {
                 havoc();
                 return;
             }
-            res.insert(x);
+            res.push_back(x);
         }
     }
-
-    elems.clear();
-    for (int64_t e : res)
-        elems.push_back(e);
+    elems = res;
+    normalize();
 }
 
 NumDomSet OffsetDomSet::operator-(const OffsetDomSet& o) const {
@@ -136,22 +329,82 @@ NumDomSet OffsetDomSet::operator-(const OffsetDomSet& o) const {
     if (top || o.top) {
         return NumDomSet::make_top();
     }
-    std::set<int64_t> res;
+    if (range || o.range) {
+        int64_t lb = elems.front() - o.elems.back();
+        int64_t ub = elems.back() - o.elems.front();
+        // Negative differences wrap around to the top of the numbers
+        if (ub > (1 << 30) || (lb < 0 && ub >= 0)) {
+            return NumDomSet::make_top();
+        }
+        return NumDomSet::make_range(lb, ub);
+    }
+    NumDomSet out;
+    out.elems.reserve(elems.size() * o.elems.size());
     for (auto k : elems) {
         for (auto n : o.elems) {
-            res.insert(k - n);
             if (k - n > (1 << 30)) {
                 return NumDomSet::make_top();
             }
+            out.elems.push_back(k - n);
         }
     }
-    
-    NumDomSet out;
-    for (int64_t e : res)
-        out.elems.push_back(e);
+    out.normalize();
     return out;
 }
 
+// The smallest and largest elements of a as signed numbers
+static int64_t signed_min(const NumDomSet& a) {
+    if (a.is_range())
+        return (int64_t)a.elems.front() <= (int64_t)a.elems.back() ? (int64_t)a.elems.front() : INT64_MIN;
+    return *std::min_element(a.elems.begin(), a.elems.end(),
+                             [](auto x, auto y){ return (int64_t)x < (int64_t)y; });
+}
+
+static int64_t signed_max(const NumDomSet& a) {
+    if (a.is_range())
+        return (int64_t)a.elems.front() <= (int64_t)a.elems.back() ? (int64_t)a.elems.back() : INT64_MAX;
+    return *std::max_element(a.elems.begin(), a.elems.end(),
+                             [](auto x, auto y){ return (int64_t)x < (int64_t)y; });
+}
+
+// Keep the elements e with lb <= (T)e <= ub. An interval that is not
+// ordered the same way under T is kept as is.
+template <typename T, typename V>
+static void keep_between(V& elems, bool range, T lb, T ub) {
+    if (!range) {
+        V old = elems;
+        elems.clear();
+        for (auto e : old)
+            if (lb <= (T)e && (T)e <= ub) elems.push_back(e);
+        return;
+    }
+    T front = (T)elems.front(), back = (T)elems.back();
+    if (front > back) return;
+    elems[0] = std::max(front, lb);
+    elems[1] = std::min(back, ub);
+}
+
+// Keep the elements e with (T)e op m
+template <typename T, typename V>
+static void keep(V& elems, bool range, Condition::Op op, T m) {
+    using Op = Condition::Op;
+    constexpr T min = std::numeric_limits<T>::min();
+    constexpr T max = std::numeric_limits<T>::max();
+    switch (op) {
+        case Op::GT: case Op::SGT:
+            if (m == max) elems.clear();
+            else keep_between(elems, range, (T)(m + 1), max);
+            break;
+        case Op::GE: case Op::SGE: keep_between(elems, range, m, max); break;
+        case Op::LT: case Op::SLT:
+            if (m == min) elems.clear();
+            else keep_between(elems, range, min, (T)(m - 1));
+            break;
+        case Op::LE: case Op::SLE: keep_between(elems, range, min, m); break;
+        default: assert(false);
+    }
+}
+
 void NumDomSet::assume(Condition::Op op, const NumDomSet& right) {
     if (right.is_top()) return;
     using Op = Condition::Op;
@@ -160,80 +413,48 @@ void NumDomSet::assume(Condition::Op op, const NumDomSet& right) {
             (*this) &= right;
             return;
         case Op::NE : {
-            std::vector<uint64_t> old;
-            std::swap(old, elems);
-            std::set_difference(
-                old.begin(), old.end(),
-                right.elems.begin(), right.elems.end(),
-                std::back_inserter(elems));
+            if (top) return;
+            if (right.is_single() && range) {
+                if (right.elems.front() == elems.front()) elems[0]++;
+                else if (right.elems.front() == elems.back()) elems[1]--;
+                normalize();
+            } else if (!range && right.range) {
+                Elems old = elems;
+                elems.clear();
+                for (auto e : old)
+                    if (!right.contains(e)) elems.push_back(e);
+            } else if (!range) {
+                Elems old;
+                std::swap(old, elems);
+                std::set_difference(
+                    old.begin(), old.end(),
+                    right.elems.begin(), right.elems.end(),
+                    std::back_inserter(elems));
+            }
             return;
         }
         case Op::SET: return;
         case Op::NSET:return;
         default: break;
     }
-    std::vector<uint64_t> old;
-    std::swap(old, elems);
-    if (right.elems.empty()) return;
+    if (top) return;
+    if (right.elems.empty()) {
+        to_bot();
+        return;
+    }
     switch (op) {
-        case Op::EQ :
-        case Op::NE :
-        case Op::SET: 
-        case Op::NSET: assert(false);
-
-        case Op::GT : {
-            auto m = *std::min_element(right.elems.begin(), right.elems.end());
-            for (auto e : old)
-                if (e > m) elems.push_back(e);
-            break;
-        }
-        case Op::GE : {
-            auto m = *std::min_element(right.elems.begin(), right.elems.end());
-            for (auto e : old)
-                if (e >= m) elems.push_back(e);
-            break;
-        }
-        case Op::SGT: {
-            auto m = *std::min_element(right.elems.begin(), right.elems.end(),
-                       [](auto a, auto b){ return (int64_t)a < (int64_t)b; });
-            for (auto e : old)
-                if ((int64_t)e > (int64_t)m) elems.push_back(e);
-            break;
-        }
-        case Op::SGE: {
-            auto m = *std::min_element(right.elems.begin(), right.elems.end(),
-                       [](auto a, auto b){ return (int64_t)a < (int64_t)b; });
-            for (auto e : old)
-                if ((int64_t)e >= (int64_t)m) elems.push_back(e);
-            break;
-        }
-        case Op::LT : {
-            auto m = *std::max_element(right.elems.begin(), right.elems.end());
-            for (auto e : old)
-                if (e < m) elems.push_back(e);
-            break;
-        }
-        case Op::LE : {
-            auto m = *std::max_element(right.elems.begin(), right.elems.end());
-            for (auto e : old)
-                if (e <= m) elems.push_back(e);
-            break;
-        }
-        case Op::SLT: {
-            auto m = *std::max_element(right.elems.begin(), right.elems.end(),
-                       [](auto a, auto b){ return (int64_t)a < (int64_t)b; });
-            for (auto e : old)
-                if ((int64_t)e < (int64_t)m) elems.push_back(e);
-            break;
-        }
-        case Op::SLE: {
-            auto m = *std::max_element(right.elems.begin(), right.elems.end(),
-                       [](auto a, auto b){ return (int64_t)a < (int64_t)b; });
-            for (auto e : old)
-                if ((int64_t)e <= (int64_t)m) elems.push_back(e);
-            break;
-        }
+        case Op::GT :
+        case Op::GE : keep(elems, range, op, right.elems.front()); break;
+        case Op::LT :
+        case Op::LE : keep(elems, range, op, right.elems.back()); break;
+        case Op::SGT:
+        case Op::SGE: keep(elems, range, op, signed_min(right)); break;
+        case Op::SLT:
+        case Op::SLE: keep(elems, range, op, signed_max(right)); break;
+        default: assert(false);
     }
+    if (elems.empty()) to_bot();
+    else normalize();
 }
 
 void OffsetDomSet::assume(Condition::Op op, const OffsetDomSet& right) {
@@ -244,54 +465,47 @@ void OffsetDomSet::assume(Condition::Op op, const OffsetDomSet& right) {
             (*this) &= right;
             return;
         case Op::NE : {
-            std::vector<int64_t> old;
-            std::swap(old, elems);
-            std::set_difference(
-                old.begin(), old.end(),
-                right.elems.begin(), right.elems.end(),
-                std::back_inserter(elems));
+            if (top) return;
+            if (right.is_single() && range) {
+                if (right.elems.front() == elems.front()) elems[0]++;
+                else if (right.elems.front() == elems.back()) elems[1]--;
+                normalize();
+            } else if (!range && right.range) {
+                Elems old = elems;
+                elems.clear();
+                for (auto e : old)
+                    if (!right.contains(e)) elems.push_back(e);
+            } else if (!range) {
+                Elems old;
+                std::swap(old, elems);
+                std::set_difference(
+                    old.begin(), old.end(),
+                    right.elems.begin(), right.elems.end(),
+                    std::back_inserter(elems));
+            }
             return;
         }
         case Op::SET: return;
         case Op::NSET:return;
         default: break;
     }
-    std::vector<int64_t> old;
-    std::swap(old, elems);
-    if (right.elems.empty()) return;
+    if (top) return;
+    if (right.elems.empty()) {
+        to_bot();
+        return;
+    }
     switch (op) {
-        case Op::GT : {
-            auto m = *std::min_element(right.elems.begin(), right.elems.end());
-            for (auto e : old)
-                if (e > m) elems.push_back(e);
-            break;
-        }
-        case Op::GE : {
-            auto m = *std::min_element(right.elems.begin(), right.elems.end());
-            for (auto e : old)
-                if (e >= m) elems.push_back(e);
-            break;
-        }
-        case Op::LT : {
-            auto m = *std::max_element(right.elems.begin(), right.elems.end());
-            for (auto e : old)
-                if (e < m) elems.push_back(e);
-            break;
-        }
-        case Op::LE : {
-            auto m = *std::max_element(right.elems.begin(), right.elems.end());
-            for (auto e : old)
-                if (e <= m) elems.push_back(e);
-            break;
-        }
-        case Op::EQ :  assert(false); break;
-        case Op::NE :  assert(false); break;
-        case Op::SET:  assert(false); break;
-        case Op::NSET: assert(false); break;
+        case Op::GT :
+        case Op::GE : keep(elems, range, op, right.elems.front()); break;
+        case Op::LT :
+        case Op::LE : keep(elems, range, op, right.elems.back()); break;
 
         case Op::SGT: assert(false); break;
         case Op::SGE: assert(false); break;
         case Op::SLT: assert(false); break;
         case Op::SLE: assert(false); break;
+        default: assert(false);
     }
+    if (elems.empty()) to_bot();
+    else normalize();
 }
@@ -2,9 +2,9 @@
 
 #include <vector>
 
-#include <bitset>
-
 #include "asm_syntax.hpp"
+#include "map_set.hpp"
+#include "small_vector.hpp"
 #include "spec_type_descriptors.hpp"
 
 constexpr class Top { } TOP;
@@ -12,11 +12,11 @@ constexpr class Top { } TOP;
 struct FdSetDom {
     using This = FdSetDom;
 
-    std::bitset<NMAPS> fds;
+    MapSet fds;
     
     FdSetDom() { }
     FdSetDom(const Top& _) { havoc(); }
-    FdSetDom(const std::bitset<NMAPS>& fds) : fds{fds} { }
+    FdSetDom(const MapSet& fds) : fds{fds} { }
 
     void assign(int mapfd) {
         fds.reset();
@@ -30,6 +30,8 @@ struct FdSetDom {
 
     void operator|=(const FdSetDom& o) { fds |= o.fds; }
     void operator&=(const FdSetDom& o) { fds &= o.fds; }
+    // finite height
+    void widen(const FdSetDom& o) { fds |= o.fds; }
 
     bool operator==(const FdSetDom& o) const { return fds == o.fds; };
 
@@ -55,28 +57,43 @@ struct FdSetDom {
     }
 };
 
+/** Sets of values are sorted and kept inline up to four elements. A set
+ *  with more than global_options.max_set_size elements collapses to the
+ *  interval between its smallest and largest element, stored as the two
+ *  bounds in elems, so both the state and the cost of each operation stay
+ *  bounded.
+ */
 class NumDomSet {
     using This = NumDomSet;
-    // Naive set implementation
     bool top{};
+    // elems holds the bounds of an interval
+    bool range{};
 
     static This make_top() { This res; res.havoc(); return res; }
-    static This from_elems(std::vector<uint64_t>&& elems);
+    static This make_range(uint64_t lb, uint64_t ub);
+    // Sort, remove duplicates and collapse sets that are too large
+    void normalize();
+    void exec_range(const Bin::Op op, const NumDomSet& o);
 public:
-    std::vector<uint64_t> elems;
+    using Elems = small_vector<uint64_t, 4>;
+    Elems elems;
     template <typename ...Args>
-    NumDomSet(Args... elems) : elems{static_cast<uint64_t>(elems)...} { }
+    NumDomSet(Args... elems) : elems{static_cast<uint64_t>(elems)...} { normalize(); }
 
     NumDomSet(const Top& _) { havoc(); }
 
     bool is_bot() const { return !top && elems.empty(); }
-    void to_bot() { elems.clear(); top = false; }
-    void havoc() { elems.clear(); top = true; }
+    void to_bot() { elems.clear(); top = false; range = false; }
+    void havoc() { elems.clear(); top = true; range = false; }
     bool is_top() const { return top; }
-    bool is_single() const { return !top && elems.size() == 1; }
+    bool is_range() const { return range; }
+    bool is_single() const { return !top && !range && elems.size() == 1; }
+    bool contains(uint64_t e) const;
 
     void operator|=(const This& o);
     void operator&=(const This& o);
+    /** Unchanged if o has no new element, top otherwise. */
+    void widen(const This& o);
 
     void exec(const Bin::Op op, const NumDomSet& o);
     
@@ -84,7 +101,7 @@ public:
     void operator-=(const This& o) { exec(Bin::Op::SUB, o); }
 
     bool operator==(const This& b) const {
-        return top == b.top && elems == b.elems;
+        return top == b.top && range == b.range && elems == b.elems;
     }
 
     void assume(Condition::Op op, const NumDomSet& right);
@@ -101,6 +118,7 @@ public:
 
     friend std::ostream& operator<<(std::ostream& os, const This& a) {
         if (a.top) return os << "T";
+        if (a.range) return os << "[" << (int64_t)a.elems.front() << "," << (int64_t)a.elems.back() << "]";
         os << "{";
         for (auto e : a.elems)
             os << (int64_t)e << ",";
@@ -111,27 +129,36 @@ public:
 
 class OffsetDomSet {
     using This = OffsetDomSet;
-    // Naive set implementation
     bool top{};
+    // elems holds the bounds of an interval
+    bool range{};
+
+    static This make_range(int64_t lb, int64_t ub);
+    // Sort, remove duplicates and collapse sets that are too large
+    void normalize();
 public:
-    std::vector<int64_t> elems;
+    using Elems = small_vector<int64_t, 4>;
+    Elems elems;
     template <typename ...Args>
-    OffsetDomSet(Args... elems) : elems{static_cast<int64_t>(elems)...} { }
+    OffsetDomSet(Args... elems) : elems{static_cast<int64_t>(elems)...} { normalize(); }
 
     OffsetDomSet(const Top& _) { havoc(); }
 
     void operator|=(const This& o);
     void operator&=(const This& o);
+    /** Unchanged if o has no new element, top otherwise. */
+    void widen(const This& o);
 
     void exec(bool add, const NumDomSet& o);
     NumDomSet operator-(const This& o) const;
 
     bool is_bot() const { return !top && elems.empty(); }
-    void to_bot() { elems.clear(); top = false; }
-    void havoc() { elems.clear(); top = true; }
+    void to_bot() { elems.clear(); top = false; range = false; }
+    void havoc() { elems.clear(); top = true; range = false; }
     bool is_top() const { return top; }
-    bool is_single() const { return !top && elems.size() == 1; }
-    bool contains(int64_t e) const { return top || std::count(elems.begin(), elems.end(), e) > 0; }
+    bool is_range() const { return range; }
+    bool is_single() const { return !top && !range && elems.size() == 1; }
+    bool contains(int64_t e) const;
 
     void operator+=(const NumDomSet& o) { exec(true, o); }
     void operator-=(const NumDomSet& o) { exec(false, o); }
@@ -148,10 +175,11 @@ public:
         return d == *this;
     }
 
-    bool operator==(const This& b) const { return top == b.top && elems == b.elems; }
+    bool operator==(const This& b) const { return top == b.top && range == b.range && elems == b.elems; }
 
     friend std::ostream& operator<<(std::ostream& os, const This& a) {
         if (a.top) return os << "T";
+        if (a.range) return os << "[" << a.elems.front() << "," << a.elems.back() << "]";
         os << "{";
         for (auto e : a.elems)
             os << e << ",";
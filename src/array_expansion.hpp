@@ -36,9 +36,13 @@
 #include <algorithm>
 #include <boost/optional.hpp>
 #include <set>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
+#include "cell_keys.hpp"
+#include "interval_index.hpp"
+
 namespace crab {
 namespace domains {
 
@@ -260,29 +264,41 @@ private:
   using partial_order_t = typename patricia_tree_t::partial_order_t;
 
   patricia_tree_t _map;
+  // the cells of _map by the bytes they span, for overlap queries
+  interval_index<cell_t> _index;
 
-  // global state to map the same triple of array, offset and size
-  // to same index
-  static std::map<std::pair<ikos::index_t, std::pair<offset_t, uint64_t>>,
-                  ikos::index_t>
-      s_index_map;
-
-  // for algorithm::lower_bound and algorithm::upper_bound
-  struct compare_binding_t {
-    bool operator()(const typename patricia_tree_t::binding_t &kv,
-                    const offset_t &o) const {
-      return kv.first < o;
-    }
-    bool operator()(const offset_t &o,
-                    const typename patricia_tree_t::binding_t &kv) const {
-      return o < kv.first;
+  // A cell by the index of its array, its offset and its size
+  struct cell_key {
+    ikos::index_t array;
+    uint64_t offset;
+    uint64_t size;
+
+    bool operator==(const cell_key &o) const {
+      return array == o.array && offset == o.offset && size == o.size;
     }
-    bool operator()(const typename patricia_tree_t::binding_t &kv1,
-                    const typename patricia_tree_t::binding_t &kv2) const {
-      return kv1.first < kv2.first;
+  };
+
+  struct cell_key_hash {
+    size_t operator()(const cell_key &k) const {
+      size_t h = std::hash<uint64_t>()(k.array);
+      h = h * 0x9e3779b97f4a7c15ULL + std::hash<uint64_t>()(k.offset);
+      return h * 0x9e3779b97f4a7c15ULL + std::hash<uint64_t>()(k.size);
     }
   };
 
+  // global state to map the same triple of array, offset and size
+  // to the same scalar. Scalars belong to the variable factory of
+  // their array, so the map is cleared when the factory changes, and
+  // between analyses.
+  static std::unordered_map<cell_key, Variable, cell_key_hash> s_scalar_map;
+  static const void *s_scalar_factory;
+  // whether new scalars are named after their segment
+  static bool s_scalar_names;
+
+  // global state to map a cell scalar back to its array segment
+  static std::map<ikos::index_t, std::pair<Variable, std::pair<offset_t, uint64_t>>>
+      s_segment_map;
+
   patricia_tree_t apply_operation(binary_op_t &o, patricia_tree_t t1,
                                   patricia_tree_t t2) {
     t1.merge_with(t2, o);
@@ -318,9 +334,14 @@ private:
     bool default_is_top() { return false; }
   }; // class domain_po
 
+  static uint64_t last_byte(const cell_t &c) {
+    return c.get_offset().index() + c.get_size() - 1;
+  }
+
   void remove_cell(const cell_t &c) {
     if (boost::optional<cell_set_t> cells = _map.lookup(c.get_offset())) {
       if ((*cells).erase(c) > 0) {
+        _index.erase(c.get_offset().index(), last_byte(c));
         _map.remove(c.get_offset());
         if (!(*cells).empty()) {
           // a bit of a waste ...
@@ -340,11 +361,13 @@ private:
         // a bit of a waste ...
         _map.remove(c.get_offset());
         _map.insert(c.get_offset(), *cells);
+        _index.insert(c.get_offset().index(), last_byte(c), c);
       }
     } else {
       cell_set_t new_cells;
       new_cells.insert(c);
       _map.insert(c.get_offset(), new_cells);
+      _index.insert(c.get_offset().index(), last_byte(c), c);
     }
   }
 
@@ -383,15 +406,38 @@ private:
     }
   }
 
-  ikos::index_t get_index(Variable a, offset_t o, uint64_t size) {
-    auto it = s_index_map.find({a.index(), {o, size}});
-    if (it != s_index_map.end()) {
+  static void clear_scalars() {
+    s_scalar_map.clear();
+    s_segment_map.clear();
+    s_scalar_factory = nullptr;
+  }
+
+  // The scalar of array[o,...,o+size-1]. Its name is only built the
+  // first time it is asked for, and only if names may be printed: a
+  // scalar made from its key alone prints as crab's default name.
+  static Variable get_scalar(Variable array, offset_t o, uint64_t size) {
+    auto &vfac = const_cast<varname_t *>(&(array.name()))->get_var_factory();
+    if (s_scalar_factory != &vfac) {
+      clear_scalars();
+      s_scalar_factory = &vfac;
+    }
+    cell_key key{array.index(), o.index(), size};
+    auto it = s_scalar_map.find(key);
+    if (it != s_scalar_map.end()) {
       return it->second;
-    } else {
-      ikos::index_t res = s_index_map.size();
-      s_index_map.insert({{a.index(), {o, size}}, res});
-      return res;
     }
+    variable_type_kind vtype_kind = get_array_element_type(array.get_type());
+    // create a new scalar variable for representing the contents
+    // of bytes array[o,o+1,..., o+size-1]
+    std::string name = s_scalar_names ? mk_scalar_name(array, o, size) : "";
+    Variable scalar_var(vfac.get(next_cell_key(), std::move(name)),
+                        vtype_kind,
+                        (vtype_kind == BOOL_TYPE
+                             ? 1
+                             : (vtype_kind == INT_TYPE ? 8 * size : 0)));
+    s_scalar_map.emplace(key, scalar_var);
+    s_segment_map.insert({scalar_var.index(), {array, {o, size}}});
+    return scalar_var;
   }
 
   cell_t mk_cell(Variable array, offset_t o, uint64_t size /*bytes*/) {
@@ -399,17 +445,7 @@ private:
 
     cell_t c = get_cell(o, size);
     if (c.is_null()) {
-      auto &vfac = const_cast<varname_t *>(&(array.name()))->get_var_factory();
-      std::string vname = mk_scalar_name(array, o, size);
-      variable_type_kind vtype_kind = get_array_element_type(array.get_type());
-      // create a new scalar variable for representing the contents
-      // of bytes array[o,o+1,..., o+size-1]
-      ikos::index_t vindex = get_index(array, o, size);
-      Variable scalar_var(vfac.get(vindex, vname), vtype_kind,
-                          (vtype_kind == BOOL_TYPE
-                               ? 1
-                               : (vtype_kind == INT_TYPE ? 8 * size : 0)));
-      c = cell_t(o, size, scalar_var);
+      c = cell_t(o, size, get_scalar(array, o, size));
       insert_cell(c);
       CRAB_LOG("array-expansion", crab::outs()
                                       << "**Created cell " << c << "\n";);
@@ -421,7 +457,10 @@ private:
     return c;
   }
 
-  offset_map(patricia_tree_t &&m) : _map(std::move(m)) {}
+  // The index of a join or meet is that of one operand, updated with the
+  // cells of the other.
+  offset_map(patricia_tree_t &&m, interval_index<cell_t> &&index)
+      : _map(std::move(m)), _index(std::move(index)) {}
 
 public:
   offset_map() {}
@@ -440,14 +479,18 @@ public:
   // size then they are ignored.
   offset_map_t operator|(const offset_map_t &o) const {
     join_op op;
-    return offset_map_t(apply_operation(op, _map, o._map));
+    interval_index<cell_t> index = _index;
+    index.unite(o._index);
+    return offset_map_t(apply_operation(op, _map, o._map), std::move(index));
   }
 
   // set intersection: if two cells with same offset do not agree
   // on size then they are ignored.
   offset_map_t operator&(const offset_map_t &o) const {
     meet_op op;
-    return offset_map_t(apply_operation(op, _map, o._map));
+    interval_index<cell_t> index = _index;
+    index.intersect(o._index);
+    return offset_map_t(apply_operation(op, _map, o._map), std::move(index));
   }
 
   void operator-=(const cell_t &c) { remove_cell(c); }
@@ -469,104 +512,16 @@ public:
     return res;
   }
 
-  // Return in out all cells that might overlap with (o, size).
-  void get_overlap_cells(offset_t o, uint64_t size, std::vector<cell_t> &out) {
-    compare_binding_t comp;
-
-    bool added = false;
-    cell_t c = get_cell(o, size);
-    if (c.is_null()) {
-      // we need to add a temporary cell for (o, size)
-      c = cell_t(o, size);
-      insert_cell(c, false /*disable sanity check*/);
-      added = true;
-    }
-
-    auto lb_it = std::lower_bound(_map.begin(), _map.end(), o, comp);
-    if (lb_it != _map.end()) {
-      // Store _map[begin,...,lb_it] into a vector so that we can
-      // go backwards from lb_it.
-      //
-      // TODO: give support for reverse iterator in patricia_tree.
-      std::vector<cell_set_t> upto_lb;
-      upto_lb.reserve(std::distance(_map.begin(), lb_it));
-      for (auto it = _map.begin(), et = lb_it; it != et; ++it) {
-        upto_lb.push_back(it->second);
-      }
-      upto_lb.push_back(lb_it->second);
-
-      for (int i = upto_lb.size() - 1; i >= 0; --i) {
-        ///////
-        // All the cells in upto_lb[i] have the same offset. They
-        // just differ in the size.
-        //
-        // If none of the cells in upto_lb[i] overlap with (o, size)
-        // we can stop.
-        ////////
-        bool continue_outer_loop = false;
-        for (const cell_t &x : upto_lb[i]) {
-          if (x.overlap(o, size)) {
-            if (!(x == c)) {
-              // FIXME: we might have some duplicates. this is a very drastic
-              // solution.
-              if (std::find(out.begin(), out.end(), x) == out.end()) {
-                out.push_back(x);
-              }
-            }
-            continue_outer_loop = true;
-          }
-        }
-        if (!continue_outer_loop) {
-          break;
-        }
-      }
-    }
-
-    // search for overlapping cells > o
-    auto ub_it = std::upper_bound(_map.begin(), _map.end(), o, comp);
-    for (; ub_it != _map.end(); ++ub_it) {
-      bool continue_outer_loop = false;
-      for (const cell_t &x : ub_it->second) {
-        if (x.overlap(o, size)) {
-          // FIXME: we might have some duplicates. this is a very drastic
-          // solution.
-          if (std::find(out.begin(), out.end(), x) == out.end()) {
-            out.push_back(x);
-          }
-          continue_outer_loop = true;
-        }
-      }
-      if (!continue_outer_loop) {
-        break;
+  // Return in out all cells, other than (o, size) itself, that
+  // overlap with (o, size).
+  void get_overlap_cells(offset_t o, uint64_t size,
+                         std::vector<cell_t> &out) const {
+    cell_t c(o, size);
+    _index.overlaps(o.index(), o.index() + size - 1, [&](const cell_t &x) {
+      if (!(x == c)) {
+        out.push_back(x);
       }
-    }
-
-    // do not forget the rest of overlapping cells == o
-    for (auto it = ++lb_it, et = ub_it; it != et; ++it) {
-      bool continue_outer_loop = false;
-      for (const cell_t &x : it->second) {
-        if (x == c) { // we dont put it in out
-          continue;
-        }
-        if (x.overlap(o, size)) {
-          if (!(x == c)) {
-            if (std::find(out.begin(), out.end(), x) == out.end()) {
-              out.push_back(x);
-            }
-          }
-          continue_outer_loop = true;
-        }
-      }
-      if (!continue_outer_loop) {
-        break;
-      }
-    }
-
-    if (added) {
-      // remove the temporary cell for (o, size)
-      assert(!c.is_null());
-      remove_cell(c);
-    }
+    });
 
     CRAB_LOG(
         "array-expansion-overlap", crab::outs()
@@ -583,6 +538,13 @@ public:
         << "}\n";);
   }
 
+  // Return in out all cells that overlap with [lb, ub].
+  void get_cells_in_range(offset_t lb, offset_t ub,
+                          std::vector<cell_t> &out) const {
+    _index.overlaps(lb.index(), ub.index(),
+                    [&](const cell_t &x) { out.push_back(x); });
+  }
+
   template <typename Dom>
   void get_overlap_cells_symbolic_offset(
       const Dom &dom, const typename Dom::linear_expression_t &symb_lb,
@@ -661,8 +623,19 @@ public:
 };
 
 template <typename Var>
-std::map<std::pair<ikos::index_t, std::pair<offset_t, uint64_t>>, ikos::index_t>
-    offset_map<Var>::s_index_map;
+std::unordered_map<typename offset_map<Var>::cell_key, Var,
+                   typename offset_map<Var>::cell_key_hash>
+    offset_map<Var>::s_scalar_map;
+
+template <typename Var>
+const void *offset_map<Var>::s_scalar_factory = nullptr;
+
+template <typename Var>
+bool offset_map<Var>::s_scalar_names = true;
+
+template <typename Var>
+std::map<ikos::index_t, std::pair<Var, std::pair<offset_t, uint64_t>>>
+    offset_map<Var>::s_segment_map;
 
 template <typename NumDomain>
 class array_expansion_domain final
@@ -717,6 +690,42 @@ public:
       }
       map.clear();
     }
+    offset_map_t::clear_scalars();
+    offset_map_t::s_scalar_names = true;
+  }
+
+  /**
+      Whether the scalars of cells are named after their segment, "A[o]"
+      or "A[o...e]". The names are only read when invariants or checks
+      are printed, so an analysis that prints neither can turn them off.
+      Applies to the scalars created afterwards, until the global state
+      is cleared.
+  **/
+  static void set_cell_names(bool on) { offset_map_t::s_scalar_names = on; }
+
+  /**
+      The array segment <array, offset, size> represented by v if v
+      is the scalar of some cell. Together with get_cell_scalar this
+      allows invariants to be stored and read back in another run.
+  **/
+  static boost::optional<std::tuple<variable_t, uint64_t, uint64_t>>
+  get_cell_segment(const variable_t &v) {
+    auto &segments = offset_map_t::s_segment_map;
+    auto it = segments.find(v.index());
+    if (it == segments.end()) {
+      return boost::none;
+    }
+    const auto &seg = it->second;
+    return std::make_tuple(seg.first, (uint64_t)seg.second.first.index(),
+                           seg.second.second);
+  }
+
+  // Return the scalar of the cell a[o,...,o+size-1], creating it if
+  // needed.
+  static variable_t get_cell_scalar(const variable_t &a, uint64_t o,
+                                    uint64_t size) {
+    offset_map_t &offset_map = get_array_map()[a];
+    return offset_map.mk_cell(a, offset_t(o), size).get_scalar();
   }
 
 private:
@@ -1600,10 +1609,41 @@ public:
   }
 
   /* begin intrinsics operations */
+  // forget_cells(a1,...,an,lb1,ub1,...,lbm,ubm) forgets the scalars of
+  // the cells of the arrays ai that overlap with some [lbj, ubj). The
+  // cells stay in the offset maps, which are shared by all states.
   void intrinsic(std::string name,
 		 const variable_or_constant_vector_t &inputs,
                  const variable_vector_t &outputs) override {
-    CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+    if (name != "forget_cells") {
+      CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+      return;
+    }
+    crab::CrabStats::count(domain_name() + ".count.forget_cells");
+    crab::ScopedCrabStats __st__(domain_name() + ".forget_cells");
+
+    if (is_bottom())
+      return;
+
+    unsigned i = 0;
+    std::vector<variable_t> arrays;
+    for (; i < inputs.size() && inputs[i].is_variable(); ++i) {
+      arrays.push_back(inputs[i].get_variable());
+    }
+    for (; i + 1 < inputs.size(); i += 2) {
+      int64_t lb = static_cast<int64_t>(inputs[i].get_constant());
+      int64_t ub = static_cast<int64_t>(inputs[i + 1].get_constant());
+      if (lb >= ub)
+        continue;
+      for (const variable_t &a : arrays) {
+        std::vector<cell_t> cells;
+        lookup_array_map(a).get_cells_in_range(offset_t(lb), offset_t(ub - 1),
+                                                cells);
+        for (const cell_t &c : cells) {
+          _inv -= c.get_scalar();
+        }
+      }
+    }
   }
 
   void backward_intrinsic(std::string name,
@@ -1670,6 +1710,7 @@ class special_domain_traits<array_expansion_domain<BaseDom>> {
 public:
   static void clear_global_state(void) {
     array_expansion_domain<BaseDom>::clear_global_state();
+    special_domain_traits<BaseDom>::clear_global_state();
   }
 };
 
@@ -231,7 +231,7 @@ Cfg Cfg::to_nondet(bool expand_locks) const {
 }
 
 
-static std::string instype(Instruction ins) {
+std::string instype(Instruction ins) {
     if (std::holds_alternative<Call>(ins)) {
         auto call = std::get<Call>(ins);
         if (call.returns_map) {
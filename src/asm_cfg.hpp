@@ -53,3 +53,6 @@ public:
     static std::vector<std::string> stats_headers();
     std::map<std::string, int> collect_stats() const;
 };
+
+/** The kind of an instruction, as counted by Cfg::collect_stats(). */
+std::string instype(Instruction ins);
@@ -239,23 +239,23 @@ std::ostream& operator<<(std::ostream& os, Instruction const& ins) {
 
 std::ostream& operator<<(std::ostream& os, Types ts) {
     os << "|";
-    bool all_maps = true;
-    for (size_t i=0; i < NMAPS; i++) {
-        if (!ts[i]) all_maps = false;
-    }
-    if (all_maps)
+    const MapSet& maps = ts.maps();
+    if (maps.all()) {
         os << "MAP|";
-    else
-        for (size_t i=0; i < NMAPS; i++) {
-            if (ts[i]) {
-                os << "M" << i << "|";
-            }
-        }
-    if (ts[ts.size()+T_NUM]) os << "N" << "|"; 
-    if (ts[ts.size()+T_FD]) os << "FD" << "|";
-    if (ts[ts.size()+T_CTX]) os << "C" << "|" ; 
-    if (ts[ts.size()+T_DATA]) os  << "P" << "|" ; 
-    if (ts[ts.size()+T_STACK]) os << "S" << "|";
+    } else if (maps.is_finite()) {
+        for (size_t i : maps.elements())
+            os << "M" << i << "|";
+    } else {
+        os << "MAP";
+        for (size_t i : (~maps).elements())
+            os << "-M" << i;
+        os << "|";
+    }
+    if (ts[T_NUM]) os << "N" << "|"; 
+    if (ts[T_FD]) os << "FD" << "|";
+    if (ts[T_CTX]) os << "C" << "|" ; 
+    if (ts[T_DATA]) os  << "P" << "|" ; 
+    if (ts[T_STACK]) os << "S" << "|";
     return os;
 }
 
@@ -0,0 +1,23 @@
+#pragma once
+
+/**
+ *  Keys of the cell scalars of the array domains.
+ *
+ *  array_expansion and stack_array create the scalar of a cell with
+ *  variable_factory::get(key, name), which returns the variable already made
+ *  for a key. Both domains take their keys from one counter that is never
+ *  reset, so a factory shared by both, or kept across analyses, never hands
+ *  out the scalar of another cell.
+ **/
+#include <crab/types/indexable.hpp>
+
+namespace crab {
+namespace domains {
+
+inline ikos::index_t next_cell_key() {
+  static ikos::index_t next = 0;
+  return next++;
+}
+
+} // namespace domains
+} // namespace crab
@@ -0,0 +1,169 @@
+#pragma once
+
+/**
+ *  Integers that are machine words until they overflow.
+ *
+ *  A checked_number holds an int64_t, and only switches to a GMP integer
+ *  when an operation overflows; results that fit in 64 bits again are
+ *  stored as words. Arithmetic follows ikos::z_number: division and
+ *  remainder truncate toward zero.
+ **/
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include <gmpxx.h>
+
+class checked_number {
+    int64_t _small = 0;
+    std::unique_ptr<mpz_class> _big;  // null while the value fits in 64 bits
+
+    static checked_number from_mpz(mpz_class z) {
+        checked_number res;
+        if (z.fits_slong_p())
+            res._small = z.get_si();
+        else
+            res._big = std::make_unique<mpz_class>(std::move(z));
+        return res;
+    }
+
+    static void check_divisor(const checked_number& x) {
+        if (x.is_zero())
+            throw std::domain_error("checked_number: division by zero");
+    }
+
+public:
+    checked_number() = default;
+    checked_number(int64_t n) : _small(n) {}
+    checked_number(int n) : _small(n) {}
+    explicit checked_number(const mpz_class& z) { *this = from_mpz(z); }
+    explicit checked_number(const std::string& s) { *this = from_mpz(mpz_class(s)); }
+
+    checked_number(const checked_number& o) : _small(o._small), _big(o._big ? std::make_unique<mpz_class>(*o._big) : nullptr) {}
+    checked_number(checked_number&&) = default;
+
+    checked_number& operator=(const checked_number& o) {
+        if (this != &o) {
+            _small = o._small;
+            _big = o._big ? std::make_unique<mpz_class>(*o._big) : nullptr;
+        }
+        return *this;
+    }
+    checked_number& operator=(checked_number&&) = default;
+
+    bool fits_int64() const { return !_big; }
+    bool is_zero() const { return !_big && _small == 0; }
+
+    /** The value, which must fit in 64 bits. */
+    explicit operator int64_t() const { return _small; }
+
+    mpz_class to_mpz() const {
+        if (_big)
+            return *_big;
+        mpz_class z;
+        mpz_set_si(z.get_mpz_t(), _small);
+        return z;
+    }
+
+    std::string get_str() const { return _big ? _big->get_str() : std::to_string(_small); }
+
+    size_t hash() const { return _big ? std::hash<std::string>()(_big->get_str()) : std::hash<int64_t>()(_small); }
+
+    friend checked_number operator+(const checked_number& x, const checked_number& y) {
+        int64_t r;
+        if (!x._big && !y._big && !__builtin_add_overflow(x._small, y._small, &r))
+            return r;
+        return from_mpz(x.to_mpz() + y.to_mpz());
+    }
+
+    friend checked_number operator-(const checked_number& x, const checked_number& y) {
+        int64_t r;
+        if (!x._big && !y._big && !__builtin_sub_overflow(x._small, y._small, &r))
+            return r;
+        return from_mpz(x.to_mpz() - y.to_mpz());
+    }
+
+    friend checked_number operator*(const checked_number& x, const checked_number& y) {
+        int64_t r;
+        if (!x._big && !y._big && !__builtin_mul_overflow(x._small, y._small, &r))
+            return r;
+        return from_mpz(x.to_mpz() * y.to_mpz());
+    }
+
+    friend checked_number operator/(const checked_number& x, const checked_number& y) {
+        check_divisor(y);
+        if (!x._big && !y._big && !(x._small == INT64_MIN && y._small == -1))
+            return x._small / y._small;
+        return from_mpz(x.to_mpz() / y.to_mpz());
+    }
+
+    friend checked_number operator%(const checked_number& x, const checked_number& y) {
+        check_divisor(y);
+        if (!x._big && !y._big)
+            return y._small == -1 ? 0 : x._small % y._small;
+        return from_mpz(x.to_mpz() % y.to_mpz());
+    }
+
+    checked_number operator-() const {
+        if (!_big && _small != INT64_MIN)
+            return -_small;
+        return from_mpz(-to_mpz());
+    }
+
+    friend checked_number operator&(const checked_number& x, const checked_number& y) {
+        if (!x._big && !y._big)
+            return x._small & y._small;
+        return from_mpz(x.to_mpz() & y.to_mpz());
+    }
+
+    friend checked_number operator|(const checked_number& x, const checked_number& y) {
+        if (!x._big && !y._big)
+            return x._small | y._small;
+        return from_mpz(x.to_mpz() | y.to_mpz());
+    }
+
+    friend checked_number operator^(const checked_number& x, const checked_number& y) {
+        if (!x._big && !y._big)
+            return x._small ^ y._small;
+        return from_mpz(x.to_mpz() ^ y.to_mpz());
+    }
+
+    // shifts by a non-negative amount that fits in 64 bits
+    friend checked_number operator<<(const checked_number& x, const checked_number& y) {
+        return from_mpz(x.to_mpz() << (mp_bitcnt_t)y._small);
+    }
+
+    friend checked_number operator>>(const checked_number& x, const checked_number& y) {
+        if (!x._big)
+            return y._small >= 63 ? (x._small < 0 ? -1 : 0) : x._small >> y._small;
+        return from_mpz(x.to_mpz() >> (mp_bitcnt_t)y._small);
+    }
+
+    checked_number& operator+=(const checked_number& y) { return *this = *this + y; }
+    checked_number& operator-=(const checked_number& y) { return *this = *this - y; }
+    checked_number& operator*=(const checked_number& y) { return *this = *this * y; }
+    checked_number& operator/=(const checked_number& y) { return *this = *this / y; }
+    checked_number& operator%=(const checked_number& y) { return *this = *this % y; }
+    checked_number& operator++() { return *this += 1; }
+    checked_number& operator--() { return *this -= 1; }
+
+    friend int compare(const checked_number& x, const checked_number& y) {
+        if (!x._big && !y._big)
+            return x._small < y._small ? -1 : x._small > y._small;
+        return cmp(x.to_mpz(), y.to_mpz());
+    }
+
+    friend bool operator==(const checked_number& x, const checked_number& y) { return compare(x, y) == 0; }
+    friend bool operator!=(const checked_number& x, const checked_number& y) { return compare(x, y) != 0; }
+    friend bool operator<(const checked_number& x, const checked_number& y) { return compare(x, y) < 0; }
+    friend bool operator<=(const checked_number& x, const checked_number& y) { return compare(x, y) <= 0; }
+    friend bool operator>(const checked_number& x, const checked_number& y) { return compare(x, y) > 0; }
+    friend bool operator>=(const checked_number& x, const checked_number& y) { return compare(x, y) >= 0; }
+
+    friend std::ostream& operator<<(std::ostream& o, const checked_number& x) { return o << x.get_str(); }
+};
+
+inline size_t hash_value(const checked_number& n) { return n.hash(); }
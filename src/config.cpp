@@ -5,5 +5,19 @@ global_options_t global_options {
     .check_semantic_reachability = false,
     .print_invariants = false,
     .print_failures = false,
-    .liveness = true
+    .liveness = true,
+    .stack_gc = true,
+    .precheck = true,
+    .fuzz_runs = 0,
+    .drop_redundant_assertions = true,
+    .check_jobs = 1,
+    .write_certificate = false,
+    .check_certificate = false,
+    .memory_saving = false,
+    .telemetry = false,
+    .pack = false,
+    .max_pack_size = 8,
+    .widening_thresholds = false,
+    .adaptive_widening = false,
+    .max_set_size = 32
 };
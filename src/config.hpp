@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 // defaults are in definition
 struct global_options_t
 {
@@ -11,6 +13,24 @@ struct global_options_t
     bool print_all_checks;
     bool print_all_checks_verbose;  
     bool liveness;
+    bool stack_gc;
+    bool precheck;
+    int fuzz_runs;
+    bool drop_redundant_assertions;
+    int check_jobs;
+    bool write_certificate;
+    bool check_certificate;
+    bool memory_saving;
+    bool telemetry;
+    bool pack;
+    int max_pack_size;
+    bool widening_thresholds;
+    bool adaptive_widening;
+    int max_set_size;
+    std::string certificate_file;
+    std::string warm_start_file;
+    std::string profile_file;
+    std::string telemetry_file;
 };
 
 extern global_options_t global_options;
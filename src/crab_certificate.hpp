@@ -0,0 +1,247 @@
+#pragma once
+
+/**
+ *  Invariant certificates.
+ *
+ *  A certificate is the table of per-block pre-invariants of a successful
+ *  analysis, stored as linear constraint systems. Checking a certificate does
+ *  not trust it: the table is accepted only if it contains the initial state
+ *  and is closed under one application of each block's transfer function, in
+ *  which case it is a post-fixpoint and the assertions can be checked against
+ *  it directly.
+ *
+ *  The scalars of array cells are stored by array segment rather than by
+ *  name, so the domain must be able to map cells back and forth (see
+ *  array_expansion_domain::get_cell_segment).
+ **/
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "crab_common.hpp"
+#include "crab_checker.hpp"
+
+namespace certificate {
+
+constexpr char MAGIC[8] = {'E', 'B', 'P', 'F', 'C', 'E', 'R', 'T'};
+constexpr uint32_t VERSION = 1;
+
+using number_t = ikos::z_number;
+using var_t = crab::variable<number_t, varname_t>;
+using lin_exp_t = ikos::linear_expression<number_t, varname_t>;
+using lin_cst_t = ikos::linear_constraint<number_t, varname_t>;
+using lin_cst_sys_t = ikos::linear_constraint_system<number_t, varname_t>;
+
+/** Compact binary encoding. Numbers that fit in 64 bits take 9 bytes. */
+class writer {
+    std::ofstream out;
+
+public:
+    explicit writer(const std::string& path) : out(path, std::ios::binary) {}
+    bool good() const { return out.good(); }
+
+    void u8(uint8_t v) { out.put((char)v); }
+    void u32(uint32_t v) { out.write((const char*)&v, sizeof(v)); }
+    void u64(uint64_t v) { out.write((const char*)&v, sizeof(v)); }
+    void str(const std::string& s) {
+        u32(s.size());
+        out.write(s.data(), s.size());
+    }
+    void number(const number_t& n) {
+        if (n.fits_int64()) {
+            u8(0);
+            u64((uint64_t)(int64_t)n);
+        } else {
+            u8(1);
+            str(n.get_str());
+        }
+    }
+};
+
+class reader {
+    std::ifstream in;
+
+public:
+    explicit reader(const std::string& path) : in(path, std::ios::binary) {}
+    bool good() const { return in.good(); }
+
+    uint8_t u8() { return (uint8_t)in.get(); }
+    uint32_t u32() { uint32_t v = 0; in.read((char*)&v, sizeof(v)); return v; }
+    uint64_t u64() { uint64_t v = 0; in.read((char*)&v, sizeof(v)); return v; }
+    std::string str() {
+        std::string s(u32(), '\0');
+        in.read(s.data(), s.size());
+        return s;
+    }
+    number_t number() {
+        if (u8() == 0)
+            return number_t((int64_t)u64());
+        return number_t(str());
+    }
+};
+
+enum var_tag : uint8_t { SCALAR = 0, CELL = 1 };
+
+/** Write a table of invariants to path. The keys are usually block labels. */
+template <typename dom_t>
+bool write(const std::string& path, const std::string& domain, const std::map<std::string, dom_t>& pre)
+{
+    // variables are numbered in order of first occurrence
+    std::vector<var_t> vars;
+    std::map<ikos::index_t, uint32_t> var_ids;
+    std::map<std::string, lin_cst_sys_t> csts;
+    for (const auto& [label, inv] : pre) {
+        if (inv.is_bottom())
+            continue;
+        dom_t tmp = inv;
+        lin_cst_sys_t sys = tmp.to_linear_constraint_system();
+        for (const lin_cst_t& cst : sys) {
+            for (auto it = cst.expression().begin(); it != cst.expression().end(); ++it) {
+                if (var_ids.emplace(it->second.index(), vars.size()).second)
+                    vars.push_back(it->second);
+            }
+        }
+        csts.emplace(label, sys);
+    }
+
+    writer w(path);
+    if (!w.good())
+        return false;
+    for (char c : MAGIC)
+        w.u8(c);
+    w.u32(VERSION);
+    w.str(domain);
+
+    w.u32(vars.size());
+    for (const var_t& v : vars) {
+        if (auto seg = dom_t::get_cell_segment(v)) {
+            auto [a, offset, size] = *seg;
+            w.u8(CELL);
+            w.str(a.name().str());
+            w.u64(offset);
+            w.u64(size);
+        } else {
+            w.u8(SCALAR);
+            w.str(v.name().str());
+            w.u32(v.get_type().get_integer_bitwidth());
+        }
+    }
+
+    w.u32(pre.size());
+    for (const auto& [label, inv] : pre) {
+        w.str(label);
+        auto it = csts.find(label);
+        w.u8(it == csts.end());
+        if (it == csts.end())
+            continue;
+        w.u32(it->second.size());
+        for (const lin_cst_t& cst : it->second) {
+            const lin_exp_t& e = cst.expression();
+            w.u8(cst.is_equality() ? 0 : cst.is_disequation() ? 1 : cst.is_strict_inequality() ? 3 : 2);
+            w.number(e.constant());
+            w.u32(e.size());
+            for (auto t = e.begin(); t != e.end(); ++t) {
+                w.number(t->first);
+                w.u32(var_ids.at(t->second.index()));
+            }
+        }
+    }
+    return w.good();
+}
+
+/** Read a certificate for the given domain. Returns nothing if the file is
+ *  missing, malformed, or was produced with another domain.
+ */
+template <typename dom_t>
+std::optional<std::map<std::string, dom_t>>
+read(const std::string& path, const std::string& domain, variable_factory_t& vfac)
+{
+    reader r(path);
+    if (!r.good())
+        return {};
+    for (char c : MAGIC)
+        if (r.u8() != (uint8_t)c)
+            return {};
+    if (r.u32() != VERSION || r.str() != domain)
+        return {};
+
+    std::vector<var_t> vars;
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); i++) {
+        if (r.u8() == CELL) {
+            var_t a{vfac[r.str()], crab::ARR_INT_TYPE, 64};
+            uint64_t offset = r.u64();
+            uint64_t size = r.u64();
+            vars.push_back(dom_t::get_cell_scalar(a, offset, size));
+        } else {
+            std::string name = r.str();
+            vars.push_back(var_t{vfac[name], crab::INT_TYPE, r.u32()});
+        }
+    }
+
+    std::map<std::string, dom_t> res;
+    for (uint32_t i = 0, n = r.u32(); i < n && r.good(); i++) {
+        std::string label = r.str();
+        dom_t inv;
+        if (r.u8()) {
+            inv.set_to_bottom();
+            res.emplace(label, inv);
+            continue;
+        }
+        lin_cst_sys_t sys;
+        for (uint32_t j = 0, m = r.u32(); j < m && r.good(); j++) {
+            uint8_t kind = r.u8();
+            lin_exp_t e(r.number());
+            for (uint32_t k = 0, terms = r.u32(); k < terms && r.good(); k++) {
+                number_t coef = r.number();
+                uint32_t id = r.u32();
+                if (id >= vars.size())
+                    return {};
+                e = e + coef * vars[id];
+            }
+            switch (kind) {
+            case 0: sys += lin_cst_t(e, lin_cst_t::EQUALITY); break;
+            case 1: sys += lin_cst_t(e, lin_cst_t::DISEQUATION); break;
+            case 2: sys += lin_cst_t(e, lin_cst_t::INEQUALITY); break;
+            default: sys += lin_cst_t(e, lin_cst_t::STRICT_INEQUALITY); break;
+            }
+        }
+        inv += sys;
+        res.emplace(label, inv);
+    }
+    if (!r.good())
+        return {};
+    return res;
+}
+
+/** A table is a valid certificate if it covers the initial state and each
+ *  block's post-invariant is included in the pre-invariants of its successors.
+ *  Every block is transferred exactly once.
+ */
+template <typename dom_t>
+bool is_inductive(cfg_t& cfg, const std::map<basic_block_label_t, dom_t>& pre)
+{
+    dom_t init;
+    auto entry = pre.find(cfg.entry());
+    if (entry == pre.end() || !(init <= entry->second))
+        return false;
+    for (auto& bb : cfg) {
+        auto it = pre.find(bb.label());
+        if (it == pre.end())
+            return false;
+        if (it->second.is_bottom())
+            continue;
+        dom_t post = transfer_block<dom_t>(bb, it->second);
+        auto [succ, end] = bb.next_blocks();
+        for (; succ != end; ++succ) {
+            auto s = pre.find(*succ);
+            if (s == pre.end() || !(post <= s->second))
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace certificate
@@ -0,0 +1,222 @@
+#pragma once
+
+/**
+ *  Checking assertions against a table of stable pre-invariants.
+ *
+ *  Once the fixpoint is reached, checking a block needs only its
+ *  pre-invariant and its statements, so blocks are checked independently and
+ *  can be sharded across workers. Workers are forked processes rather than
+ *  threads: the numerical domains, the array domain and the variable factory
+ *  all mutate global state while evaluating transfer functions, and a forked
+ *  worker gets its own copy of it.
+ **/
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <crab/analysis/abs_transformer.hpp>
+#include <crab/checkers/base_property.hpp>
+#include <crab/support/os.hpp>
+
+#include "config.hpp"
+#include "crab_common.hpp"
+
+/** The outcome of one assert statement, as produced by a worker. */
+struct check_record {
+    size_t block;  // position of the block in the checking order
+    int kind;      // crab::checker::check_kind_t
+    std::string file;
+    unsigned int line;
+    unsigned int col;
+    std::string message;
+};
+
+template <typename dom_t>
+using pre_invariant_t = std::function<dom_t(const basic_block_label_t&)>;
+
+/** Apply the transfer functions of a block to its pre-invariant. */
+template <typename dom_t>
+dom_t transfer_block(basic_block_t& bb, dom_t pre)
+{
+    using abs_tr_t = crab::analyzer::intra_abs_transformer<basic_block_t, dom_t>;
+    abs_tr_t tr(pre);
+    for (auto& stmt : bb)
+        stmt.accept(&tr);
+    return tr.get_abs_value();
+}
+
+/** Evaluate the assert statements of a block, starting from its pre-invariant.
+ *
+ *  Mirrors crab's assert_property_checker: an assertion that was checked is
+ *  then assumed for the rest of the block.
+ */
+template <typename dom_t>
+static void check_block(basic_block_t& bb, size_t index, dom_t pre, std::vector<check_record>& out)
+{
+    using namespace crab::checker;
+    using abs_tr_t = crab::analyzer::intra_abs_transformer<basic_block_t, dom_t>;
+    using assert_t = typename basic_block_t::assert_t;
+
+    const bool verbose = global_options.print_failures || global_options.print_all_checks_verbose;
+    abs_tr_t tr(pre);
+    for (auto& stmt : bb) {
+        if (stmt.is_assert()) {
+            auto& s = static_cast<assert_t&>(stmt);
+            auto cst = s.constraint();
+            dom_t& inv = tr.get_abs_value();
+
+            check_kind_t kind;
+            if (cst.is_tautology()) {
+                kind = _SAFE;
+            } else if (inv.is_bottom()) {
+                kind = _UNREACH;
+            } else if (cst.is_contradiction()) {
+                kind = _ERR;
+            } else if (crab::domains::checker_domain_traits<dom_t>::entail(inv, cst)) {
+                kind = _SAFE;
+            } else if (crab::domains::checker_domain_traits<dom_t>::intersect(inv, cst)) {
+                kind = _WARN;
+            } else {
+                kind = _ERR;
+            }
+
+            std::string message;
+            if (verbose && (kind == _WARN || kind == _ERR || global_options.print_all_checks_verbose)) {
+                crab::crab_string_os os;
+                os << "Property : " << cst << "\n"
+                   << "Invariant: " << inv << "\n"
+                   << "Note: it " << (kind == _SAFE ? "holds" : kind == _WARN ? "may not hold" : "does not hold")
+                   << "\n";
+                message = os.str();
+            }
+            const auto& di = s.get_debug_info();
+            out.push_back(check_record{index, kind, di.get_file(), (unsigned int)di.get_line(),
+                                       (unsigned int)di.get_column(), message});
+        }
+        stmt.accept(&tr);
+    }
+}
+
+inline void write_all(int fd, const void* buf, size_t len)
+{
+    auto p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) _exit(2);
+        p += n;
+        len -= n;
+    }
+}
+
+inline bool read_all(int fd, void* buf, size_t len)
+{
+    auto p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+inline void write_record(int fd, const check_record& r)
+{
+    uint64_t header[6] = {r.block, (uint64_t)r.kind, r.line, r.col, r.file.size(), r.message.size()};
+    write_all(fd, header, sizeof(header));
+    write_all(fd, r.file.data(), r.file.size());
+    write_all(fd, r.message.data(), r.message.size());
+}
+
+inline bool read_record(int fd, check_record& r)
+{
+    uint64_t header[6];
+    if (!read_all(fd, header, sizeof(header))) return false;
+    r.block = header[0];
+    r.kind = (int)header[1];
+    r.line = (unsigned int)header[2];
+    r.col = (unsigned int)header[3];
+    r.file.resize(header[4]);
+    r.message.resize(header[5]);
+    return read_all(fd, r.file.data(), r.file.size())
+        && read_all(fd, r.message.data(), r.message.size());
+}
+
+/** Check every assert statement of the given blocks.
+ *
+ *  Blocks are assigned round-robin to `jobs` workers. The results are merged
+ *  in the order of `labels`, so the resulting checks_db and the printed
+ *  messages do not depend on the number of workers.
+ */
+template <typename dom_t>
+crab::checker::checks_db check_invariants(cfg_t& cfg, const std::vector<basic_block_label_t>& labels,
+                                          pre_invariant_t<dom_t> get_pre, int jobs)
+{
+    std::vector<check_record> records;
+    if (jobs <= 1 || labels.size() < 2) {
+        for (size_t i = 0; i < labels.size(); i++)
+            check_block<dom_t>(cfg.get_node(labels[i]), i, get_pre(labels[i]), records);
+    } else {
+        jobs = std::min<size_t>(jobs, labels.size());
+        std::cout.flush();
+        std::cerr.flush();
+        std::vector<std::tuple<pid_t, int>> workers;
+        for (int w = 0; w < jobs; w++) {
+            int fds[2];
+            if (pipe(fds) != 0)
+                throw std::runtime_error(std::string("pipe: ") + strerror(errno));
+            pid_t pid = fork();
+            if (pid < 0)
+                throw std::runtime_error(std::string("fork: ") + strerror(errno));
+            if (pid == 0) {
+                close(fds[0]);
+                try {
+                    std::vector<check_record> mine;
+                    for (size_t i = w; i < labels.size(); i += jobs)
+                        check_block<dom_t>(cfg.get_node(labels[i]), i, get_pre(labels[i]), mine);
+                    for (const auto& r : mine)
+                        write_record(fds[1], r);
+                } catch (...) {
+                    _exit(1);
+                }
+                close(fds[1]);
+                _exit(0);
+            }
+            close(fds[1]);
+            workers.emplace_back(pid, fds[0]);
+        }
+        bool failed = false;
+        for (auto [pid, fd] : workers) {
+            check_record r;
+            while (read_record(fd, r))
+                records.push_back(r);
+            close(fd);
+            int status;
+            waitpid(pid, &status, 0);
+            failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+        if (failed)
+            throw std::runtime_error("assertion checking worker failed");
+        std::stable_sort(records.begin(), records.end(),
+                         [](const check_record& a, const check_record& b) { return a.block < b.block; });
+    }
+
+    crab::checker::checks_db db;
+    for (const auto& r : records) {
+        if (!r.message.empty())
+            crab::outs() << r.message;
+        db.add((crab::checker::check_kind_t)r.kind, crab::cfg::debug_info{r.file, r.line, r.col, 0});
+    }
+    return db;
+}
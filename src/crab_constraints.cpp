@@ -20,6 +20,7 @@
 
 #include "asm_syntax.hpp"
 #include "asm_cfg.hpp"
+#include "stack_liveness.hpp"
 
 using std::tuple;
 using std::string;
@@ -55,6 +56,7 @@ static basic_block_t& add_child(cfg_t& cfg, basic_block_t& block, std::string su
 using crab::cfg::debug_info;
 
 using var_t     = crab::variable<ikos::z_number, varname_t>;
+using var_or_cst_t = crab::variable_or_constant<ikos::z_number, varname_t>;
 using lin_cst_t = ikos::linear_constraint<ikos::z_number, varname_t>;
 
 /** Encoding of memory regions and types.
@@ -228,6 +230,23 @@ struct array_dom_t {
             return {&block};
         }
     }
+
+    /** Drop the cells over the bytes [lb, ub) of each range, which are dead.
+     *
+     * The "forget_cells" intrinsic takes the three arrays followed by the
+     * bounds of the ranges. Domains that do not know it keep the cells, which
+     * is only less efficient.
+     */
+    void forget(basic_block_t& block, const vector<std::pair<int, int>>& ranges) {
+        if (ranges.empty())
+            return;
+        vector<var_or_cst_t> inputs{values, offsets, regions};
+        for (auto [lb, ub] : ranges) {
+            inputs.emplace_back(ikos::z_number(lb), crab::variable_type(crab::INT_TYPE, 64));
+            inputs.emplace_back(ikos::z_number(ub), crab::variable_type(crab::INT_TYPE, 64));
+        }
+        block.intrinsic("forget_cells", inputs, {});
+    }
 };
 
 struct machine_t final
@@ -324,7 +343,8 @@ private:
  * Each instruction is translated to a tree of Crab instructions, which are then
  * joined together.
  */
-void build_crab_cfg(cfg_t& cfg, variable_factory_t& vfac, Cfg const& simple_cfg, program_info info)
+void build_crab_cfg(cfg_t& cfg, variable_factory_t& vfac, Cfg const& simple_cfg, program_info info,
+                    bool forget_dead_stack)
 {
     machine_t machine(vfac, info);
     {
@@ -332,9 +352,14 @@ void build_crab_cfg(cfg_t& cfg, variable_factory_t& vfac, Cfg const& simple_cfg,
         machine.setup_entry(entry);
         entry >> cfg.insert(label(0));
     }
+    optional<stack_liveness> stack_live;
+    if (forget_dead_stack)
+        stack_live.emplace(simple_cfg);
     for (auto const& this_label : simple_cfg.keys()) {
         auto const& bb = simple_cfg.at(this_label);
         basic_block_t* exit = &cfg.insert(this_label);
+        if (stack_live)
+            machine.stack_arr.forget(*exit, stack_live->dead_ranges(this_label));
         if (bb.insts.size() > 0) {
             int iteration = 0;
             string label = this_label;
@@ -20,5 +20,9 @@ inline int first_num(const Label& s)
 }
 
 /** Translate an eBPF Cfg to to Crab's cfg_t.
+ *
+ *  If forget_dead_stack, each block starts by dropping the stack cells that
+ *  are no longer read, which only the domains in forgets_cells act on.
  */
-void build_crab_cfg(cfg_t& cfg, variable_factory_t& vfac, Cfg const& simple_cfg, program_info info);
+void build_crab_cfg(cfg_t& cfg, variable_factory_t& vfac, Cfg const& simple_cfg, program_info info,
+                    bool forget_dead_stack);
@@ -14,6 +14,11 @@
 #include <crab/domains/term_equiv.hpp>
 #include <crab/domains/generic_abstract_domain.hpp>
 #include "array_expansion.hpp"
+#include "region_domain.hpp"
+#include "dense_zone_domain.hpp"
+#include "native_number_domain.hpp"
+#include "packed_domain.hpp"
+#include "stack_array_domain.hpp"
 #include <crab/domains/array_adaptive.hpp>
 #include <crab/support/debug.hpp>
 #include <crab/types/varname_factory.hpp>
@@ -53,6 +58,18 @@ using z_num_domain_t = reduced_numerical_domain_product2<z_term_dis_int_t,z_sdbm
 							 reduced_product_impl::term_dbm_params>;
 using z_num_boxes_domain_t = reduced_numerical_domain_product2<z_boxes_domain_t,z_sdbm_domain_t>;
 using z_wrapped_interval_domain_t = wrapped_interval_domain<ikos::z_number, varname_t>;
+using z_sdbm_tags_domain_t = region_domain<z_sdbm_domain_t>;
+using z_dense_dbm_domain_t = dense_zone_domain<z_sdbm_domain_t>;
+
+// Numerical domains over machine integers, promoted to GMP on overflow
+using n_interval_domain_t = native_number_domain<ikos::interval_domain<checked_number,varname_t>>;
+using n_sdbm_domain_t = native_number_domain<split_dbm_domain<checked_number,varname_t,DBMGraphParams>>;
+
+// Relational domains restricted to variable packs, intervals elsewhere
+using z_packed_sdbm_domain_t = packed_domain<z_sdbm_domain_t>;
+using z_packed_soct_domain_t = packed_domain<z_soct_domain_t>;
+using z_packed_pk_apron_domain_t = packed_domain<z_pk_apron_domain_t>;
+using z_packed_pk_elina_domain_t = packed_domain<z_pk_elina_domain_t>;
   
 // Array domain
 #ifdef USE_ARRAY_ADAPTIVE
@@ -64,5 +81,29 @@ using array_domain = array_adaptive_domain<Dom>;
 template<typename Dom>
 using array_domain = array_expansion_domain<Dom>;    
 #endif 
+
+// Array domain with a fixed layout over the eBPF stack
+template<typename Dom>
+using stack_domain = stack_array_domain<Dom>;
+
+// Array domains that implement the "forget_cells" intrinsic
+template<typename ArrayDom>
+constexpr bool forgets_cells = false;
+template<typename Dom>
+constexpr bool forgets_cells<array_expansion_domain<Dom>> = true;
+template<typename Dom>
+constexpr bool forgets_cells<stack_array_domain<Dom>> = true;
+
+// Clears the global state that the domains of this tree keep between
+// analyses, for a domain and the domains it is built on. The state of the
+// array adaptive domain itself is kept.
+template<typename Dom>
+struct global_state {
+  static void clear() { special_domain_traits<Dom>::clear_global_state(); }
+};
+template<typename Dom>
+struct global_state<array_adaptive_domain<Dom>> {
+  static void clear() { global_state<Dom>::clear(); }
+};
 } 
 }
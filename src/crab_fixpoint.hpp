@@ -0,0 +1,342 @@
+#pragma once
+
+/**
+ *  A forward fixpoint engine over Crab's cfg_t, used instead of crab's
+ *  analyzer when the iteration itself needs to be controlled.
+ *
+ *  It follows the recursive iteration strategy over a weak topological
+ *  ordering: components are visited in order, and a cycle is iterated until
+ *  the invariant at its head is stable, joining for the first
+ *  `widening_delay` iterations and widening afterwards. The head is then
+ *  refined by a bounded number of narrowing iterations.
+ *
+ *  Widening goes to the next of `thresholds` before going to infinity. With
+ *  `adaptive_delay`, a head keeps joining past `widening_delay`, up to
+ *  `max_widening_delay` iterations, as long as each iteration changes fewer
+ *  of its constraints than the previous one: such a loop is converging on its
+ *  own, and widening it would only lose precision.
+ *
+ *  A head can be seeded with a candidate invariant, e.g. one computed for a
+ *  previous version of the program. The seed only changes where the
+ *  iteration starts: a cycle is left only once its head invariant includes
+ *  everything flowing into it, so the result is a post-fixpoint whatever the
+ *  seed was.
+ *
+ *  Unless `retain_all` is set, pre-invariants are kept only at cut points:
+ *  the entry, WTO heads and blocks that do not have exactly one predecessor.
+ *  Every other block starts with the post-invariant of its only predecessor,
+ *  so its pre-invariant is recomputed on demand by replaying the transfer
+ *  functions from the nearest cut point. Post-invariants are dropped as soon
+ *  as the iteration no longer needs them.
+ *
+ *  If `profile` is set, per-block iteration counts and times are recorded.
+ *  If `telemetry` is set, the size of the post-states is sampled into it.
+ **/
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "crab_common.hpp"
+#include "crab_checker.hpp"
+#include "fixpoint_profile.hpp"
+#include "state_telemetry.hpp"
+#include "wto.hpp"
+
+struct fixpoint_params {
+    unsigned int widening_delay = 1;
+    unsigned int descending_iterations = 2;
+    std::vector<int64_t> thresholds;
+    bool adaptive_delay = false;
+    unsigned int max_widening_delay = 8;
+    bool retain_all = true;
+    bool profile = false;
+    state_telemetry* telemetry = nullptr;
+};
+
+/** Size of an abstract state, measured on its linear constraints. Array
+ *  cells are recognized by their names, "A[o]" or "A[o...e]".
+ */
+template <typename dom_t>
+state_size measure_state(dom_t inv)
+{
+    state_size res;
+    if (inv.is_bottom())
+        return res;
+    std::set<ikos::index_t> vars;
+    for (const auto& cst : inv.to_linear_constraint_system()) {
+        res.constraints++;
+        for (auto it = cst.expression().begin(); it != cst.expression().end(); ++it) {
+            if (vars.insert(it->second.index()).second && it->second.name().str().find('[') != std::string::npos)
+                res.cells++;
+        }
+    }
+    res.variables = vars.size();
+    return res;
+}
+
+/** Number of linear constraints of inv that joined does not entail. */
+template <typename dom_t>
+size_t unstable_constraints(dom_t inv, dom_t joined)
+{
+    size_t res = 0;
+    for (const auto& cst : inv.to_linear_constraint_system()) {
+        if (!crab::domains::checker_domain_traits<dom_t>::entail(joined, cst))
+            res++;
+    }
+    return res;
+}
+
+template <typename dom_t>
+class fixpoint_iterator {
+    using label_t = basic_block_label_t;
+    using component_t = WtoComponent<label_t>;
+    using number_t = typename dom_t::number_t;
+
+    cfg_t& cfg;
+    Wto<label_t> wto;
+    fixpoint_params params;
+    crab::thresholds<number_t> jump_set;
+    std::map<label_t, dom_t> pre;
+    std::map<label_t, dom_t> post;
+    std::map<label_t, dom_t> seeds;
+    dom_t init;
+
+    std::set<label_t> cut_points;
+    // blocks whose post-invariant is last read by the component at a position
+    std::multimap<size_t, label_t> last_uses;
+    mutable std::optional<std::pair<label_t, dom_t>> replayed;
+    std::map<label_t, block_profile> profiles;
+
+    using clock_type = std::chrono::steady_clock;
+
+    static double seconds_since(clock_type::time_point start) {
+        return std::chrono::duration<double>(clock_type::now() - start).count();
+    }
+
+    static dom_t bottom() {
+        dom_t res;
+        res.set_to_bottom();
+        return res;
+    }
+
+    static std::vector<label_t> successors(cfg_t& cfg, const label_t& label) {
+        std::vector<label_t> res;
+        auto [it, end] = cfg.get_node(label).next_blocks();
+        for (; it != end; ++it)
+            res.push_back(*it);
+        return res;
+    }
+
+    dom_t join_predecessors(const label_t& label) {
+        auto start = params.profile ? clock_type::now() : clock_type::time_point{};
+        dom_t res = label == cfg.entry() ? init : bottom();
+        auto [it, end] = cfg.get_node(label).prev_blocks();
+        for (; it != end; ++it) {
+            auto p = post.find(*it);
+            if (p != post.end())
+                res |= p->second;
+        }
+        if (params.profile)
+            profiles[label].join_time += seconds_since(start);
+        return res;
+    }
+
+    void transfer(const label_t& label, dom_t inv) {
+        if (params.profile) {
+            auto start = clock_type::now();
+            post[label] = transfer_block<dom_t>(cfg.get_node(label), inv);
+            block_profile& p = profiles[label];
+            p.transfer_time += seconds_since(start);
+            p.visits++;
+        } else {
+            post[label] = transfer_block<dom_t>(cfg.get_node(label), inv);
+        }
+        if (params.telemetry)
+            params.telemetry->visit(label, [&] { return measure_state(post[label]); });
+        if (params.retain_all || cut_points.count(label))
+            pre[label] = std::move(inv);
+    }
+
+    void visit_component(const component_t& c) {
+        if (c.is_cycle)
+            visit_cycle(c);
+        else
+            transfer(c.head, join_predecessors(c.head));
+    }
+
+    void visit(const std::vector<component_t>& components) {
+        for (const component_t& c : components)
+            visit_component(c);
+    }
+
+    /** Once the top-level components before `position` are done, the posts
+     *  read only by them are dead. */
+    void release_posts(size_t position) {
+        auto end = last_uses.lower_bound(position);
+        for (auto it = last_uses.begin(); it != end; ++it)
+            post.erase(it->second);
+        last_uses.erase(last_uses.begin(), end);
+    }
+
+    void index_cut_points() {
+        for (auto& bb : cfg) {
+            const label_t& label = bb.label();
+            if (!wto.contains(label))
+                continue;
+            auto [pred, pred_end] = bb.prev_blocks();
+            bool single_pred = pred != pred_end && std::next(pred) == pred_end;
+            if (label == cfg.entry() || wto.is_head(label) || !single_pred)
+                cut_points.insert(label);
+        }
+    }
+
+    void index_last_uses() {
+        last_uses.clear();
+        for (auto& bb : cfg) {
+            const label_t& label = bb.label();
+            if (!wto.contains(label))
+                continue;
+            size_t last = wto.position(label);
+            for (const label_t& succ : successors(cfg, label))
+                last = std::max(last, wto.position(succ));
+            last_uses.emplace(last, label);
+        }
+    }
+
+    label_t only_predecessor(const label_t& label) const {
+        return *cfg.get_node(label).prev_blocks().first;
+    }
+
+    dom_t widen(const dom_t& inv, const dom_t& next) const {
+        if (params.thresholds.empty())
+            return inv || next;
+        return inv.widening_thresholds(next, jump_set);
+    }
+
+    void visit_cycle(const component_t& cycle) {
+        const label_t& head = cycle.head;
+        dom_t inv = join_predecessors(head);
+        auto seed = seeds.find(head);
+        if (seed != seeds.end())
+            inv |= seed->second;
+
+        unsigned int delay = params.widening_delay;
+        size_t last_unstable = SIZE_MAX;
+        for (unsigned int iteration = 1;; iteration++) {
+            transfer(head, inv);
+            visit(cycle.body);
+            dom_t next = join_predecessors(head);
+            if (next <= inv)
+                break;
+            std::optional<dom_t> joined;
+            if (params.adaptive_delay && iteration < params.max_widening_delay) {
+                joined = inv | next;
+                size_t unstable = unstable_constraints(inv, *joined);
+                if (iteration > delay && unstable < last_unstable) {
+                    delay = iteration;
+                    if (params.profile)
+                        profiles[head].delays++;
+                }
+                last_unstable = unstable;
+            }
+            if (iteration <= delay) {
+                inv = joined ? std::move(*joined) : inv | next;
+            } else {
+                inv = widen(inv, next);
+                if (params.profile)
+                    profiles[head].widenings++;
+            }
+        }
+
+        for (unsigned int iteration = 0; iteration < params.descending_iterations; iteration++) {
+            dom_t next = inv && join_predecessors(head);
+            if (inv <= next)
+                break;
+            inv = next;
+            if (params.profile)
+                profiles[head].narrowings++;
+            transfer(head, inv);
+            visit(cycle.body);
+        }
+    }
+
+public:
+    fixpoint_iterator(cfg_t& cfg, fixpoint_params params = {})
+        : cfg(cfg), wto(cfg.entry(), [&cfg](const label_t& l) { return successors(cfg, l); }), params(params),
+          jump_set(params.thresholds.size()) {
+        for (int64_t c : params.thresholds)
+            jump_set.add(ikos::bound<number_t>(number_t(c)));
+        if (!params.retain_all)
+            index_cut_points();
+    }
+
+    const Wto<label_t>& get_wto() const { return wto; }
+
+    /** Start the iteration of the cycle headed by `head` from `inv`. */
+    void seed(const label_t& head, dom_t inv) { seeds.insert_or_assign(head, std::move(inv)); }
+
+    void run(dom_t init) {
+        this->init = std::move(init);
+        pre.clear();
+        post.clear();
+        replayed.reset();
+        profiles.clear();
+        if (params.retain_all) {
+            visit(wto.get_components());
+        } else {
+            index_last_uses();
+            const auto& components = wto.get_components();
+            for (size_t i = 0; i < components.size(); i++) {
+                visit_component(components[i]);
+                release_posts(i + 1 < components.size() ? wto.position(components[i + 1].head) : SIZE_MAX);
+            }
+        }
+        seeds.clear();
+    }
+
+    /** Counts of the last run; empty unless profiling. */
+    const std::map<label_t, block_profile>& get_profile() const { return profiles; }
+
+    /** Number of blocks whose pre-invariant is stored. */
+    size_t retained() const { return pre.size(); }
+
+    dom_t get_pre(const label_t& label) const {
+        auto it = pre.find(label);
+        if (it != pre.end())
+            return it->second;
+        if (params.retain_all || !wto.contains(label))
+            return bottom();
+        if (replayed && replayed->first == label)
+            return replayed->second;
+
+        // walk back to a block whose pre-invariant is known, then replay
+        std::vector<label_t> chain;
+        label_t source = label;
+        while (!pre.count(source) && !(replayed && replayed->first == source)) {
+            chain.push_back(source);
+            source = only_predecessor(source);
+        }
+        dom_t inv = pre.count(source) ? pre.at(source) : replayed->second;
+        inv = transfer_block<dom_t>(cfg.get_node(source), inv);
+        for (size_t i = chain.size(); i-- > 1;)
+            inv = transfer_block<dom_t>(cfg.get_node(chain[i]), inv);
+        replayed.emplace(label, inv);
+        return inv;
+    }
+
+    dom_t get_post(const label_t& label) const {
+        auto it = post.find(label);
+        if (it != post.end())
+            return it->second;
+        if (params.retain_all || !wto.contains(label))
+            return bottom();
+        return transfer_block<dom_t>(cfg.get_node(label), get_pre(label));
+    }
+};
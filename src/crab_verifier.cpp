@@ -4,15 +4,22 @@
  **/
 #include <inttypes.h>
 #include <assert.h>
+#include <ctype.h>
 
 #include <vector>
 #include <string>
 #include <functional>
 #include <tuple>
 #include <map>
+#include <set>
+#include <sstream>
 #include <ctime>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
 
+#include <boost/functional/hash.hpp>
 #include <boost/signals2.hpp>
 
 #include <crab/checkers/base_property.hpp>
@@ -23,11 +30,19 @@
 
 #include "config.hpp"
 #include "asm_cfg.hpp"
+#include "asm_ostream.hpp"
 
 #include "crab_domains.hpp"
 #include "crab_common.hpp"
 #include "crab_constraints.hpp"
+#include "crab_checker.hpp"
+#include "crab_certificate.hpp"
+#include "crab_fixpoint.hpp"
+#include "fixpoint_profile.hpp"
+#include "state_telemetry.hpp"
 #include "crab_verifier.hpp"
+#include "packing.hpp"
+#include "widening_thresholds.hpp"
 
 
 using std::string;
@@ -42,7 +57,9 @@ using namespace crab::analyzer;
 using namespace crab::domains;
 using namespace crab::domain_impl;
 
-static checks_db analyze(string domain_name, bool run_backward, cfg_t& cfg, printer_t& pre_printer, printer_t& post_printer);
+static checks_db analyze(string domain_name, bool run_backward, cfg_t& cfg, Cfg const& simple_cfg,
+                         variable_factory_t& vfac, printer_t& pre_printer, printer_t& post_printer);
+static bool forget_dead_stack(const string& domain_name, bool run_backward);
 
 static vector<string> sorted_labels(cfg_t& cfg)
 {
@@ -58,11 +75,43 @@ static vector<string> sorted_labels(cfg_t& cfg)
     return labels;
 }
 
+/** The label of the eBPF block a Crab block was translated from: the longest
+ *  prefix of its label, up to a ':', that is one of ebpf_labels. Empty for
+ *  blocks that do not come from an instruction, like the entry.
+ */
+static string ebpf_block_of(const string& label, const std::set<string>& ebpf_labels)
+{
+    string prefix = label;
+    while (!prefix.empty() && !ebpf_labels.count(prefix)) {
+        auto colon = prefix.find_last_of(':');
+        prefix = colon == string::npos ? "" : prefix.substr(0, colon);
+    }
+    return prefix;
+}
+
+/** Index of the instruction a Crab block belongs to within its eBPF block.
+ *  build_crab_cfg labels the blocks of the i-th instruction (i > 0) with the
+ *  block label followed by ":i".
+ */
+static size_t instruction_index(const string& label, const string& ebpf_block)
+{
+    string suffix = label.substr(ebpf_block.size());
+    if (suffix.size() < 2 || suffix[0] != ':' || !isdigit(suffix[1]))
+        return 0;
+    return std::stoul(suffix.substr(1));
+}
+
+// thresholds of the program being analyzed, if --thresholds
+static vector<int64_t> program_thresholds;
+
 std::tuple<bool, double> abs_validate(Cfg const& simple_cfg, string domain_name, bool run_backward, program_info info)
 {
     variable_factory_t vfac;
     cfg_t cfg(entry_label());
-    build_crab_cfg(cfg, vfac, simple_cfg, info);
+    build_crab_cfg(cfg, vfac, simple_cfg, info, forget_dead_stack(domain_name, run_backward));
+    program_thresholds.clear();
+    if (global_options.widening_thresholds)
+        program_thresholds = collect_thresholds(simple_cfg, info);
     #if 0
     crab::cfg::type_checker<crab::cfg::cfg_ref<cfg_t>> tc(cfg);
     tc.run();
@@ -74,7 +123,7 @@ std::tuple<bool, double> abs_validate(Cfg const& simple_cfg, string domain_name,
     using namespace std;
     clock_t begin = clock();
 
-    checks_db checks = analyze(domain_name, run_backward, cfg, pre_printer, post_printer);
+    checks_db checks = analyze(domain_name, run_backward, cfg, simple_cfg, vfac, pre_printer, post_printer);
 
     clock_t end = clock();
     double elapsed_secs = double(end - begin) / CLOCKS_PER_SEC;
@@ -118,34 +167,16 @@ static auto extract_post(analyzer_t& analyzer)
     return res;
 }
 
-template<typename analyzer_t>
-static checks_db check(analyzer_t& analyzer)
-{
-    int verbose = 0;
-    if (global_options.print_failures)
-      verbose = 2;
-    if (global_options.print_all_checks_verbose)
-      verbose = 3;
-    
-    using checker_t = intra_checker<analyzer_t>;
-    using prop_checker_ptr = typename checker_t::prop_checker_ptr;
-    checker_t checker(analyzer, {
-        prop_checker_ptr(new assert_property_checker<analyzer_t>(verbose))
-    });
-    checker.run();
-    return checker.get_all_checks();
-}
-
-static checks_db dont_analyze(bool run_backward, cfg_t& cfg, printer_t& printer, printer_t& post_printer)
+static checks_db dont_analyze(bool run_backward, cfg_t& cfg, Cfg const& simple_cfg, printer_t& printer, printer_t& post_printer)
 {
     return {};
 }
 
-template<typename dom_t, typename analyzer_t>
-void check_semantic_reachability(cfg_t& cfg, analyzer_t& analyzer, checks_db& c)
+template<typename dom_t>
+void check_semantic_reachability(cfg_t& cfg, pre_invariant_t<dom_t> get_post, checks_db& c)
 {
     for (auto& b : cfg) {
-        dom_t post = analyzer.get_post(b.label());
+        dom_t post = get_post(b.label());
         if (post.is_bottom()) {
             if (b.label().find(':') == string::npos)
 	      c.add(_ERR, {"unreachable", (unsigned int)first_num(b.label()), 0, 0});
@@ -153,18 +184,129 @@ void check_semantic_reachability(cfg_t& cfg, analyzer_t& analyzer, checks_db& c)
     }
 }
 
+/** Attribute the profile of each Crab block to its eBPF instruction. */
+static vector<profile_entry> profile_entries(cfg_t& cfg, Cfg const& simple_cfg, const Wto<string>& wto,
+                                             const map<string, block_profile>& profiles)
+{
+    std::set<string> ebpf_labels(simple_cfg.keys().begin(), simple_cfg.keys().end());
+    vector<profile_entry> res;
+    for (const string& label : sorted_labels(cfg)) {
+        auto p = profiles.find(label);
+        if (p == profiles.end())
+            continue;
+        string block = ebpf_block_of(label, ebpf_labels);
+        size_t index = 0;
+        string kind = "entry";
+        if (!block.empty()) {
+            index = instruction_index(label, block);
+            const auto& insts = simple_cfg.at(block).insts;
+            kind = index < insts.size() ? instype(insts[index]) : "other";
+        }
+        res.push_back(profile_entry{label, first_num(label), index, kind, wto.nesting(label), p->second});
+    }
+    return res;
+}
+
+static void write_profile(const vector<profile_entry>& entries)
+{
+    const string& path = global_options.profile_file;
+    std::ofstream json(path);
+    write_profile_json(json, entries);
+    std::ofstream folded(path + ".folded");
+    write_profile_folded(folded, entries);
+    if (!json || !folded)
+        std::cerr << "could not write profile " << path << "\n";
+}
+
+static void write_telemetry(const state_telemetry& telemetry)
+{
+    const string& path = global_options.telemetry_file;
+    std::ofstream series(path);
+    telemetry.write_series(series);
+    std::ofstream blocks(path + ".blocks");
+    telemetry.write_blocks(blocks);
+    if (!series || !blocks)
+        std::cerr << "could not write state sizes to " << path << "\n";
+}
+
+/** Widening strategy of our own fixpoint iterator. */
+static fixpoint_params widening_params()
+{
+    fixpoint_params params;
+    params.thresholds = program_thresholds;
+    params.adaptive_delay = global_options.adaptive_widening;
+    return params;
+}
+
+/** Forward analysis on our own fixpoint iterator, used when the iteration
+ *  has to be instrumented (--profile, --telemetry), its widening strategy
+ *  changed (--thresholds, --adaptive-widening) or its memory use reduced.
+ *
+ *  With --memory-saving, invariants are stored only at cut points of the WTO
+ *  and the others are recomputed when the checker or the printers ask for
+ *  them, so the iterator is shared with the printers, which run after this
+ *  function returns.
+ *
+ *  Its states are those sampled by --telemetry. The iterator does not use
+ *  liveness (-u) and widens on its own schedule, so the sizes are those of
+ *  this engine, which the telemetry reports as "wto".
+ */
+template<typename dom_t>
+static checks_db analyze_wto(cfg_t& cfg, Cfg const& simple_cfg, printer_t& pre_printer, printer_t& post_printer)
+{
+    fixpoint_params params = widening_params();
+    params.retain_all = !global_options.memory_saving;
+    params.profile = !global_options.profile_file.empty();
+    if (global_options.telemetry) {
+        global_telemetry.clear();
+        global_telemetry.set_engine("wto");
+        params.telemetry = &global_telemetry;
+    }
+    auto engine = std::make_shared<fixpoint_iterator<dom_t>>(cfg, params);
+    engine->run(dom_t{});
+    if (global_options.stats && global_options.memory_saving) {
+        crab::outs() << "memory saving: " << engine->retained() << " of " << std::distance(cfg.begin(), cfg.end())
+                     << " pre-invariants stored\n";
+    }
+    if (params.profile)
+        write_profile(profile_entries(cfg, simple_cfg, engine->get_wto(), engine->get_profile()));
+    if (!global_options.telemetry_file.empty())
+        write_telemetry(global_telemetry);
+
+    if (global_options.print_invariants) {
+        pre_printer.connect([engine](const string& label) {
+            crab::outs() << "\n" << engine->get_pre(label) << "\n";
+        });
+        post_printer.connect([engine](const string& label) {
+            crab::outs() << "\n" << engine->get_post(label) << "\n";
+        });
+    }
+
+    checks_db c = check_invariants<dom_t>(cfg, sorted_labels(cfg),
+        [&](const string& label) { return engine->get_pre(label); },
+        global_options.check_jobs);
+    if (global_options.check_semantic_reachability) {
+        check_semantic_reachability<dom_t>(cfg, [&](const string& label) { return engine->get_post(label); }, c);
+    }
+    return c;
+}
+
 template<typename dom_t>
-static checks_db analyze(bool run_backward, cfg_t& cfg, printer_t& pre_printer, printer_t& post_printer)
+static checks_db analyze(bool run_backward, cfg_t& cfg, Cfg const& simple_cfg, printer_t& pre_printer, printer_t& post_printer)
 {
-#ifndef USE_ARRAY_ADAPTIVE  
-    dom_t::clear_global_state();
-#else    
+    global_state<dom_t>::clear();
+#ifdef USE_ARRAY_ADAPTIVE
     // set parameters for the array adaptive domain
     crab::domains::array_adaptive_domain_params p;
     p.update_nonsmashable_params();
     crab::domains::crab_domain_params_man::get().update_params(p);
 #endif
     
+    bool use_wto = global_options.memory_saving || !global_options.profile_file.empty() || global_options.telemetry
+                   || global_options.widening_thresholds || global_options.adaptive_widening;
+    if (use_wto && !run_backward)
+        return analyze_wto<dom_t>(cfg, simple_cfg, pre_printer, post_printer);
+
     using analyzer_t = intra_forward_backward_analyzer<cfg_ref<cfg_t>, dom_t>;
     
     live_and_dead_analysis<typename analyzer_t::cfg_t> live(cfg);
@@ -189,35 +331,257 @@ static checks_db analyze(bool run_backward, cfg_t& cfg, printer_t& pre_printer,
         });
     }
 
-    checks_db c = check(analyzer);
+    checks_db c = check_invariants<dom_t>(cfg, sorted_labels(cfg),
+        [&](const string& label) { return analyzer.get_pre(label); },
+        global_options.check_jobs);
     if (global_options.check_semantic_reachability) {
-        check_semantic_reachability<dom_t>(cfg, analyzer, c);
+        check_semantic_reachability<dom_t>(cfg, [&](const string& label) { return analyzer.get_post(label); }, c);
     }
     return c;
 }
 
+/** Fingerprints of the blocks of cfg that are stable under small changes of
+ *  the program: the instructions of the eBPF block a Crab block comes from,
+ *  its label suffix within that block, and the same for every enclosing WTO
+ *  head. Blocks with equal fingerprints are numbered in WTO order.
+ */
+static map<string, string> block_fingerprints(cfg_t& cfg, Cfg const& simple_cfg, const Wto<string>& wto)
+{
+    std::set<string> ebpf_labels(simple_cfg.keys().begin(), simple_cfg.keys().end());
+    map<string, size_t> contents;
+    auto content = [&](const string& label) {
+        auto it = contents.find(label);
+        if (it != contents.end())
+            return it->second;
+        string prefix = ebpf_block_of(label, ebpf_labels);
+        std::ostringstream os;
+        if (!prefix.empty()) {
+            for (const Instruction& ins : simple_cfg.at(prefix).insts)
+                os << ins << "\n";
+        }
+        os << label.substr(prefix.size());
+        size_t h = std::hash<string>()(os.str());
+        contents.emplace(label, h);
+        return h;
+    };
+
+    vector<string> labels;
+    for (const auto& block : cfg) {
+        if (wto.contains(block.label()))
+            labels.push_back(block.label());
+    }
+    std::sort(labels.begin(), labels.end(), [&](const string& a, const string& b) {
+        return wto.position(a) < wto.position(b);
+    });
+
+    map<string, string> res;
+    map<size_t, int> occurrences;
+    for (const string& label : labels) {
+        size_t h = content(label);
+        for (const string& head : wto.nesting(label))
+            boost::hash_combine(h, content(head));
+        std::ostringstream os;
+        os << std::hex << h << "." << occurrences[h]++;
+        res.emplace(label, os.str());
+    }
+    return res;
+}
+
+/** Run the fixpoint engine with loop heads seeded from the invariants stored
+ *  for the blocks with the same fingerprint, then store the new invariants.
+ */
+template<typename dom_t>
+static map<string, dom_t> warm_start(const string& domain_name, cfg_t& cfg, Cfg const& simple_cfg, variable_factory_t& vfac)
+{
+    const string& path = global_options.warm_start_file;
+    fixpoint_iterator<dom_t> engine(cfg, widening_params());
+    map<string, string> fingerprints = block_fingerprints(cfg, simple_cfg, engine.get_wto());
+
+    int heads = 0;
+    int seeded = 0;
+    auto stored = certificate::read<dom_t>(path, domain_name, vfac);
+    for (auto const& [label, fingerprint] : fingerprints) {
+        if (!engine.get_wto().is_head(label))
+            continue;
+        heads++;
+        if (stored && stored->count(fingerprint)) {
+            engine.seed(label, stored->at(fingerprint));
+            seeded++;
+        }
+    }
+    engine.run(dom_t{});
+    if (global_options.stats)
+        crab::outs() << "warm start: " << seeded << " of " << heads << " loop heads seeded\n";
+
+    map<string, dom_t> pre;
+    map<string, dom_t> heads_pre;
+    for (const auto& block : cfg) {
+        pre.emplace(block.label(), engine.get_pre(block.label()));
+        auto fingerprint = fingerprints.find(block.label());
+        if (fingerprint != fingerprints.end() && engine.get_wto().is_head(block.label()))
+            heads_pre.emplace(fingerprint->second, pre.at(block.label()));
+    }
+    if (!certificate::write(path, domain_name, heads_pre))
+        std::cerr << "could not write invariants to " << path << "\n";
+    return pre;
+}
+
+/** Analysis backed by stored invariants.
+ *
+ *  With --cert-check, a certificate that is inductive replaces the fixpoint
+ *  computation; otherwise the invariants are recomputed, warm-started from
+ *  --warm-start FILE if given. With --cert-write, the invariants of a
+ *  successful analysis are stored as a certificate.
+ */
+template<typename dom_t>
+static checks_db analyze_stored(const string& domain_name, cfg_t& cfg, Cfg const& simple_cfg, variable_factory_t& vfac,
+                                printer_t& pre_printer, printer_t& post_printer)
+{
+    global_state<dom_t>::clear();
+    // certificates store cells by segment, not by name
+    dom_t::set_cell_names(global_options.print_invariants || global_options.print_failures ||
+                          global_options.print_all_checks_verbose);
+
+    const string& path = global_options.certificate_file;
+    // shared with the printers, which run after this function returns
+    auto pre = std::make_shared<map<string, dom_t>>();
+    bool certified = false;
+    if (global_options.check_certificate) {
+        if (auto cert = certificate::read<dom_t>(path, domain_name, vfac)) {
+            certified = certificate::is_inductive(cfg, *cert);
+            if (certified)
+                *pre = std::move(*cert);
+        }
+        if (!certified)
+            std::cerr << "certificate " << path << " rejected, recomputing invariants\n";
+    }
+    if (!certified && !global_options.warm_start_file.empty()) {
+        *pre = warm_start<dom_t>(domain_name, cfg, simple_cfg, vfac);
+    } else if (!certified) {
+        using analyzer_t = intra_forward_backward_analyzer<cfg_ref<cfg_t>, dom_t>;
+        live_and_dead_analysis<typename analyzer_t::cfg_t> live(cfg);
+        if (global_options.liveness) {
+            live.exec();
+        }
+        dom_t init;
+        analyzer_t analyzer(cfg, init);
+        typename analyzer_t::assumption_map_t assumptions;
+        analyzer.run(init, true, assumptions, &live);
+        *pre = extract_pre(analyzer);
+    }
+
+    auto get_pre = [pre](const string& label) { return pre->at(label); };
+    auto get_post = [pre, &cfg](const string& label) { return transfer_block<dom_t>(cfg.get_node(label), pre->at(label)); };
+    if (global_options.print_invariants) {
+        pre_printer.connect([=](const string& label) {
+            crab::outs() << "\n" << get_pre(label) << "\n";
+        });
+        post_printer.connect([=](const string& label) {
+            crab::outs() << "\n" << get_post(label) << "\n";
+        });
+    }
+
+    checks_db c = check_invariants<dom_t>(cfg, sorted_labels(cfg), get_pre, global_options.check_jobs);
+    if (global_options.check_semantic_reachability) {
+        check_semantic_reachability<dom_t>(cfg, get_post, c);
+    }
+    if (global_options.write_certificate && !certified && c.get_total_warning() + c.get_total_error() == 0) {
+        if (!certificate::write(path, domain_name, *pre))
+            std::cerr << "could not write certificate " << path << "\n";
+    }
+    return c;
+}
+
+/** Packs of the numerical variables of cfg that occur together in
+ *  assignments, arithmetic, assumptions, assertions and selects. The
+ *  scalars of array cells are made by the array domain during the analysis,
+ *  so they are not in the cfg and are never packed.
+ */
+static void compute_packs(cfg_t& cfg)
+{
+    global_packing.clear();
+    for (auto& bb : cfg) {
+        for (auto& stmt : bb) {
+            if (!(stmt.is_assign() || stmt.is_bin_op() || stmt.is_assume() || stmt.is_assert() || stmt.is_select()))
+                continue;
+            auto const& live = stmt.get_live();
+            vector<variable_packing::var_id> vars;
+            for (auto it = live.uses_begin(); it != live.uses_end(); ++it)
+                vars.push_back(it->index());
+            for (auto it = live.defs_begin(); it != live.defs_end(); ++it)
+                vars.push_back(it->index());
+            global_packing.add_occurrence(vars);
+        }
+    }
+    global_packing.build(global_options.max_pack_size);
+}
+
+template<typename dom_t>
+static checks_db analyze_packed(bool run_backward, cfg_t& cfg, Cfg const& simple_cfg, printer_t& pre_printer, printer_t& post_printer)
+{
+    compute_packs(cfg);
+    if (global_options.stats)
+        global_packing.write_stats(crab::outs());
+    return analyze<dom_t>(run_backward, cfg, simple_cfg, pre_printer, post_printer);
+}
+
 struct domain_desc {
-    std::function<checks_db(bool, cfg_t&, printer_t&, printer_t&)> analyze;
+    std::function<checks_db(bool, cfg_t&, Cfg const&, printer_t&, printer_t&)> analyze;
     string description;
+    // whether the translation should emit the "forget_cells" intrinsic
+    bool forget_dead_stack;
 };
 
+template<typename dom_t>
+static domain_desc describe(const string& description)
+{
+    return {analyze<dom_t>, description, forgets_cells<dom_t>};
+}
+
 // ELINA_DOMAINS / APRON_DOMAINS are defined in compiler invocation
 const map<string, domain_desc> domains{
-    { "interval" , { analyze<array_domain<z_interval_domain_t>>   , "interval" } },				       
-    { "zoneCrab" , { analyze<array_domain<z_sdbm_domain_t>>, "zone (crab, split normal form)" } },
-    { "octCrab"  , { analyze<array_domain<z_soct_domain_t>>, "octagon (crab, split normal form)" } },    
+    { "interval" , describe<array_domain<z_interval_domain_t>>("interval") },				       
+    { "zoneCrab" , describe<array_domain<z_sdbm_domain_t>>("zone (crab, split normal form)") },
+    { "zoneTags" , describe<array_domain<z_sdbm_tags_domain_t>>("zone over values and offsets, region tags as finite sets") },
+    { "zoneDense" , describe<array_domain<z_dense_dbm_domain_t>>("zone (dense matrix, sparse beyond 64 variables)") },
+    { "intervalNative" , describe<array_domain<n_interval_domain_t>>("interval over 64-bit integers") },
+    { "zoneNative" , describe<array_domain<n_sdbm_domain_t>>("zone (crab, split normal form) over 64-bit integers") },
+    { "octCrab"  , describe<array_domain<z_soct_domain_t>>("octagon (crab, split normal form)") },    
+    { "intervalStack" , describe<stack_domain<z_interval_domain_t>>("interval, fixed-layout stack") },
+    { "zoneStack" , describe<stack_domain<z_sdbm_domain_t>>("zone (crab, split normal form), fixed-layout stack") },
 #ifdef ELINA_DOMAINS
-    { "zoneElina", { analyze<array_domain<z_zones_elina_domain_t>>, "zone (elina)" } },
-    { "octElina" , { analyze<array_domain<z_oct_elina_domain_t>>  , "octagon (elina)" } },
-    { "polyElina", { analyze<array_domain<z_pk_elina_domain_t>>   , "polyhedra (elina)" } },
+    { "zoneElina", describe<array_domain<z_zones_elina_domain_t>>("zone (elina)") },
+    { "octElina" , describe<array_domain<z_oct_elina_domain_t>>("octagon (elina)") },
+    { "polyElina", describe<array_domain<z_pk_elina_domain_t>>("polyhedra (elina)") },
 #endif
 #ifdef APRON_DOMAINS
     // no zoneApron
-    { "octApron",  { analyze<array_domain<z_oct_apron_domain_t>> , "octagon (apron)"} },
-    { "polyApron", { analyze<array_domain<z_pk_apron_domain_t >> , "polyhedra (elina)"} },
+    { "octApron",  describe<array_domain<z_oct_apron_domain_t>>("octagon (apron)") },
+    { "polyApron", describe<array_domain<z_pk_apron_domain_t >>("polyhedra (elina)") },
+#endif
+    { "boxes"             , describe<array_domain<z_boxes_domain_t>>("mem: boxes (z_boxes_domain_t)") },
+    { "none"              , { dont_analyze, "build CFG only, don't perform analysis", false } },
+};
+
+// Domains run with --pack, in place of the domain of the same name
+const map<string, std::function<checks_db(bool, cfg_t&, Cfg const&, printer_t&, printer_t&)>>
+packed_domains{
+    { "zoneCrab" , analyze_packed<array_domain<z_packed_sdbm_domain_t>> },
+    { "octCrab"  , analyze_packed<array_domain<z_packed_soct_domain_t>> },
+#ifdef ELINA_DOMAINS
+    { "polyElina", analyze_packed<array_domain<z_packed_pk_elina_domain_t>> },
+#endif
+#ifdef APRON_DOMAINS
+    { "polyApron", analyze_packed<array_domain<z_packed_pk_apron_domain_t>> },
 #endif
-    { "boxes"             , { analyze<array_domain<z_boxes_domain_t>>, "mem: boxes (z_boxes_domain_t)" } },
-    { "none"              , { dont_analyze, "build CFG only, don't perform analysis" } },
+};
+
+// Domains whose invariants can be stored and read back. Stored invariants
+// record array cells by segment, which requires the array expansion domain.
+const map<string, std::function<checks_db(const string&, cfg_t&, Cfg const&, variable_factory_t&, printer_t&, printer_t&)>>
+stored_domains{
+    { "interval", analyze_stored<array_expansion_domain<z_interval_domain_t>> },
+    { "zoneCrab", analyze_stored<array_expansion_domain<z_sdbm_domain_t>> },
 };
 
 map<string, string> domain_descriptions()
@@ -228,8 +592,36 @@ map<string, string> domain_descriptions()
     return res;
 }
 
-static checks_db analyze(string domain_name, bool run_backward, cfg_t& cfg, printer_t& pre_printer, printer_t& post_printer)
+static bool uses_stored_invariants()
+{
+    return global_options.write_certificate || global_options.check_certificate || !global_options.warm_start_file.empty();
+}
+
+/** Whether the domain analyze runs for domain_name acts on "forget_cells". */
+static bool forget_dead_stack(const string& domain_name, bool run_backward)
 {
-    checks_db res = domains.at(domain_name).analyze(run_backward, cfg, pre_printer, post_printer);
+    if (!global_options.stack_gc)
+        return false;
+    // stored invariants are computed with array_expansion
+    if (uses_stored_invariants() && !run_backward && stored_domains.count(domain_name))
+        return true;
+    auto desc = domains.find(domain_name);
+    return desc != domains.end() && desc->second.forget_dead_stack;
+}
+
+static checks_db analyze(string domain_name, bool run_backward, cfg_t& cfg, Cfg const& simple_cfg,
+                         variable_factory_t& vfac, printer_t& pre_printer, printer_t& post_printer)
+{
+    if (uses_stored_invariants()) {
+        if (!run_backward && stored_domains.count(domain_name))
+            return stored_domains.at(domain_name)(domain_name, cfg, simple_cfg, vfac, pre_printer, post_printer);
+        std::cerr << "stored invariants are only supported for forward analysis with interval or zoneCrab\n";
+    }
+    if (global_options.pack) {
+        if (packed_domains.count(domain_name))
+            return packed_domains.at(domain_name)(run_backward, cfg, simple_cfg, pre_printer, post_printer);
+        std::cerr << "packing is only supported for relational domains, running " << domain_name << " unpacked\n";
+    }
+    checks_db res = domains.at(domain_name).analyze(run_backward, cfg, simple_cfg, pre_printer, post_printer);
     return res;
 }
@@ -0,0 +1,385 @@
+#pragma once
+
+/**
+ *  Dense difference-bound matrices.
+ *
+ *  Node 0 stands for the constant zero and nodes 1..n for variables. The
+ *  weight at (i, j) is an upper bound on x_j - x_i, so bounds of x are
+ *  x <= m(0, x) and -x <= m(x, 0). Rows are stored contiguously and padded to
+ *  a multiple of four weights, so the closure, join, meet and widening
+ *  kernels run over whole rows; they use AVX2 when the compiler targets it
+ *  and plain loops otherwise.
+ *
+ *  Finite weights are kept within [-MAX_WEIGHT, MAX_WEIGHT], so the sum of
+ *  two never overflows. Larger sums are rounded to INF and smaller ones to
+ *  -MAX_WEIGHT, which only loses precision.
+ **/
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dbm_kernels {
+
+using weight_t = int64_t;
+
+constexpr weight_t INF = std::numeric_limits<weight_t>::max();
+constexpr weight_t MAX_WEIGHT = weight_t(1) << 60;
+
+inline weight_t clamp(weight_t w) {
+    if (w > MAX_WEIGHT)
+        return INF;
+    return std::max(w, -MAX_WEIGHT);
+}
+
+/** dst[k] = min(dst[k], a + src[k]), for a finite a. */
+inline void relax(weight_t* dst, const weight_t* src, weight_t a, size_t n) {
+    size_t k = 0;
+#if defined(__AVX2__)
+    const __m256i va = _mm256_set1_epi64x(a);
+    const __m256i inf = _mm256_set1_epi64x(INF);
+    const __m256i hi = _mm256_set1_epi64x(MAX_WEIGHT);
+    const __m256i lo = _mm256_set1_epi64x(-MAX_WEIGHT);
+    for (; k + 4 <= n; k += 4) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + k));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + k));
+        __m256i sum = _mm256_add_epi64(s, va);
+        __m256i over = _mm256_or_si256(_mm256_cmpeq_epi64(s, inf), _mm256_cmpgt_epi64(sum, hi));
+        sum = _mm256_blendv_epi8(sum, inf, over);
+        sum = _mm256_blendv_epi8(sum, lo, _mm256_cmpgt_epi64(lo, sum));
+        d = _mm256_blendv_epi8(d, sum, _mm256_cmpgt_epi64(d, sum));
+        _mm256_storeu_si256((__m256i*)(dst + k), d);
+    }
+#endif
+    for (; k < n; k++) {
+        if (src[k] != INF)
+            dst[k] = std::min(dst[k], clamp(a + src[k]));
+    }
+}
+
+/** dst[k] = max(a[k], b[k]) */
+inline void join(weight_t* dst, const weight_t* a, const weight_t* b, size_t n) {
+    size_t k = 0;
+#if defined(__AVX2__)
+    for (; k + 4 <= n; k += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + k));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + k));
+        _mm256_storeu_si256((__m256i*)(dst + k), _mm256_blendv_epi8(va, vb, _mm256_cmpgt_epi64(vb, va)));
+    }
+#endif
+    for (; k < n; k++)
+        dst[k] = std::max(a[k], b[k]);
+}
+
+/** dst[k] = min(a[k], b[k]) */
+inline void meet(weight_t* dst, const weight_t* a, const weight_t* b, size_t n) {
+    size_t k = 0;
+#if defined(__AVX2__)
+    for (; k + 4 <= n; k += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + k));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + k));
+        _mm256_storeu_si256((__m256i*)(dst + k), _mm256_blendv_epi8(va, vb, _mm256_cmpgt_epi64(va, vb)));
+    }
+#endif
+    for (; k < n; k++)
+        dst[k] = std::min(a[k], b[k]);
+}
+
+/** Bounds of a that b does not respect are dropped. */
+inline void widen(weight_t* dst, const weight_t* a, const weight_t* b, size_t n) {
+    size_t k = 0;
+#if defined(__AVX2__)
+    const __m256i inf = _mm256_set1_epi64x(INF);
+    for (; k + 4 <= n; k += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + k));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + k));
+        _mm256_storeu_si256((__m256i*)(dst + k), _mm256_blendv_epi8(va, inf, _mm256_cmpgt_epi64(vb, va)));
+    }
+#endif
+    for (; k < n; k++)
+        dst[k] = b[k] <= a[k] ? a[k] : INF;
+}
+
+/** Bounds missing from a are taken from b. */
+inline void narrow(weight_t* dst, const weight_t* a, const weight_t* b, size_t n) {
+    size_t k = 0;
+#if defined(__AVX2__)
+    const __m256i inf = _mm256_set1_epi64x(INF);
+    for (; k + 4 <= n; k += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + k));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + k));
+        _mm256_storeu_si256((__m256i*)(dst + k), _mm256_blendv_epi8(va, vb, _mm256_cmpeq_epi64(va, inf)));
+    }
+#endif
+    for (; k < n; k++)
+        dst[k] = a[k] == INF ? b[k] : a[k];
+}
+
+/** Whether a[k] <= b[k] for all k. */
+inline bool leq(const weight_t* a, const weight_t* b, size_t n) {
+    size_t k = 0;
+#if defined(__AVX2__)
+    for (; k + 4 <= n; k += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + k));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + k));
+        __m256i gt = _mm256_cmpgt_epi64(va, vb);
+        if (!_mm256_testz_si256(gt, gt))
+            return false;
+    }
+#endif
+    for (; k < n; k++) {
+        if (a[k] > b[k])
+            return false;
+    }
+    return true;
+}
+
+} // namespace dbm_kernels
+
+class dense_dbm {
+public:
+    using weight_t = dbm_kernels::weight_t;
+    static constexpr weight_t INF = dbm_kernels::INF;
+    static constexpr weight_t MAX_WEIGHT = dbm_kernels::MAX_WEIGHT;
+
+private:
+    size_t _nodes;
+    size_t _stride;
+    std::vector<weight_t> _m;
+    bool _closed = true;
+    bool _bottom = false;
+
+    static size_t padded(size_t n) { return (n + 3) & ~size_t(3); }
+
+    // padding weights are INF, so whole rows can go through the kernels
+    static std::vector<weight_t> init(size_t nodes, size_t stride) {
+        std::vector<weight_t> m(nodes * stride, INF);
+        for (size_t i = 0; i < nodes; i++)
+            m[i * stride + i] = 0;
+        return m;
+    }
+
+    weight_t* row(size_t i) { return _m.data() + i * _stride; }
+    const weight_t* row(size_t i) const { return _m.data() + i * _stride; }
+
+    void check_diagonal() {
+        for (size_t i = 0; i < _nodes && !_bottom; i++)
+            _bottom = row(i)[i] < 0;
+    }
+
+    template <typename Kernel>
+    static dense_dbm combine(const dense_dbm& a, const dense_dbm& b, Kernel kernel) {
+        dense_dbm res(a._nodes - 1);
+        kernel(res._m.data(), a._m.data(), b._m.data(), a._m.size());
+        return res;
+    }
+
+public:
+    /** A matrix without constraints over the given number of variables. */
+    explicit dense_dbm(size_t vars = 0) : _nodes(vars + 1), _stride(padded(vars + 1)), _m(init(_nodes, _stride)) {}
+
+    size_t num_nodes() const { return _nodes; }
+    bool is_bottom() const { return _bottom; }
+    bool is_closed() const { return _closed; }
+
+    void set_to_bottom() { _bottom = true; }
+
+    bool is_top() const {
+        if (_bottom)
+            return false;
+        for (size_t i = 0; i < _nodes; i++)
+            for (size_t j = 0; j < _nodes; j++)
+                if (i != j && row(i)[j] != INF)
+                    return false;
+        return true;
+    }
+
+    weight_t get(size_t i, size_t j) const { return row(i)[j]; }
+
+    /** Append an unconstrained node and return it. */
+    size_t add_node() {
+        size_t node = _nodes;
+        if (_nodes + 1 > _stride) {
+            size_t stride = padded(_nodes + 1);
+            std::vector<weight_t> m = init(_nodes + 1, stride);
+            for (size_t i = 0; i < _nodes; i++)
+                std::copy(row(i), row(i) + _nodes, m.data() + i * stride);
+            _m = std::move(m);
+            _stride = stride;
+        } else {
+            _m.resize((_nodes + 1) * _stride, INF);
+            row(node)[node] = 0;
+        }
+        _nodes++;
+        return node;
+    }
+
+    /** Floyd-Warshall, one pivot row at a time. */
+    void close() {
+        if (_closed || _bottom)
+            return;
+        for (size_t k = 0; k < _nodes; k++) {
+            const weight_t* pivot = row(k);
+            for (size_t i = 0; i < _nodes; i++) {
+                weight_t a = row(i)[k];
+                if (a != INF && i != k)
+                    dbm_kernels::relax(row(i), pivot, a, _stride);
+            }
+        }
+        _closed = true;
+        check_diagonal();
+    }
+
+    /** Add x_j - x_i <= w and restore closure incrementally. Returns false if
+     *  the result is empty. */
+    bool add_edge(size_t i, size_t j, weight_t w) {
+        close();
+        w = dbm_kernels::clamp(w);
+        if (_bottom || w == INF || w >= row(i)[j])
+            return !_bottom;
+        weight_t back = row(j)[i];
+        if (back != INF && back + w < 0) {
+            _bottom = true;
+            return false;
+        }
+        // m(a, b) = min(m(a, b), m(a, i) + w + m(j, b)); row j is unchanged
+        const weight_t* pivot = row(j);
+        for (size_t a = 0; a < _nodes; a++) {
+            weight_t to_i = row(a)[i];
+            if (to_i == INF)
+                continue;
+            weight_t c = dbm_kernels::clamp(to_i + w);
+            if (c != INF && a != j)
+                dbm_kernels::relax(row(a), pivot, c, _stride);
+        }
+        return true;
+    }
+
+    /** Remove all constraints on node v. */
+    void forget(size_t v) {
+        std::fill(row(v), row(v) + _nodes, INF);
+        for (size_t i = 0; i < _nodes; i++)
+            row(i)[v] = INF;
+        row(v)[v] = 0;
+    }
+
+    /** x_v := x_v + k */
+    void shift(size_t v, weight_t k) {
+        for (size_t i = 0; i < _nodes; i++) {
+            if (i == v)
+                continue;
+            weight_t& out = row(v)[i];
+            if (out != INF)
+                out = dbm_kernels::clamp(out - k);
+            weight_t& in = row(i)[v];
+            if (in != INF)
+                in = dbm_kernels::clamp(in + k);
+        }
+    }
+
+    /** x_x := x_y + k, for x != y. Keeps the matrix closed. */
+    void assign_copy(size_t x, size_t y, weight_t k) {
+        forget(x);
+        for (size_t i = 0; i < _nodes; i++) {
+            if (i == x)
+                continue;
+            weight_t in = row(i)[y];
+            row(i)[x] = in == INF ? INF : dbm_kernels::clamp(in + k);
+            weight_t out = row(y)[i];
+            row(x)[i] = out == INF ? INF : dbm_kernels::clamp(out - k);
+        }
+        row(x)[y] = dbm_kernels::clamp(-k);
+        row(y)[x] = dbm_kernels::clamp(k);
+        row(x)[x] = 0;
+    }
+
+    /** Give node dst the constraints of src, but no relation between them.
+     *  Keeps the matrix closed. */
+    void copy_node(size_t src, size_t dst) {
+        forget(dst);
+        for (size_t i = 0; i < _nodes; i++) {
+            if (i == dst || i == src)
+                continue;
+            row(dst)[i] = row(src)[i];
+            row(i)[dst] = row(i)[src];
+        }
+    }
+
+    /** The matrix over nodes from[0..n), where a negative entry is a new
+     *  unconstrained node. from[0] must be 0. Closure is preserved. */
+    dense_dbm permute(const std::vector<ptrdiff_t>& from) const {
+        dense_dbm res(from.size() - 1);
+        res._bottom = _bottom;
+        res._closed = _closed;
+        for (size_t i = 0; i < from.size(); i++) {
+            if (from[i] < 0)
+                continue;
+            const weight_t* src = row(from[i]);
+            weight_t* dst = res.row(i);
+            for (size_t j = 0; j < from.size(); j++) {
+                if (from[j] >= 0)
+                    dst[j] = src[from[j]];
+            }
+        }
+        return res;
+    }
+
+    // Binary operations work on matrices with the same nodes.
+
+    /** Join; closed if both are. */
+    friend dense_dbm operator|(const dense_dbm& a, const dense_dbm& b) {
+        if (a._bottom)
+            return b;
+        if (b._bottom)
+            return a;
+        dense_dbm res = combine(a, b, dbm_kernels::join);
+        res._closed = a._closed && b._closed;
+        return res;
+    }
+
+    friend dense_dbm operator&(const dense_dbm& a, const dense_dbm& b) {
+        if (a._bottom)
+            return a;
+        if (b._bottom)
+            return b;
+        dense_dbm res = combine(a, b, dbm_kernels::meet);
+        res._closed = false;
+        res.close();
+        return res;
+    }
+
+    /** Widening; b must be closed. The result is not closed, so that
+     *  dropped bounds are not recovered by closure. */
+    friend dense_dbm operator||(const dense_dbm& a, const dense_dbm& b) {
+        if (a._bottom)
+            return b;
+        if (b._bottom)
+            return a;
+        dense_dbm res = combine(a, b, dbm_kernels::widen);
+        res._closed = false;
+        return res;
+    }
+
+    friend dense_dbm operator&&(const dense_dbm& a, const dense_dbm& b) {
+        if (a._bottom || b._bottom)
+            return a._bottom ? a : b;
+        dense_dbm res = combine(a, b, dbm_kernels::narrow);
+        res._closed = false;
+        res.close();
+        return res;
+    }
+
+    /** Inclusion; a must be closed. */
+    friend bool operator<=(const dense_dbm& a, const dense_dbm& b) {
+        if (a._bottom)
+            return true;
+        if (b._bottom)
+            return false;
+        return dbm_kernels::leq(a._m.data(), b._m.data(), a._m.size());
+    }
+};
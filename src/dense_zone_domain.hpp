@@ -0,0 +1,1055 @@
+/*******************************************************************************
+ * Dense zone domain
+ *
+ * Zones over a dense difference-bound matrix (see dense_dbm.hpp) for states
+ * with few variables. After the liveness pass, most eBPF states relate fewer
+ * than 64 variables, where a contiguous matrix is cheaper to close, join and
+ * compare than the adjacency graphs of split_dbm.
+ *
+ * Every variable gets a node of the matrix when it is first constrained, and
+ * releases it when it is forgotten. Binary operations first lay both
+ * matrices out over the same variables, which is a no-op when both states
+ * allocated their nodes in the same order.
+ *
+ * Once a state would need more than `Capacity` nodes, it is converted to the
+ * sparse domain and stays there; operations mixing both representations
+ * convert the dense operand.
+ *
+ * Transfer functions follow split_dbm: assignments and constraints keep the
+ * unit-coefficient differences between variables and fall back to interval
+ * reasoning for the rest. Backward operations are coarse: the assigned
+ * variable is forgotten and the result is met with the forward invariant.
+ ******************************************************************************/
+
+#pragma once
+
+#include <crab/domains/abstract_domain.hpp>
+#include <crab/domains/abstract_domain_specialized_traits.hpp>
+#include <crab/support/debug.hpp>
+#include <crab/support/stats.hpp>
+
+#include <boost/optional.hpp>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "dense_dbm.hpp"
+
+namespace crab {
+namespace domains {
+
+template <typename SparseDomain, size_t Capacity = 64>
+class dense_zone_domain final
+    : public abstract_domain_api<dense_zone_domain<SparseDomain, Capacity>> {
+
+public:
+  using number_t = typename SparseDomain::number_t;
+  using varname_t = typename SparseDomain::varname_t;
+
+private:
+  using dense_zone_domain_t = dense_zone_domain<SparseDomain, Capacity>;
+  using abstract_domain_t = abstract_domain_api<dense_zone_domain_t>;
+
+public:
+  using typename abstract_domain_t::disjunctive_linear_constraint_system_t;
+  using typename abstract_domain_t::interval_t;
+  using typename abstract_domain_t::linear_constraint_system_t;
+  using typename abstract_domain_t::linear_constraint_t;
+  using typename abstract_domain_t::linear_expression_t;
+  using typename abstract_domain_t::reference_constraint_t;
+  using typename abstract_domain_t::variable_or_constant_t;
+  using typename abstract_domain_t::variable_t;
+  using typename abstract_domain_t::variable_vector_t;
+  using typename abstract_domain_t::variable_or_constant_vector_t;
+
+private:
+  using weight_t = dense_dbm::weight_t;
+  using bound_t = ikos::bound<number_t>;
+  using layout_t = std::vector<variable_t>;
+
+  // Closed, except after a widening: closing the widened iterate in place
+  // would bring back the bounds the widening dropped, so const operations
+  // close a copy instead.
+  dense_dbm _dbm;
+  // node -> variable; empty for node 0 and for released nodes
+  std::vector<boost::optional<variable_t>> _vars;
+  std::map<variable_t, size_t> _nodes;
+  std::vector<size_t> _free;
+  // set once the state outgrew the matrix
+  boost::optional<SparseDomain> _sparse;
+
+  static constexpr weight_t INF = dense_dbm::INF;
+
+  /* Conversions between numbers and weights. Weights are upper bounds, so
+     numbers out of range become INF, or the smallest weight. */
+
+  static weight_t weight_of(const number_t &n) {
+    if (!n.fits_int64()) {
+      return n > number_t(0) ? INF : -dense_dbm::MAX_WEIGHT;
+    }
+    return dbm_kernels::clamp((int64_t)n);
+  }
+
+  static weight_t weight_of(const boost::optional<number_t> &n) {
+    return n ? weight_of(*n) : INF;
+  }
+
+  static bound_t bound_of(weight_t w) {
+    return w == INF ? bound_t::plus_infinity() : bound_t(number_t(w));
+  }
+
+  /* Nodes */
+
+  boost::optional<size_t> find_node(const variable_t &v) const {
+    auto it = _nodes.find(v);
+    if (it == _nodes.end()) {
+      return boost::none;
+    }
+    return it->second;
+  }
+
+  // The node of v, allocated if needed. Switches to the sparse domain and
+  // returns nothing when the matrix is full.
+  boost::optional<size_t> node_of(const variable_t &v) {
+    if (_sparse) {
+      return boost::none;
+    }
+    if (auto n = find_node(v)) {
+      return n;
+    }
+    size_t n;
+    if (!_free.empty()) {
+      n = _free.back();
+      _free.pop_back();
+    } else if (_dbm.num_nodes() <= Capacity) {
+      n = _dbm.add_node();
+      _vars.resize(_dbm.num_nodes());
+    } else {
+      crab::CrabStats::count(domain_name() + ".count.to_sparse");
+      to_sparse();
+      return boost::none;
+    }
+    _vars[n] = v;
+    _nodes.emplace(v, n);
+    return n;
+  }
+
+  // Allocate nodes for all variables of e; false if the state went sparse.
+  bool reserve(const linear_expression_t &e) {
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      if (!node_of(it->second)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void release(const variable_t &v) {
+    if (auto n = find_node(v)) {
+      // the other nodes keep what they knew through v
+      _dbm.close();
+      _dbm.forget(*n);
+      _vars[*n] = boost::none;
+      _nodes.erase(v);
+      _free.push_back(*n);
+    }
+  }
+
+  SparseDomain sparse_copy() const {
+    if (_sparse) {
+      return *_sparse;
+    }
+    SparseDomain res;
+    if (is_bottom()) {
+      res.set_to_bottom();
+    } else {
+      res.set_to_top();
+      res += to_linear_constraint_system();
+    }
+    return res;
+  }
+
+  void to_sparse() {
+    _sparse = sparse_copy();
+    _dbm = dense_dbm();
+    _vars.assign(1, boost::none);
+    _nodes.clear();
+    _free.clear();
+  }
+
+  static dense_zone_domain_t from_sparse(SparseDomain inv) {
+    dense_zone_domain_t res;
+    res._sparse = std::move(inv);
+    return res;
+  }
+
+  /* Layouts: binary operations work on matrices over the same variables. */
+
+  layout_t layout() const {
+    layout_t res;
+    for (size_t i = 1; i < _vars.size(); i++) {
+      if (_vars[i]) {
+        res.push_back(*_vars[i]);
+      }
+    }
+    return res;
+  }
+
+  // The variables of this that other also has.
+  layout_t common_layout(const dense_zone_domain_t &other) const {
+    layout_t res;
+    for (const variable_t &v : layout()) {
+      if (other._nodes.count(v)) {
+        res.push_back(v);
+      }
+    }
+    return res;
+  }
+
+  // The variables of this followed by those only other has.
+  layout_t union_layout(const dense_zone_domain_t &other) const {
+    layout_t res = layout();
+    for (const variable_t &v : other.layout()) {
+      if (!_nodes.count(v)) {
+        res.push_back(v);
+      }
+    }
+    return res;
+  }
+
+  bool same_layout(const dense_zone_domain_t &other) const {
+    return _vars == other._vars;
+  }
+
+  dense_dbm matrix_over(const layout_t &vars) const {
+    std::vector<ptrdiff_t> from{0};
+    for (const variable_t &v : vars) {
+      auto n = find_node(v);
+      from.push_back(n ? (ptrdiff_t)*n : -1);
+    }
+    return _dbm.permute(from);
+  }
+
+  static dense_zone_domain_t make(const layout_t &vars, dense_dbm m) {
+    dense_zone_domain_t res;
+    res._dbm = std::move(m);
+    res._vars.assign(1, boost::none);
+    for (size_t i = 0; i < vars.size(); i++) {
+      res._vars.push_back(vars[i]);
+      res._nodes.emplace(vars[i], i + 1);
+    }
+    return res;
+  }
+
+  // Apply op to the matrices of this and other over the given variables.
+  template <typename Op>
+  dense_zone_domain_t combine(const dense_zone_domain_t &other,
+                              const layout_t &vars, Op op) const {
+    if (same_layout(other)) {
+      dense_zone_domain_t res(*this);
+      res._dbm = op(_dbm, other._dbm);
+      return res;
+    }
+    return make(vars, op(matrix_over(vars), other.matrix_over(vars)));
+  }
+
+  /* Constraints */
+
+  interval_t interval_of(const variable_t &v) const {
+    auto n = find_node(v);
+    if (!n) {
+      return interval_t::top();
+    }
+    if (!_dbm.is_closed()) {
+      return closed().interval_of(v);
+    }
+    weight_t lb = _dbm.get(*n, 0);
+    return interval_t(lb == INF ? bound_t::minus_infinity()
+                                : bound_t(-number_t(lb)),
+                      bound_of(_dbm.get(0, *n)));
+  }
+
+  interval_t interval_of(const linear_expression_t &e) const {
+    interval_t r(e.constant());
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      r += interval_t(it->first) * interval_of(it->second);
+    }
+    return r;
+  }
+
+  void add_edge(size_t i, size_t j, weight_t w) {
+    if (!_dbm.is_bottom()) {
+      _dbm.add_edge(i, j, w);
+    }
+  }
+
+  // x in i, on a forgotten x
+  void set_interval(size_t x, const interval_t &i) {
+    if (i.is_bottom()) {
+      set_to_bottom();
+      return;
+    }
+    add_edge(0, x, weight_of(i.ub().number()));
+    auto lb = i.lb().number();
+    if (lb) {
+      add_edge(x, 0, weight_of(-*lb));
+    }
+  }
+
+  void set_interval(const variable_t &x, const interval_t &i) {
+    release(x);
+    if (i.is_top()) {
+      return;
+    }
+    if (auto n = node_of(x)) {
+      set_interval(*n, i);
+      return;
+    }
+    linear_constraint_system_t csts;
+    if (auto ub = i.ub().number()) {
+      csts += linear_constraint_t(x - *ub, linear_constraint_t::INEQUALITY);
+    }
+    if (auto lb = i.lb().number()) {
+      csts += linear_constraint_t(*lb - x, linear_constraint_t::INEQUALITY);
+    }
+    *_sparse += csts;
+  }
+
+  // e <= 0, by bounding each unit term with the lower bounds of the others,
+  // and each difference x - y with the lower bounds of the rest.
+  void add_leq(const linear_expression_t &e) {
+    struct term_t {
+      number_t coef;
+      variable_t var;
+      boost::optional<number_t> lb;  // of coef * var
+    };
+    std::vector<term_t> terms;
+    number_t sum = e.constant();
+    size_t unbounded = 0;
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      interval_t i = interval_t(it->first) * interval_of(it->second);
+      auto lb = i.lb().number();
+      if (lb) {
+        sum += *lb;
+      } else {
+        unbounded++;
+      }
+      terms.push_back({it->first, it->second, lb});
+    }
+    if (unbounded == 0 && sum > number_t(0)) {
+      set_to_bottom();
+      return;
+    }
+
+    // sum of the lower bounds of all terms but those given
+    auto rest = [&](const std::vector<const term_t *> &skip)
+        -> boost::optional<number_t> {
+      number_t r = sum;
+      size_t missing = unbounded;
+      for (const term_t *t : skip) {
+        if (t->lb) {
+          r -= *t->lb;
+        } else {
+          missing--;
+        }
+      }
+      if (missing > 0) {
+        return boost::none;
+      }
+      return r;
+    };
+
+    std::vector<std::tuple<size_t, size_t, weight_t>> edges;
+    for (const term_t &t : terms) {
+      bool pos = t.coef == number_t(1);
+      if (!pos && t.coef != number_t(-1)) {
+        continue;
+      }
+      size_t n = _nodes.at(t.var);
+      if (auto r = rest({&t})) {
+        // var <= -r, or -var <= -r
+        edges.emplace_back(pos ? 0 : n, pos ? n : 0, weight_of(-*r));
+      }
+      if (!pos) {
+        continue;
+      }
+      for (const term_t &u : terms) {
+        if (u.coef != number_t(-1) || u.var == t.var) {
+          continue;
+        }
+        if (auto r = rest({&t, &u})) {
+          // t - u <= -r
+          edges.emplace_back(_nodes.at(u.var), n, weight_of(-*r));
+        }
+      }
+    }
+    for (auto [i, j, w] : edges) {
+      add_edge(i, j, w);
+    }
+  }
+
+  // x != k
+  void add_diseq(const variable_t &x, const number_t &k) {
+    interval_t i = interval_of(x);
+    auto n = find_node(x);
+    if (!n) {
+      return;
+    }
+    if (i.lb().number() == boost::optional<number_t>(k)) {
+      add_edge(*n, 0, weight_of(-(k + number_t(1))));
+    }
+    if (i.ub().number() == boost::optional<number_t>(k)) {
+      add_edge(0, *n, weight_of(k - number_t(1)));
+    }
+  }
+
+  void add_constraint(const linear_constraint_t &cst) {
+    if (cst.is_tautology()) {
+      return;
+    }
+    if (cst.is_contradiction()) {
+      set_to_bottom();
+      return;
+    }
+    const linear_expression_t &e = cst.expression();
+    if (cst.is_inequality()) {
+      add_leq(e);
+    } else if (cst.is_strict_inequality()) {
+      add_leq(e + number_t(1));
+    } else if (cst.is_equality()) {
+      add_leq(e);
+      if (!is_bottom()) {
+        add_leq(number_t(-1) * e);
+      }
+    } else if (e.size() == 1) {
+      auto it = e.begin();
+      if (it->first == number_t(1)) {
+        add_diseq(it->second, -e.constant());
+      } else if (it->first == number_t(-1)) {
+        add_diseq(it->second, e.constant());
+      }
+    }
+  }
+
+  // x := e, where e has no unit term on x
+  void assign_linear(const variable_t &x, const linear_expression_t &e) {
+    // x - y in e - y, for each unit term y of e
+    std::vector<std::pair<variable_t, interval_t>> diffs;
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      if (it->first == number_t(1) && !(it->second == x)) {
+        diffs.emplace_back(it->second, interval_of(e - it->second));
+      }
+    }
+    interval_t value = interval_of(e);
+    release(x);
+    size_t n = *node_of(x);
+    set_interval(n, value);
+    for (auto const &[y, d] : diffs) {
+      size_t m = _nodes.at(y);
+      add_edge(m, n, weight_of(d.ub().number()));
+      auto lb = d.lb().number();
+      if (lb) {
+        add_edge(n, m, weight_of(-*lb));
+      }
+    }
+  }
+
+  void backward_forget(const variable_t &x, const dense_zone_domain_t &inv) {
+    *this -= x;
+    *this = *this & inv;
+  }
+
+  // This with its matrix closed, for the operations that need it when
+  // this is a widened iterate
+  dense_zone_domain_t closed() const {
+    dense_zone_domain_t res(*this);
+    res._dbm.close();
+    return res;
+  }
+
+public:
+  dense_zone_domain() : _vars(1) {}
+
+  dense_zone_domain_t make_top() const override { return dense_zone_domain_t(); }
+
+  dense_zone_domain_t make_bottom() const override {
+    dense_zone_domain_t res;
+    res.set_to_bottom();
+    return res;
+  }
+
+  void set_to_top() override { *this = dense_zone_domain_t(); }
+
+  void set_to_bottom() override {
+    *this = dense_zone_domain_t();
+    _dbm.set_to_bottom();
+  }
+
+  // Closing marks an empty matrix, and a matrix that is not closed comes
+  // from widening a non-empty one, which only drops constraints, so the
+  // mark is exact without closing.
+  bool is_bottom() const override {
+    return _sparse ? _sparse->is_bottom() : _dbm.is_bottom();
+  }
+
+  bool is_top() const override {
+    return _sparse ? _sparse->is_top() : _dbm.is_top();
+  }
+
+  bool operator<=(const dense_zone_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.leq");
+    crab::ScopedCrabStats __st__(domain_name() + ".leq");
+    if (is_bottom()) {
+      return true;
+    }
+    if (other.is_bottom()) {
+      return false;
+    }
+    if (!_dbm.is_closed()) {
+      return closed() <= other;
+    }
+    if (_sparse || other._sparse) {
+      return sparse_copy() <= other.sparse_copy();
+    }
+    if (same_layout(other)) {
+      return _dbm <= other._dbm;
+    }
+    layout_t vars = other.layout();
+    return matrix_over(vars) <= other.matrix_over(vars);
+  }
+
+  void operator|=(const dense_zone_domain_t &other) override {
+    *this = *this | other;
+  }
+
+  dense_zone_domain_t operator|(const dense_zone_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.join");
+    crab::ScopedCrabStats __st__(domain_name() + ".join");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    if (!_dbm.is_closed() || !other._dbm.is_closed()) {
+      return closed() | other.closed();
+    }
+    if (_sparse || other._sparse) {
+      return from_sparse(sparse_copy() | other.sparse_copy());
+    }
+    return combine(other, common_layout(other),
+                   [](const dense_dbm &a, const dense_dbm &b) { return a | b; });
+  }
+
+  dense_zone_domain_t operator&(const dense_zone_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.meet");
+    crab::ScopedCrabStats __st__(domain_name() + ".meet");
+    if (is_bottom() || other.is_bottom()) {
+      return make_bottom();
+    }
+    layout_t vars = union_layout(other);
+    if (_sparse || other._sparse || vars.size() > Capacity) {
+      return from_sparse(sparse_copy() & other.sparse_copy());
+    }
+    return combine(other, vars,
+                   [](const dense_dbm &a, const dense_dbm &b) { return a & b; });
+  }
+
+  // The left operand is widened as it is: closing it would bring back the
+  // bounds that the previous widening dropped, and the iterates might not
+  // stabilize. The matrix widening needs other closed.
+  dense_zone_domain_t operator||(const dense_zone_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.widening");
+    crab::ScopedCrabStats __st__(domain_name() + ".widening");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    if (!other._dbm.is_closed()) {
+      return *this || other.closed();
+    }
+    if (_sparse || other._sparse) {
+      return from_sparse(sparse_copy() || other.sparse_copy());
+    }
+    return combine(other, common_layout(other),
+                   [](const dense_dbm &a, const dense_dbm &b) { return a || b; });
+  }
+
+  // Thresholds are only used once the state is sparse.
+  dense_zone_domain_t widening_thresholds(
+      const dense_zone_domain_t &other,
+      const thresholds<number_t> &ts) const override {
+    if (_sparse || other._sparse) {
+      return from_sparse(sparse_copy().widening_thresholds(other.sparse_copy(), ts));
+    }
+    return *this || other;
+  }
+
+  dense_zone_domain_t operator&&(const dense_zone_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.narrowing");
+    crab::ScopedCrabStats __st__(domain_name() + ".narrowing");
+    if (is_bottom() || other.is_bottom()) {
+      return make_bottom();
+    }
+    layout_t vars = union_layout(other);
+    if (_sparse || other._sparse || vars.size() > Capacity) {
+      return from_sparse(sparse_copy() && other.sparse_copy());
+    }
+    return combine(other, vars,
+                   [](const dense_dbm &a, const dense_dbm &b) { return a && b; });
+  }
+
+  void forget(const variable_vector_t &variables) override {
+    if (_sparse) {
+      _sparse->forget(variables);
+      return;
+    }
+    for (const variable_t &v : variables) {
+      release(v);
+    }
+  }
+
+  void project(const variable_vector_t &variables) override {
+    if (_sparse) {
+      _sparse->project(variables);
+      return;
+    }
+    if (is_bottom()) {
+      return;
+    }
+    _dbm.close();
+    layout_t vars;
+    for (const variable_t &v : variables) {
+      if (_nodes.count(v)) {
+        vars.push_back(v);
+      }
+    }
+    *this = make(vars, matrix_over(vars));
+  }
+
+  void expand(const variable_t &var, const variable_t &new_var) override {
+    if (_sparse) {
+      _sparse->expand(var, new_var);
+      return;
+    }
+    release(new_var);
+    auto src = find_node(var);
+    if (!src || is_bottom()) {
+      return;
+    }
+    if (auto dst = node_of(new_var)) {
+      _dbm.close();
+      _dbm.copy_node(*src, *dst);
+    } else {
+      _sparse->expand(var, new_var);
+    }
+  }
+
+  void normalize() override {
+    if (_sparse) {
+      _sparse->normalize();
+    } else {
+      _dbm.close();
+    }
+  }
+
+  void minimize() override { normalize(); }
+
+  void operator+=(const linear_constraint_system_t &csts) override {
+    crab::CrabStats::count(domain_name() + ".count.add_constraints");
+    crab::ScopedCrabStats __st__(domain_name() + ".add_constraints");
+    for (const linear_constraint_t &cst : csts) {
+      if (is_bottom()) {
+        return;
+      }
+      if (_sparse || !reserve(cst.expression())) {
+        *_sparse += linear_constraint_system_t(cst);
+      } else {
+        add_constraint(cst);
+      }
+    }
+  }
+
+  void operator-=(const variable_t &var) override {
+    if (_sparse) {
+      *_sparse -= var;
+    } else {
+      release(var);
+    }
+  }
+
+  void assign(const variable_t &x, const linear_expression_t &e) override {
+    crab::CrabStats::count(domain_name() + ".count.assign");
+    crab::ScopedCrabStats __st__(domain_name() + ".assign");
+    if (is_bottom()) {
+      return;
+    }
+    if (!_sparse && node_of(x)) {
+      reserve(e);
+    }
+    if (_sparse) {
+      _sparse->assign(x, e);
+      return;
+    }
+    size_t n = _nodes.at(x);
+    if (e.is_constant()) {
+      release(x);
+      set_interval(*node_of(x), interval_t(e.constant()));
+    } else if (e.size() == 1 && e.begin()->first == number_t(1)) {
+      // x := y + k
+      const variable_t &y = e.begin()->second;
+      weight_t k = weight_of(e.constant());
+      if (k == INF || k == -dense_dbm::MAX_WEIGHT) {
+        set_interval(x, interval_of(e));
+      } else if (y == x) {
+        _dbm.close();
+        _dbm.shift(n, k);
+      } else {
+        _dbm.close();
+        _dbm.assign_copy(n, _nodes.at(y), k);
+      }
+    } else {
+      assign_linear(x, e);
+    }
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             number_t z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (_sparse) {
+      _sparse->apply(op, x, y, z);
+      return;
+    }
+    switch (op) {
+    case OP_ADDITION:
+      assign(x, linear_expression_t(y) + z);
+      return;
+    case OP_SUBTRACTION:
+      assign(x, linear_expression_t(y) - z);
+      return;
+    case OP_MULTIPLICATION:
+      assign(x, z * linear_expression_t(y));
+      return;
+    default:
+      apply(op, x, interval_of(y), interval_t(z));
+    }
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (_sparse) {
+      _sparse->apply(op, x, y, z);
+      return;
+    }
+    switch (op) {
+    case OP_ADDITION:
+      assign(x, linear_expression_t(y) + z);
+      return;
+    case OP_SUBTRACTION:
+      assign(x, linear_expression_t(y) - z);
+      return;
+    default:
+      apply(op, x, interval_of(y), interval_of(z));
+    }
+  }
+
+private:
+  void apply(arith_operation_t op, const variable_t &x, const interval_t &y,
+             const interval_t &z) {
+    switch (op) {
+    case OP_MULTIPLICATION:
+      set_interval(x, y * z);
+      break;
+    case OP_SDIV:
+      set_interval(x, y / z);
+      break;
+    case OP_UDIV:
+      set_interval(x, y.UDiv(z));
+      break;
+    case OP_SREM:
+      set_interval(x, y.SRem(z));
+      break;
+    case OP_UREM:
+      set_interval(x, y.URem(z));
+      break;
+    default:
+      set_interval(x, interval_t::top());
+    }
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const interval_t &y,
+             const interval_t &z) {
+    switch (op) {
+    case OP_AND:
+      set_interval(x, y.And(z));
+      break;
+    case OP_OR:
+      set_interval(x, y.Or(z));
+      break;
+    case OP_XOR:
+      set_interval(x, y.Xor(z));
+      break;
+    case OP_SHL:
+      set_interval(x, y.Shl(z));
+      break;
+    case OP_LSHR:
+      set_interval(x, y.LShr(z));
+      break;
+    case OP_ASHR:
+      set_interval(x, y.AShr(z));
+      break;
+    default:
+      set_interval(x, interval_t::top());
+    }
+  }
+
+public:
+  void select(const variable_t &lhs, const linear_constraint_t &cond,
+              const linear_expression_t &e1,
+              const linear_expression_t &e2) override {
+    if (_sparse) {
+      _sparse->select(lhs, cond, e1, e2);
+      return;
+    }
+    dense_zone_domain_t then_inv(*this), else_inv(*this);
+    then_inv += linear_constraint_system_t(cond);
+    then_inv.assign(lhs, e1);
+    else_inv += linear_constraint_system_t(cond.negate());
+    else_inv.assign(lhs, e2);
+    *this = then_inv | else_inv;
+  }
+
+  void backward_assign(const variable_t &x, const linear_expression_t &e,
+                       const dense_zone_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, number_t z,
+                      const dense_zone_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, const variable_t &z,
+                      const dense_zone_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  // As in split_dbm, conversions between bit widths are copies.
+  void apply(int_conv_operation_t op, const variable_t &dst,
+             const variable_t &src) override {
+    assign(dst, linear_expression_t(src));
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (_sparse) {
+      _sparse->apply(op, x, y, z);
+    } else {
+      apply(op, x, interval_of(y), interval_of(z));
+    }
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             number_t k) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (_sparse) {
+      _sparse->apply(op, x, y, k);
+    } else {
+      apply(op, x, interval_of(y), interval_t(k));
+    }
+  }
+
+  // boolean operators: booleans are not tracked
+  virtual void assign_bool_cst(const variable_t &lhs,
+                               const linear_constraint_t &rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void assign_bool_ref_cst(const variable_t &lhs,
+                                   const reference_constraint_t &rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                               bool is_not_rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void apply_binary_bool(bool_operation_t op, const variable_t &x,
+                                 const variable_t &y,
+                                 const variable_t &z) override {
+    *this -= x;
+  }
+
+  virtual void assume_bool(const variable_t &v, bool is_negated) override {}
+
+  virtual void select_bool(const variable_t &lhs, const variable_t &cond,
+                           const variable_t &b1, const variable_t &b2) override {
+    *this -= lhs;
+  }
+
+  // backward boolean operators
+  virtual void
+  backward_assign_bool_cst(const variable_t &lhs,
+                           const linear_constraint_t &rhs,
+                           const dense_zone_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_assign_bool_ref_cst(const variable_t &lhs,
+                               const reference_constraint_t &rhs,
+                               const dense_zone_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                           bool is_not_rhs,
+                           const dense_zone_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_apply_binary_bool(bool_operation_t op, const variable_t &x,
+                             const variable_t &y, const variable_t &z,
+                             const dense_zone_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  /// dense_zone_domain is a scalar domain: arrays are handled by the array
+  /// domain on top of it.
+  ARRAY_OPERATIONS_NOT_IMPLEMENTED(dense_zone_domain_t)
+  REGION_AND_REFERENCE_OPERATIONS_NOT_IMPLEMENTED(dense_zone_domain_t)
+
+  linear_constraint_system_t to_linear_constraint_system() const override {
+    if (_sparse) {
+      return _sparse->to_linear_constraint_system();
+    }
+    if (!_dbm.is_closed()) {
+      return closed().to_linear_constraint_system();
+    }
+    linear_constraint_system_t csts;
+    if (is_bottom()) {
+      csts += linear_constraint_t::get_false();
+      return csts;
+    }
+    // node 0 is the constant zero
+    auto expr = [this](size_t n) {
+      return n == 0 ? linear_expression_t(number_t(0))
+                    : linear_expression_t(*_vars[n]);
+    };
+    for (size_t i = 0; i < _vars.size(); i++) {
+      if (i > 0 && !_vars[i]) {
+        continue;
+      }
+      for (size_t j = i + 1; j < _vars.size(); j++) {
+        if (!_vars[j]) {
+          continue;
+        }
+        weight_t up = _dbm.get(i, j), down = _dbm.get(j, i);
+        linear_expression_t d = expr(j) - expr(i);
+        if (up != INF && down != INF && up == -down) {
+          csts += linear_constraint_t(d - number_t(up),
+                                      linear_constraint_t::EQUALITY);
+          continue;
+        }
+        if (up != INF) {
+          csts += linear_constraint_t(d - number_t(up),
+                                      linear_constraint_t::INEQUALITY);
+        }
+        if (down != INF) {
+          csts += linear_constraint_t(expr(i) - expr(j) - number_t(down),
+                                      linear_constraint_t::INEQUALITY);
+        }
+      }
+    }
+    return csts;
+  }
+
+  disjunctive_linear_constraint_system_t
+  to_disjunctive_linear_constraint_system() const override {
+    auto lin_csts = to_linear_constraint_system();
+    if (lin_csts.is_false()) {
+      return disjunctive_linear_constraint_system_t(true /*is_false*/);
+    } else if (lin_csts.is_true()) {
+      return disjunctive_linear_constraint_system_t(false /*is_false*/);
+    } else {
+      return disjunctive_linear_constraint_system_t(lin_csts);
+    }
+  }
+
+  virtual interval_t operator[](const variable_t &v) override {
+    if (_sparse) {
+      return (*_sparse)[v];
+    }
+    if (is_bottom()) {
+      return interval_t::bottom();
+    }
+    return interval_of(v);
+  }
+
+  /* begin intrinsics operations */
+  void intrinsic(std::string name, const variable_or_constant_vector_t &inputs,
+                 const variable_vector_t &outputs) override {
+    CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+  }
+
+  void backward_intrinsic(std::string name,
+                          const variable_or_constant_vector_t &inputs,
+                          const variable_vector_t &outputs,
+                          const dense_zone_domain_t &invariant) override {
+    CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+  }
+  /* end intrinsics operations */
+
+  void write(crab_os &o) const override {
+    if (_sparse) {
+      o << *_sparse;
+    } else if (is_bottom()) {
+      o << "_|_";
+    } else {
+      o << to_linear_constraint_system();
+    }
+  }
+
+  std::string domain_name() const override { return "DenseZone"; }
+
+  void rename(const variable_vector_t &from,
+              const variable_vector_t &to) override {
+    if (_sparse) {
+      _sparse->rename(from, to);
+      return;
+    }
+    std::vector<std::pair<size_t, variable_t>> moved;
+    for (size_t i = 0; i < from.size(); i++) {
+      if (auto n = find_node(from[i])) {
+        _nodes.erase(from[i]);
+        moved.emplace_back(*n, to[i]);
+      }
+    }
+    for (auto const &[n, v] : moved) {
+      _vars[n] = v;
+      _nodes[v] = n;
+    }
+  }
+}; // end dense_zone_domain
+
+template <typename SparseDomain, size_t Capacity>
+struct abstract_domain_traits<dense_zone_domain<SparseDomain, Capacity>> {
+  using number_t = typename SparseDomain::number_t;
+  using varname_t = typename SparseDomain::varname_t;
+};
+
+} // namespace domains
+} // namespace crab
@@ -0,0 +1,91 @@
+#include <cmath>
+#include <iomanip>
+#include <tuple>
+
+#include "fixpoint_profile.hpp"
+
+block_profile& block_profile::operator+=(const block_profile& o)
+{
+    visits += o.visits;
+    widenings += o.widenings;
+    narrowings += o.narrowings;
+    delays += o.delays;
+    transfer_time += o.transfer_time;
+    join_time += o.join_time;
+    return *this;
+}
+
+static std::string quote(const std::string& s)
+{
+    std::string res = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            res += '\\';
+        res += c;
+    }
+    return res + "\"";
+}
+
+static void write_counts(std::ostream& out, const block_profile& p)
+{
+    out << "\"visits\": " << p.visits
+        << ", \"widenings\": " << p.widenings
+        << ", \"narrowings\": " << p.narrowings
+        << ", \"transfer_sec\": " << p.transfer_time
+        << ", \"join_sec\": " << p.join_time;
+    if (p.delays)
+        out << ", \"delays\": " << p.delays;
+}
+
+void write_profile_json(std::ostream& out, const std::vector<profile_entry>& entries)
+{
+    std::map<std::tuple<int, size_t, std::string>, block_profile> instructions;
+    std::map<std::string, block_profile> kinds;
+    for (const profile_entry& e : entries) {
+        instructions[{e.pc, e.index, e.kind}] += e.counts;
+        kinds[e.kind] += e.counts;
+    }
+
+    auto flags = out.flags();
+    out << std::setprecision(6) << std::fixed;
+    out << "{\n  \"blocks\": [";
+    const char* sep = "\n";
+    for (const profile_entry& e : entries) {
+        out << sep << "    {\"block\": " << quote(e.block) << ", \"pc\": " << e.pc << ", ";
+        write_counts(out, e.counts);
+        out << "}";
+        sep = ",\n";
+    }
+    out << "\n  ],\n  \"instructions\": [";
+    sep = "\n";
+    for (const auto& [key, counts] : instructions) {
+        auto& [pc, index, kind] = key;
+        out << sep << "    {\"pc\": " << pc << ", \"index\": " << index << ", \"kind\": " << quote(kind) << ", ";
+        write_counts(out, counts);
+        out << "}";
+        sep = ",\n";
+    }
+    out << "\n  ],\n  \"kinds\": {";
+    sep = "\n";
+    for (const auto& [kind, counts] : kinds) {
+        out << sep << "    " << quote(kind) << ": {";
+        write_counts(out, counts);
+        out << "}";
+        sep = ",\n";
+    }
+    out << "\n  }\n}\n";
+    out.flags(flags);
+}
+
+void write_profile_folded(std::ostream& out, const std::vector<profile_entry>& entries)
+{
+    for (const profile_entry& e : entries) {
+        long usec = std::lround((e.counts.transfer_time + e.counts.join_time) * 1e6);
+        if (usec == 0)
+            continue;
+        out << "program";
+        for (const std::string& head : e.loops)
+            out << ";loop " << head;
+        out << ";" << e.pc << "/" << e.index << " " << e.kind << ";" << e.block << " " << usec << "\n";
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+/**
+ *  Per-block profile of a fixpoint computation, and its reports.
+ *
+ *  The iterator counts, for each block of Crab's cfg_t, how often it was
+ *  visited and how long its transfer functions and the join of its
+ *  predecessors took; for WTO heads it also counts widenings, narrowings and
+ *  the iterations by which the adaptive strategy delayed widening.
+ *  The reports attribute these counts to eBPF instructions.
+ **/
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct block_profile {
+    unsigned int visits = 0;
+    unsigned int widenings = 0;
+    unsigned int narrowings = 0;
+    unsigned int delays = 0;
+    double transfer_time = 0;  // seconds
+    double join_time = 0;      // seconds
+
+    block_profile& operator+=(const block_profile& o);
+};
+
+/** The profile of one Crab block with the eBPF instruction it belongs to. */
+struct profile_entry {
+    std::string block;
+    int pc;                          // first_num of the block label
+    size_t index;                    // instruction index within the eBPF block
+    std::string kind;                // see instype()
+    std::vector<std::string> loops;  // enclosing WTO heads, outermost first
+    block_profile counts;
+};
+
+/** JSON with the raw blocks and the totals per instruction and per kind.
+ *  Delays are only written where there were some. */
+void write_profile_json(std::ostream& out, const std::vector<profile_entry>& entries);
+
+/** One line per block in the folded-stack format of flame graph tools,
+ *  weighted by microseconds spent, with enclosing loops as frames.
+ */
+void write_profile_folded(std::ostream& out, const std::vector<profile_entry>& entries);
@@ -0,0 +1,474 @@
+#include <cstring>
+#include <map>
+#include <random>
+#include <sstream>
+#include <variant>
+
+#include "spec_assertions.hpp"
+#include "interpreter.hpp"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Holds the end of the packet, as in the explicated assertions
+constexpr Reg DATA_END_REG{13};
+
+enum class Kind { UNINIT, NUM, CTX, STACK, PACKET, MAP, FD };
+
+// A number, or an offset into a region. Maps and map descriptors also
+// record the index of their map.
+struct cval {
+    Kind kind = Kind::UNINIT;
+    uint64_t v{};
+    size_t map{};
+
+    bool is_ptr() const { return kind != Kind::UNINIT && kind != Kind::NUM && kind != Kind::FD; }
+    bool same_region(const cval& o) const { return kind == o.kind && map == o.map; }
+};
+
+cval num(uint64_t v) { return {Kind::NUM, v}; }
+
+// Thrown when the run fails at the current instruction.
+struct failure {
+    string message;
+};
+
+// Thrown when the run goes beyond what is modeled.
+struct unmodeled {};
+
+uint64_t truncate(uint64_t v, int width) {
+    return width >= 8 ? v : v & ((uint64_t{1} << (8 * width)) - 1);
+}
+
+}
+
+uint64_t alu(Bin::Op op, uint64_t a, uint64_t b, bool is64) {
+    if (!is64) {
+        a = truncate(a, 4);
+        b = truncate(b, 4);
+    }
+    uint64_t shift = b & (is64 ? 63 : 31);
+    uint64_t res{};
+    switch (op) {
+        case Bin::Op::MOV: res = b; break;
+        case Bin::Op::ADD: res = a + b; break;
+        case Bin::Op::SUB: res = a - b; break;
+        case Bin::Op::MUL: res = a * b; break;
+        // eBPF defines division by zero
+        case Bin::Op::DIV: res = b ? a / b : 0; break;
+        case Bin::Op::MOD: res = b ? a % b : a; break;
+        case Bin::Op::OR: res = a | b; break;
+        case Bin::Op::AND: res = a & b; break;
+        case Bin::Op::LSH: res = a << shift; break;
+        case Bin::Op::RSH: res = a >> shift; break;
+        case Bin::Op::ARSH:
+            res = is64 ? static_cast<uint64_t>(static_cast<int64_t>(a) >> shift)
+                       : static_cast<uint64_t>(static_cast<int32_t>(a) >> shift);
+            break;
+        case Bin::Op::XOR: res = a ^ b; break;
+    }
+    return is64 ? res : truncate(res, 4);
+}
+
+bool taken(Condition::Op op, uint64_t a, uint64_t b) {
+    auto sa = static_cast<int64_t>(a);
+    auto sb = static_cast<int64_t>(b);
+    switch (op) {
+        case Condition::Op::EQ: return a == b;
+        case Condition::Op::NE: return a != b;
+        case Condition::Op::SET: return (a & b) != 0;
+        case Condition::Op::NSET: return (a & b) == 0;
+        case Condition::Op::LT: return a < b;
+        case Condition::Op::LE: return a <= b;
+        case Condition::Op::GT: return a > b;
+        case Condition::Op::GE: return a >= b;
+        case Condition::Op::SLT: return sa < sb;
+        case Condition::Op::SLE: return sa <= sb;
+        case Condition::Op::SGT: return sa > sb;
+        case Condition::Op::SGE: return sa >= sb;
+    }
+    return false;
+}
+
+namespace {
+
+// Offsets and sizes in linear constraints are compared as integers.
+bool compare(Condition::Op op, int64_t a, int64_t b) {
+    switch (op) {
+        case Condition::Op::LT: case Condition::Op::SLT: return a < b;
+        case Condition::Op::LE: case Condition::Op::SLE: return a <= b;
+        case Condition::Op::GT: case Condition::Op::SGT: return a > b;
+        case Condition::Op::GE: case Condition::Op::SGE: return a >= b;
+        default: return taken(op, a, b);
+    }
+}
+
+class run {
+    const InstructionSeq& prog;
+    const program_info& info;
+    const vector<vector<Assertion>>& assertions;
+    const std::map<Label, size_t>& index;
+    std::mt19937_64& rng;
+
+    cval regs[16];
+    vector<uint8_t> stack;
+    vector<uint8_t> ctx;
+    vector<uint8_t> packet;
+    vector<vector<uint8_t>> maps;
+    // Values stored to the stack by 8-byte stores that are not numbers, by
+    // offset. Loads of them are only modeled at the same offset and width.
+    std::map<int64_t, cval> spills;
+
+    size_t pc = 0;
+    bool exited = false;
+
+    uint64_t random_number() {
+        switch (rng() % 4) {
+            case 0: return 0;
+            case 1: return rng() % 256;
+            case 2: return -(rng() % 256);
+            default: return rng();
+        }
+    }
+
+    vector<uint8_t> random_bytes(size_t n) {
+        vector<uint8_t> res(n);
+        for (uint8_t& b : res)
+            b = rng();
+        return res;
+    }
+
+    cval& reg(Reg r) {
+        if (r.v >= 16)
+            throw unmodeled{};
+        return regs[r.v];
+    }
+
+    const cval& read(Reg r) {
+        const cval& x = reg(r);
+        if (x.kind == Kind::UNINIT)
+            throw failure{"r" + std::to_string(r.v) + " is uninitialized"};
+        return x;
+    }
+
+    cval read(const Value& v) {
+        if (std::holds_alternative<Imm>(v))
+            return num(std::get<Imm>(v).v);
+        return read(std::get<Reg>(v));
+    }
+
+    Types types(const cval& x) const {
+        switch (x.kind) {
+            case Kind::NUM: return TypeSet::num;
+            case Kind::CTX: return TypeSet::ctx;
+            case Kind::STACK: return TypeSet::stack;
+            case Kind::PACKET: return TypeSet::packet;
+            case Kind::MAP: return TypeSet::single(x.map);
+            case Kind::FD: return TypeSet::fd;
+            case Kind::UNINIT: break;
+        }
+        return {};
+    }
+
+    bool has_type(const TypeConstraint::RT& rt) { return (types(read(rt.reg)) & rt.types).any(); }
+
+    bool holds(const Assertion& a) {
+        return std::visit(overloaded{
+            [&](const TypeConstraint& tc) {
+                return (tc.given && !has_type(*tc.given)) || has_type(tc.then);
+            },
+            [&](const LinearConstraint& lc) {
+                const cval& x = read(lc.reg);
+                if ((types(x) & lc.when_types).none())
+                    return true;
+                int64_t lhs = static_cast<int64_t>(x.v) + lc.offset + static_cast<int64_t>(read(lc.width).v);
+                return compare(lc.op, lhs, static_cast<int64_t>(read(lc.v).v));
+            },
+        }, a.cst);
+    }
+
+    // The bytes at [offset, offset + width) of the region that base points to.
+    uint8_t* bytes(const cval& base, int64_t offset, uint64_t width) {
+        vector<uint8_t>* region = nullptr;
+        switch (base.kind) {
+            case Kind::STACK: region = &stack; break;
+            case Kind::CTX: region = &ctx; break;
+            case Kind::PACKET: region = &packet; break;
+            case Kind::MAP: region = &maps.at(base.map); break;
+            default: throw unmodeled{};
+        }
+        int64_t lb = static_cast<int64_t>(base.v) + offset;
+        if (lb < 0 || width > region->size() || static_cast<uint64_t>(lb) > region->size() - width)
+            throw unmodeled{};
+        return region->data() + lb;
+    }
+
+    // Forget the spilled values that overlap [lb, ub).
+    void clobber_spills(int64_t lb, int64_t ub) {
+        auto it = spills.lower_bound(lb - 7);
+        while (it != spills.end() && it->first < ub)
+            it = spills.erase(it);
+    }
+
+    bool overlaps_spill(int64_t lb, int64_t ub) const {
+        auto it = spills.lower_bound(lb - 7);
+        return it != spills.end() && it->first < ub;
+    }
+
+    cval load(const cval& base, int offset, int width) {
+        int64_t lb = static_cast<int64_t>(base.v) + offset;
+        if (base.kind == Kind::STACK) {
+            auto it = spills.find(lb);
+            if (it != spills.end() && width == 8)
+                return it->second;
+            if (overlaps_spill(lb, lb + width))
+                throw unmodeled{};
+        }
+        if (base.kind == Kind::CTX) {
+            const ptype_descr& d = info.descriptor;
+            if (d.data > -1 && lb == d.data)
+                return {Kind::PACKET, 0};
+            if (d.end > -1 && lb == d.end)
+                return reg(DATA_END_REG);
+            if (d.meta > -1 && lb == d.meta)
+                return {Kind::PACKET, 0};
+        }
+        uint64_t v{};
+        std::memcpy(&v, bytes(base, offset, width), width);
+        return num(truncate(v, width));
+    }
+
+    void store(const cval& base, int offset, int width, const cval& value) {
+        uint8_t* p = bytes(base, offset, width);
+        int64_t lb = static_cast<int64_t>(base.v) + offset;
+        if (base.kind == Kind::STACK)
+            clobber_spills(lb, lb + width);
+        if (value.kind == Kind::NUM) {
+            std::memcpy(p, &value.v, width);
+        } else if (base.kind == Kind::STACK && width == 8) {
+            spills[lb] = value;
+        } else {
+            throw unmodeled{};
+        }
+    }
+
+    void scratch() {
+        for (uint8_t i = 1; i <= 5; i++)
+            regs[i] = {};
+    }
+
+    void jump(const Label& target) {
+        auto it = index.find(target);
+        if (it == index.end())
+            throw unmodeled{};
+        pc = it->second;
+    }
+
+public:
+    run(const InstructionSeq& prog, const program_info& info, const vector<vector<Assertion>>& assertions,
+        const std::map<Label, size_t>& index, std::mt19937_64& rng)
+        : prog{prog}, info{info}, assertions{assertions}, index{index}, rng{rng} {
+        stack = random_bytes(STACK_SIZE);
+        ctx = random_bytes(info.descriptor.size);
+        uint64_t packet_size;
+        switch (rng() % 3) {
+            case 0: packet_size = 0; break;
+            case 1: packet_size = rng() % 64; break;
+            default: packet_size = rng() % 1519; break;
+        }
+        packet = random_bytes(packet_size);
+        for (const map_def& def : info.map_defs)
+            maps.push_back(random_bytes(def.value_size));
+        regs[1] = {Kind::CTX, 0};
+        regs[10] = {Kind::STACK, STACK_SIZE};
+        regs[DATA_END_REG.v] = {Kind::PACKET, packet_size};
+    }
+
+    /** Execute from the first instruction, adding the executed labels to
+     *  trace. Throws failure or unmodeled. */
+    void execute(vector<Label>& trace, int max_steps) {
+        for (int step = 0; step < max_steps && !exited; step++) {
+            if (pc >= prog.size())
+                throw unmodeled{};
+            const auto& [label, ins] = prog[pc];
+            trace.push_back(label);
+            for (const Assertion& a : assertions[pc]) {
+                if (!holds(a)) {
+                    std::ostringstream os;
+                    os << "assertion failed: " << a;
+                    throw failure{os.str()};
+                }
+            }
+            pc++;
+            std::visit(*this, ins);
+        }
+    }
+
+    void operator()(const Undefined&) { throw unmodeled{}; }
+
+    void operator()(const LoadMapFd& a) {
+        if (a.mapfd < 0 || static_cast<size_t>(a.mapfd) >= info.map_defs.size())
+            throw unmodeled{};
+        reg(a.dst) = {Kind::FD, 0, static_cast<size_t>(a.mapfd)};
+    }
+
+    void operator()(const Bin& a) {
+        cval src = read(a.v);
+        if (a.op == Bin::Op::MOV) {
+            if (!a.is64 && src.kind != Kind::NUM)
+                throw unmodeled{};
+            reg(a.dst) = a.is64 ? src : num(truncate(src.v, 4));
+            return;
+        }
+        cval dst = read(a.dst);
+        if (dst.kind == Kind::NUM && src.kind == Kind::NUM) {
+            reg(a.dst) = num(alu(a.op, dst.v, src.v, a.is64));
+            return;
+        }
+        if (!a.is64)
+            throw unmodeled{};
+        if (a.op == Bin::Op::ADD && dst.is_ptr() && src.kind == Kind::NUM) {
+            reg(a.dst).v = dst.v + src.v;
+        } else if (a.op == Bin::Op::ADD && dst.kind == Kind::NUM && src.is_ptr()) {
+            reg(a.dst) = src;
+            reg(a.dst).v = dst.v + src.v;
+        } else if (a.op == Bin::Op::SUB && dst.is_ptr() && src.kind == Kind::NUM) {
+            reg(a.dst).v = dst.v - src.v;
+        } else if (a.op == Bin::Op::SUB && dst.is_ptr() && dst.same_region(src)) {
+            reg(a.dst) = num(dst.v - src.v);
+        } else {
+            throw unmodeled{};
+        }
+    }
+
+    void operator()(const Un& a) {
+        cval x = read(a.dst);
+        if (x.kind != Kind::NUM)
+            throw unmodeled{};
+        switch (a.op) {
+            case Un::Op::LE16: x.v = truncate(x.v, 2); break;
+            case Un::Op::LE32: x.v = truncate(x.v, 4); break;
+            case Un::Op::LE64: break;
+            case Un::Op::NEG: x.v = -x.v; break;
+        }
+        reg(a.dst) = x;
+    }
+
+    void operator()(const Call& call) {
+        for (const ArgSingle& arg : call.singles)
+            read(arg.reg);
+        for (const ArgPair& arg : call.pairs) {
+            cval mem = read(arg.mem);
+            uint64_t size = read(arg.size).v;
+            if (arg.kind != ArgPair::Kind::PTR_TO_UNINIT_MEM || mem.kind == Kind::NUM)
+                continue;
+            uint8_t* p = bytes(mem, 0, size);
+            for (uint64_t i = 0; i < size; i++)
+                p[i] = rng();
+            if (mem.kind == Kind::STACK)
+                clobber_spills(mem.v, mem.v + size);
+        }
+        cval r0 = num(random_number());
+        if (call.returns_map) {
+            const cval& fd = read(Reg{1});
+            if (fd.kind != Kind::FD)
+                throw unmodeled{};
+            // Maps of maps are not modeled; null is their only lookup result
+            MapType type = info.map_defs.at(fd.map).type;
+            bool of_maps = type == MapType::ARRAY_OF_MAPS || type == MapType::HASH_OF_MAPS;
+            if (!of_maps && rng() % 2)
+                r0 = {Kind::MAP, 0, fd.map};
+            else
+                r0 = num(0);
+        }
+        scratch();
+        regs[0] = r0;
+    }
+
+    void operator()(const Exit&) { exited = true; }
+
+    void operator()(const Jmp& a) {
+        if (!a.cond) {
+            jump(a.target);
+            return;
+        }
+        const Condition& c = *a.cond;
+        cval left = read(c.left);
+        cval right = read(c.right);
+        bool res;
+        if ((left.kind == Kind::NUM && right.kind == Kind::NUM) || left.same_region(right)) {
+            res = taken(c.op, left.v, right.v);
+        } else if ((left.kind == Kind::NUM && left.v == 0) || (right.kind == Kind::NUM && right.v == 0)) {
+            // a null check of a pointer or map descriptor
+            if (c.op != Condition::Op::EQ && c.op != Condition::Op::NE)
+                throw unmodeled{};
+            res = c.op == Condition::Op::NE;
+        } else {
+            throw unmodeled{};
+        }
+        if (res)
+            jump(a.target);
+    }
+
+    void operator()(const Assume& a) {
+        cval left = read(a.cond.left);
+        cval right = read(a.cond.right);
+        if (left.kind != Kind::NUM || right.kind != Kind::NUM || !taken(a.cond.op, left.v, right.v))
+            throw unmodeled{};
+    }
+
+    void operator()(const Assert&) { }
+
+    void operator()(const Mem& a) {
+        cval base = read(a.access.basereg);
+        if (a.is_load)
+            reg(std::get<Reg>(a.value)) = load(base, a.access.offset, a.access.width);
+        else
+            store(base, a.access.offset, a.access.width, read(a.value));
+    }
+
+    void operator()(const Packet& a) {
+        // the context is implicitly in r6
+        read(Reg{6});
+        if (a.regoffset)
+            read(*a.regoffset);
+        scratch();
+        regs[0] = num(random_number());
+    }
+
+    void operator()(const LockAdd& a) {
+        cval base = read(a.access.basereg);
+        cval value = read(a.valreg);
+        cval old = load(base, a.access.offset, a.access.width);
+        if (value.kind != Kind::NUM || old.kind != Kind::NUM)
+            throw unmodeled{};
+        store(base, a.access.offset, a.access.width, num(old.v + value.v));
+    }
+};
+
+}
+
+std::optional<violation> find_violation(const InstructionSeq& prog, const program_info& info,
+                                        int runs, uint64_t seed, int max_steps) {
+    vector<vector<Assertion>> assertions;
+    std::map<Label, size_t> index;
+    for (size_t i = 0; i < prog.size(); i++) {
+        const auto& [label, ins] = prog[i];
+        assertions.push_back(assertions_of(ins, info));
+        index.emplace(label, i);
+    }
+
+    std::mt19937_64 rng(seed);
+    for (int i = 0; i < runs; i++) {
+        vector<Label> trace;
+        try {
+            run(prog, info, assertions, index, rng).execute(trace, max_steps);
+        } catch (const failure& f) {
+            return violation{trace.back(), f.message, trace};
+        } catch (const unmodeled&) {
+        }
+    }
+    return {};
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+/**
+ *  Concrete interpreter used to find failing executions before analyzing.
+ *
+ *  Each run starts from a fresh random state: a context buffer laid out by
+ *  the program type's descriptor, a packet of random length and contents,
+ *  a value buffer per map, and garbage on the stack. Map lookups return
+ *  either null or the map's value buffer, other helpers return random
+ *  numbers. Before an instruction executes, the assertions that the
+ *  analyses check for it are evaluated on the concrete state, so a failed
+ *  assertion is one that no sound analysis can prove. Reading a register
+ *  that holds no value is a failure as well.
+ *
+ *  A run that reaches behavior the interpreter does not model, such as
+ *  arithmetic on map descriptors or a partial load of a spilled pointer, is
+ *  dropped without a verdict.
+ **/
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "asm_syntax.hpp"
+#include "spec_type_descriptors.hpp"
+
+struct violation {
+    Label label;
+    std::string message;
+    /** The labels executed by the failing run, ending with label. */
+    std::vector<Label> trace;
+};
+
+/** The result of an ALU operation on concrete values, truncated to 32 bits
+ *  unless is64. */
+uint64_t alu(Bin::Op op, uint64_t a, uint64_t b, bool is64);
+
+/** Whether a conditional jump on concrete values is taken. */
+bool taken(Condition::Op op, uint64_t a, uint64_t b);
+
+/** The first failure found in at most `runs` runs of at most `max_steps`
+ *  instructions each. The runs are determined by the seed. */
+std::optional<violation> find_violation(const InstructionSeq& prog, const program_info& info,
+                                        int runs, uint64_t seed = 0, int max_steps = 100000);
@@ -0,0 +1,226 @@
+#pragma once
+
+/**
+ *  Persistent index of closed intervals [lb, ub] over unsigned 64-bit
+ *  bounds, each with a value, for overlap queries.
+ *
+ *  The index is a treap ordered by (lb, ub), where each node also records the
+ *  largest ub of its subtree. The priority of a node is a hash of its
+ *  interval, so the shape only depends on the set of intervals and the
+ *  expected depth is O(log n). An overlap query skips the subtrees that end
+ *  before the queried interval and stops at the first node starting after it,
+ *  so it runs in O(log n + k) for k results.
+ *
+ *  Updates copy the path to the changed node and share the rest, so copying
+ *  an index is O(1) and copies do not affect each other.
+ **/
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+template <typename T>
+class interval_index {
+    struct node;
+    using ptr = std::shared_ptr<const node>;
+
+    struct node {
+        uint64_t lb, ub;
+        uint64_t priority;
+        uint64_t max_ub;
+        T value;
+        ptr left, right;
+    };
+
+    ptr _root;
+    size_t _size = 0;
+
+    static uint64_t hash(uint64_t lb, uint64_t ub) {
+        // splitmix64 finalizer
+        uint64_t z = lb * 0x9e3779b97f4a7c15ULL + ub;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    static bool less(uint64_t lb1, uint64_t ub1, uint64_t lb2, uint64_t ub2) {
+        return lb1 < lb2 || (lb1 == lb2 && ub1 < ub2);
+    }
+
+    // n with the given children
+    static ptr make(const node& n, ptr left, ptr right) {
+        uint64_t max_ub = n.ub;
+        if (left && left->max_ub > max_ub)
+            max_ub = left->max_ub;
+        if (right && right->max_ub > max_ub)
+            max_ub = right->max_ub;
+        return std::make_shared<const node>(node{n.lb, n.ub, n.priority, max_ub, n.value, std::move(left), std::move(right)});
+    }
+
+    // Nodes of t before (lb, ub) go to l, the others to r.
+    static void split(const ptr& t, uint64_t lb, uint64_t ub, ptr& l, ptr& r) {
+        if (!t) {
+            l = r = nullptr;
+        } else if (less(t->lb, t->ub, lb, ub)) {
+            ptr rl;
+            split(t->right, lb, ub, rl, r);
+            l = make(*t, t->left, rl);
+        } else {
+            ptr lr;
+            split(t->left, lb, ub, l, lr);
+            r = make(*t, lr, t->right);
+        }
+    }
+
+    // All nodes of l come before those of r.
+    static ptr merge(const ptr& l, const ptr& r) {
+        if (!l)
+            return r;
+        if (!r)
+            return l;
+        if (l->priority > r->priority)
+            return make(*l, l->left, merge(l->right, r));
+        return make(*r, merge(l, r->left), r->right);
+    }
+
+    // n is not in t
+    static ptr insert(const ptr& t, const ptr& n) {
+        if (!t)
+            return n;
+        if (n->priority > t->priority) {
+            ptr l, r;
+            split(t, n->lb, n->ub, l, r);
+            return make(*n, l, r);
+        }
+        if (less(n->lb, n->ub, t->lb, t->ub))
+            return make(*t, insert(t->left, n), t->right);
+        return make(*t, t->left, insert(t->right, n));
+    }
+
+    // t itself if [lb, ub] is not in it
+    static ptr erase(const ptr& t, uint64_t lb, uint64_t ub) {
+        if (!t)
+            return t;
+        if (t->lb == lb && t->ub == ub)
+            return merge(t->left, t->right);
+        if (less(lb, ub, t->lb, t->ub)) {
+            ptr left = erase(t->left, lb, ub);
+            return left == t->left ? t : make(*t, left, t->right);
+        }
+        ptr right = erase(t->right, lb, ub);
+        return right == t->right ? t : make(*t, t->left, right);
+    }
+
+    template <typename F>
+    static void overlaps(const node* t, uint64_t lb, uint64_t ub, F& f) {
+        if (!t || t->max_ub < lb)
+            return;
+        overlaps(t->left.get(), lb, ub, f);
+        if (t->lb > ub)
+            return;
+        if (t->ub >= lb)
+            f(t->value);
+        overlaps(t->right.get(), lb, ub, f);
+    }
+
+    template <typename F>
+    static void for_each(const node* t, F& f) {
+        if (!t)
+            return;
+        for_each(t->left.get(), f);
+        f(t->value);
+        for_each(t->right.get(), f);
+    }
+
+    // f(lb, ub, value) on every node, in order
+    template <typename F>
+    static void for_each_node(const node* t, F& f) {
+        if (!t)
+            return;
+        for_each_node(t->left.get(), f);
+        f(t->lb, t->ub, t->value);
+        for_each_node(t->right.get(), f);
+    }
+
+public:
+    bool empty() const { return !_root; }
+    size_t size() const { return _size; }
+
+    /** Value of [lb, ub], or null. */
+    const T* find(uint64_t lb, uint64_t ub) const {
+        const node* t = _root.get();
+        while (t && !(t->lb == lb && t->ub == ub))
+            t = less(lb, ub, t->lb, t->ub) ? t->left.get() : t->right.get();
+        return t ? &t->value : nullptr;
+    }
+
+    /** Add [lb, ub] with value v, replacing its previous value. */
+    void insert(uint64_t lb, uint64_t ub, const T& v) {
+        erase(lb, ub);
+        _root = insert(_root, std::make_shared<const node>(node{lb, ub, hash(lb, ub), ub, v, nullptr, nullptr}));
+        _size++;
+    }
+
+    /** Remove [lb, ub]; false if it is not in the index. */
+    bool erase(uint64_t lb, uint64_t ub) {
+        ptr root = erase(_root, lb, ub);
+        if (root == _root)
+            return false;
+        _root = root;
+        _size--;
+        return true;
+    }
+
+    /** Add the intervals of o that are not in this. Only the smaller of the
+     *  two indexes is traversed. */
+    void unite(const interval_index& o) {
+        if (o._size > _size) {
+            interval_index res = o;
+            auto add = [&res](uint64_t lb, uint64_t ub, const T& v) { res.insert(lb, ub, v); };
+            for_each_node(_root.get(), add);
+            *this = std::move(res);
+        } else {
+            auto add = [this](uint64_t lb, uint64_t ub, const T& v) {
+                if (!find(lb, ub))
+                    insert(lb, ub, v);
+            };
+            // held, as o may be this
+            ptr root = o._root;
+            for_each_node(root.get(), add);
+        }
+    }
+
+    /** Remove the intervals that are not in o. Only the smaller of the two
+     *  indexes is traversed. */
+    void intersect(const interval_index& o) {
+        if (o._size < _size) {
+            interval_index res;
+            auto keep = [&](uint64_t lb, uint64_t ub, const T&) {
+                if (const T* v = find(lb, ub))
+                    res.insert(lb, ub, *v);
+            };
+            for_each_node(o._root.get(), keep);
+            *this = std::move(res);
+        } else {
+            auto drop = [&](uint64_t lb, uint64_t ub, const T&) {
+                if (!o.find(lb, ub))
+                    erase(lb, ub);
+            };
+            // held, as erasing replaces _root
+            ptr root = _root;
+            for_each_node(root.get(), drop);
+        }
+    }
+
+    /** Call f on the values of the intervals that intersect [lb, ub], in
+     *  order. */
+    template <typename F>
+    void overlaps(uint64_t lb, uint64_t ub, F f) const {
+        overlaps(_root.get(), lb, ub, f);
+    }
+
+    /** Call f on every value, in order. */
+    template <typename F>
+    void for_each(F f) const {
+        for_each(_root.get(), f);
+    }
+};
@@ -1,5 +1,10 @@
 #include <iostream>
+#include <limits>
 #include <vector>
+#include <algorithm>
+#include <ctime>
+#include <optional>
+#include <tuple>
 
 #include <crab/support/debug.hpp>
 #include <crab/support/stats.hpp>
@@ -11,9 +16,13 @@
 #include "memsize.hpp"
 #include "config.hpp"
 #include "crab_verifier.hpp"
+#include "state_telemetry.hpp"
 #include "asm.hpp"
 #include "spec_assertions.hpp"
 #include "ai.hpp"
+#include "syntactic_check.hpp"
+#include "interpreter.hpp"
+#include "slicing.hpp"
 
 #include "linux_verifier.hpp"
 
@@ -48,9 +57,19 @@ int main(int argc, char **argv)
         doms.insert(name);
     app.add_set("-d,--dom,--domain", domain, doms, "Abstract domain")->type_name("DOMAIN");
 
+    std::string refine_domain;
+    std::set<string> refine_doms;
+    for (auto const& [name, desc] : domain_descriptions())
+        refine_doms.insert(name);
+    app.add_set("--refine", refine_domain, refine_doms,
+                "If rcp leaves assertions unproven, analyze the instructions they depend on with DOMAIN")->type_name("DOMAIN");
+
     bool verbose = false;
     bool run_backward = false;
     bool enable_liveness = false;
+    bool keep_dead_stack = false;
+    bool no_precheck = false;
+    bool keep_redundant_assertions = false;
     bool crab_warnings  = false;
     app.add_flag("-i", global_options.print_invariants, "Print invariants");
     app.add_flag("-f", global_options.print_failures, "Print verifier's failure logs");
@@ -62,8 +81,47 @@ int main(int argc, char **argv)
     app.add_flag("-b", run_backward, "Run forward+backward analysis");
     // This might be imprecise with relational domains
     app.add_flag("-u", enable_liveness, "Enable liveness analysis");
+    app.add_flag("--keep-dead-stack", keep_dead_stack,
+                 "Do not forget the stack cells that are no longer read. Only the *Stack domains and "
+                 "array_expansion, used for stored invariants, forget them; array_adaptive keeps them");
+    app.add_flag("--no-precheck", no_precheck,
+                 "Analyze programs even if they read uninitialized registers or misuse r10");
+    app.add_option("--fuzz", global_options.fuzz_runs,
+                   "Look for a failing execution in N random runs before the analysis")->type_name("N");
+    app.add_flag("--keep-redundant-assertions", keep_redundant_assertions,
+                 "Check assertions even if an earlier assertion implies them. Only the RCP analysis "
+                 "drops implied assertions; the Crab translation keeps all of them");
     app.add_flag("-w", crab_warnings, "Enable crab warnings");
+    app.add_option("-j,--jobs", global_options.check_jobs, "Check assertions using N worker processes")->type_name("N");
     
+    app.add_flag("--memory-saving", global_options.memory_saving,
+                 "Store invariants only at loop heads and joins, recompute the others on demand");
+    app.add_option("--profile", global_options.profile_file,
+                   "Write a per-instruction fixpoint profile to FILE (JSON) and FILE.folded")->type_name("FILE");
+    app.add_flag("--telemetry", global_options.telemetry,
+                 "Report the size of the abstract states and the engine that computed them. The forward analysis "
+                 "then runs on the WTO iterator, without liveness; other analyses report n/a");
+    app.add_option("--telemetry-file", global_options.telemetry_file,
+                   "Write state sizes over time to FILE and per block to FILE.blocks")->type_name("FILE");
+    app.add_flag("--pack", global_options.pack,
+                 "Run the relational domain on packs of related variables, intervals elsewhere. "
+                 "Stack cells are never packed, so only their intervals are kept");
+    app.add_option("--pack-size", global_options.max_pack_size, "Limit packs to N variables")
+        ->type_name("N")->check(CLI::Range(1, std::numeric_limits<int>::max()));
+    app.add_flag("--thresholds", global_options.widening_thresholds,
+                 "Widen loop bounds to the constants of the program before widening to infinity");
+    app.add_flag("--adaptive-widening", global_options.adaptive_widening,
+                 "Delay widening at loop heads whose state is converging");
+    app.add_option("--set-size", global_options.max_set_size,
+                   "Let the rcp domain track up to N values per register before using intervals")->type_name("N");
+
+    app.add_flag("--cert-write", global_options.write_certificate,
+                 "Store the invariants of a successful analysis next to the ELF file");
+    app.add_flag("--cert-check", global_options.check_certificate,
+                 "Check stored invariants instead of recomputing them");
+    app.add_option("--warm-start", global_options.warm_start_file,
+                   "Seed loop heads from the invariants in FILE, then update it")->type_name("FILE");
+
     std::string asmfile;
     app.add_option("--asm", asmfile, "Print disassembly to FILE")->type_name("FILE");
     std::string dotfile;
@@ -81,6 +139,11 @@ int main(int argc, char **argv)
     }
 
     global_options.liveness = enable_liveness;
+    global_options.stack_gc = !keep_dead_stack;
+    global_options.precheck = !no_precheck;
+    global_options.drop_redundant_assertions = !keep_redundant_assertions;
+    if (!global_options.telemetry_file.empty())
+        global_options.telemetry = true;
 
     crab::CrabEnableWarningMsg(crab_warnings);
 
@@ -101,6 +164,11 @@ int main(int argc, char **argv)
             std::cout << domain << "?,";
             std::cout << domain << "_sec,";
             std::cout << domain << "_kb";
+            if (global_options.telemetry) {
+                std::cout << "," << domain << "_engine";
+                for (string h : state_telemetry::csv_headers())
+                    std::cout << "," << domain << "_" << h;
+            }
         } 
         return 0;
     }
@@ -122,6 +190,10 @@ int main(int argc, char **argv)
     }
     raw_program raw_prog = raw_progs.back();
 
+    string section = raw_prog.section;
+    std::replace(section.begin(), section.end(), '/', '_');
+    global_options.certificate_file = filename + "." + section + "." + domain + ".cert";
+
 
     auto prog_or_error = unmarshal(raw_prog);
     if (std::holds_alternative<string>(prog_or_error)) {
@@ -135,6 +207,20 @@ int main(int argc, char **argv)
     int instruction_count = prog.size();
 
     Cfg cfg = Cfg::make(prog);
+
+    // Definite errors found before the analysis, labeled by pc
+    std::vector<syntactic_error> errors;
+    // A failing execution found by the interpreter
+    std::optional<violation> witness;
+    clock_t precheck_begin = clock();
+    if (domain != "stats" && domain != "linux") {
+        if (global_options.precheck)
+            errors = syntactic_errors(cfg);
+        if (errors.empty() && global_options.fuzz_runs > 0)
+            witness = find_violation(prog, raw_prog.info, global_options.fuzz_runs);
+    }
+    double precheck_seconds = double(clock() - precheck_begin) / CLOCKS_PER_SEC;
+
     cfg = cfg.to_nondet(false);
     if (global_options.simplify) {
         cfg.simplify();
@@ -148,16 +234,52 @@ int main(int argc, char **argv)
             std::cout  << "," << stats.at(h);
         }
         std::cout << "\n";
-    } else if (domain == "rcp") {
-        analyze_rcp(cfg, raw_prog.info);
     } else {
-        const auto [res, seconds] = (domain == "linux")
+        if (global_options.print_failures) {
+            for (const syntactic_error& e : errors)
+                std::cout << e.label << ": " << e.message << "\n";
+            if (witness) {
+                std::cout << witness->label << ": " << witness->message << "\nwitness:";
+                for (const Label& l : witness->trace)
+                    std::cout << " " << l;
+                std::cout << "\n";
+            }
+        }
+        auto [res, seconds] = (domain == "linux")
             ? bpf_verify_program(raw_prog.info.program_type, raw_prog.prog)
+          : (!errors.empty() || witness)
+            ? std::make_tuple(false, precheck_seconds)
+          : (domain == "rcp")
+            ? rcp_validate(cfg, raw_prog.info)
 	  : abs_validate(cfg, domain, run_backward, raw_prog.info);
+        if (domain != "linux" && errors.empty() && !witness)
+            seconds += precheck_seconds;
+        size_t sliced_away = 0;
+        if (!res && domain == "rcp" && !refine_domain.empty() && errors.empty() && !witness) {
+            // Analyze the slice of the program for the unproven assertions
+            Cfg sliced = Cfg::make(prog).to_nondet(false);
+            if (global_options.simplify)
+                sliced.simplify();
+            sliced_away = slice(sliced, unproven_instructions(cfg));
+            const auto [refined, refine_seconds] = abs_validate(sliced, refine_domain, run_backward, raw_prog.info);
+            res = refined;
+            seconds += refine_seconds;
+        }
         //std::cout << res << "," << seconds << "," << resident_set_size_kb() << "\n";
-	std::cout << (res ? "TRUE" : "FALSE") << "," << seconds << "," << resident_set_size_kb() << "\n";
+	std::cout << (res ? "TRUE" : "FALSE") << "," << seconds << "," << resident_set_size_kb();
+        if (global_options.telemetry) {
+            const string& engine = global_telemetry.get_engine();
+            std::cout << "," << (engine.empty() ? "n/a" : engine) << ",";
+            if (engine.empty())
+                state_telemetry::write_csv_unmeasured(std::cout);
+            else
+                global_telemetry.write_csv_summary(std::cout);
+        }
+        std::cout << "\n";
 	if (global_options.stats) {
 	  crab::CrabStats::PrintBrunch(crab::outs());
+	  if (!refine_domain.empty())
+	    std::cout << "slice: " << sliced_away << " instructions removed\n";
 	}
         return !res;
     }
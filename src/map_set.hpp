@@ -0,0 +1,115 @@
+#pragma once
+
+/**
+ *  Set of map indices. A set is either finite or contains every index past
+ *  some point, so complements are sets too and there is no bound on the
+ *  number of maps: a set only stores the words up to the highest index of
+ *  the program's maps it singles out.
+ **/
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+class MapSet {
+    static constexpr size_t BITS = 64;
+
+    std::vector<uint64_t> words;
+    // Whether the indices past the words are in the set
+    bool rest = false;
+
+    uint64_t fill() const { return rest ? ~uint64_t{0} : 0; }
+    uint64_t word(size_t w) const { return w < words.size() ? words[w] : fill(); }
+
+    // Drop the trailing words that are equal to the rest, so equal sets
+    // have equal representations
+    void normalize() {
+        while (!words.empty() && words.back() == fill())
+            words.pop_back();
+    }
+
+    template <typename F>
+    static MapSet combine(const MapSet& a, const MapSet& b, const F& f) {
+        MapSet res;
+        res.rest = f(a.rest, b.rest);
+        res.words.resize(std::max(a.words.size(), b.words.size()));
+        for (size_t w = 0; w < res.words.size(); w++)
+            res.words[w] = f(a.word(w), b.word(w));
+        res.normalize();
+        return res;
+    }
+
+public:
+    MapSet() = default;
+    /** The indices below 64 whose bit is set in mask, as for std::bitset. */
+    MapSet(uint64_t mask) {
+        if (mask)
+            words.push_back(mask);
+    }
+
+    bool test(size_t i) const { return (word(i / BITS) >> (i % BITS)) & 1; }
+    bool operator[](size_t i) const { return test(i); }
+
+    MapSet& set(size_t i) {
+        if (words.size() <= i / BITS)
+            words.resize(i / BITS + 1, fill());
+        words[i / BITS] |= uint64_t{1} << (i % BITS);
+        normalize();
+        return *this;
+    }
+    MapSet& set() { words.clear(); rest = true; return *this; }
+    MapSet& reset() { words.clear(); rest = false; return *this; }
+
+    bool none() const { return !rest && words.empty(); }
+    bool any() const { return !none(); }
+    bool all() const { return rest && words.empty(); }
+    bool is_finite() const { return !rest; }
+    /** The number of indices, SIZE_MAX if the set is infinite. */
+    size_t count() const {
+        if (rest)
+            return SIZE_MAX;
+        size_t res = 0;
+        for (uint64_t w : words)
+            res += __builtin_popcountll(w);
+        return res;
+    }
+
+    /** The indices of a finite set, in increasing order. */
+    std::vector<size_t> elements() const {
+        assert(is_finite());
+        std::vector<size_t> res;
+        for (size_t w = 0; w < words.size(); w++) {
+            for (size_t b = 0; b < BITS; b++) {
+                if ((words[w] >> b) & 1)
+                    res.push_back(w * BITS + b);
+            }
+        }
+        return res;
+    }
+
+    MapSet operator~() const {
+        MapSet res;
+        res.rest = !rest;
+        for (uint64_t w : words)
+            res.words.push_back(~w);
+        return res;
+    }
+    friend MapSet operator&(const MapSet& a, const MapSet& b) { return combine(a, b, [](auto x, auto y) { return x & y; }); }
+    friend MapSet operator|(const MapSet& a, const MapSet& b) { return combine(a, b, [](auto x, auto y) { return x | y; }); }
+    MapSet& operator&=(const MapSet& o) { return *this = *this & o; }
+    MapSet& operator|=(const MapSet& o) { return *this = *this | o; }
+
+    bool operator==(const MapSet& o) const { return rest == o.rest && words == o.words; }
+    bool operator!=(const MapSet& o) const { return !(*this == o); }
+
+    friend std::ostream& operator<<(std::ostream& os, const MapSet& a) {
+        if (!a.is_finite())
+            return os << "~" << ~a;
+        os << "{";
+        for (size_t i : a.elements())
+            os << i << ",";
+        return os << "}";
+    }
+};
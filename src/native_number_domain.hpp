@@ -0,0 +1,502 @@
+/*******************************************************************************
+ * Native number domain
+ *
+ * Runs a domain instantiated over checked_number (see checked_number.hpp)
+ * behind the z_number interface of the cfg. The cfg, its linear expressions
+ * and constraints stay over z_number; they are converted when they reach
+ * the domain, which is a copy of a few coefficients that fit in 64 bits.
+ * Inside the domain, bounds and constants are machine words, and GMP is only
+ * used when a computation overflows.
+ *
+ * The interval operations that Crab implements only for z_number (division,
+ * remainder, bitwise operations and shifts) are defined for checked_number
+ * by converting to z_number and back.
+ *
+ * Widening thresholds are converted like constants and passed on to the
+ * wrapped domain.
+ ******************************************************************************/
+
+#pragma once
+
+#include <crab/domains/abstract_domain.hpp>
+#include <crab/domains/abstract_domain_specialized_traits.hpp>
+#include <crab/domains/intervals.hpp>
+#include <crab/support/debug.hpp>
+#include <crab/support/os.hpp>
+#include <crab/support/stats.hpp>
+
+#include <boost/optional.hpp>
+#include <string>
+#include <vector>
+
+#include "checked_number.hpp"
+
+inline crab::crab_os &operator<<(crab::crab_os &o, const checked_number &n) {
+  o << n.get_str();
+  return o;
+}
+
+namespace crab {
+namespace domains {
+namespace native_number_impl {
+
+inline checked_number to_native(const ikos::z_number &n) {
+  return n.fits_int64() ? checked_number((int64_t)n)
+                        : checked_number(n.get_str());
+}
+
+inline ikos::z_number to_z(const checked_number &n) {
+  return n.fits_int64() ? ikos::z_number((int64_t)n)
+                        : ikos::z_number(n.get_str());
+}
+
+inline ikos::bound<checked_number> to_native(const ikos::bound<ikos::z_number> &b) {
+  if (auto n = b.number()) {
+    return ikos::bound<checked_number>(to_native(*n));
+  }
+  return b.is_plus_infinity() ? ikos::bound<checked_number>::plus_infinity()
+                              : ikos::bound<checked_number>::minus_infinity();
+}
+
+inline ikos::bound<ikos::z_number> to_z(const ikos::bound<checked_number> &b) {
+  if (auto n = b.number()) {
+    return ikos::bound<ikos::z_number>(to_z(*n));
+  }
+  return b.is_plus_infinity() ? ikos::bound<ikos::z_number>::plus_infinity()
+                              : ikos::bound<ikos::z_number>::minus_infinity();
+}
+
+// The thresholds are walked in order, from minus infinity
+inline thresholds<checked_number> to_native(const thresholds<ikos::z_number> &ts) {
+  std::vector<ikos::bound<checked_number>> bounds;
+  for (auto b = ts.get_next(ikos::bound<ikos::z_number>::minus_infinity());
+       !b.is_plus_infinity(); b = ts.get_next(b)) {
+    bounds.push_back(to_native(b));
+  }
+  thresholds<checked_number> res(bounds.size());
+  for (const auto &b : bounds) {
+    res.add(b);
+  }
+  return res;
+}
+
+inline ikos::interval<checked_number> to_native(const ikos::interval<ikos::z_number> &i) {
+  if (i.is_bottom()) {
+    return ikos::interval<checked_number>::bottom();
+  }
+  return ikos::interval<checked_number>(to_native(i.lb()), to_native(i.ub()));
+}
+
+inline ikos::interval<ikos::z_number> to_z(const ikos::interval<checked_number> &i) {
+  if (i.is_bottom()) {
+    return ikos::interval<ikos::z_number>::bottom();
+  }
+  return ikos::interval<ikos::z_number>(to_z(i.lb()), to_z(i.ub()));
+}
+
+} // namespace native_number_impl
+} // namespace domains
+} // namespace crab
+
+namespace ikos {
+
+#define NATIVE_INTERVAL_OPERATION(decl, op)                                    \
+  template <>                                                                  \
+  inline interval<checked_number> interval<checked_number>::decl(              \
+      interval<checked_number> x) const {                                      \
+    using namespace crab::domains::native_number_impl;                         \
+    return to_native(to_z(*this) op(to_z(x)));                                 \
+  }
+
+NATIVE_INTERVAL_OPERATION(operator/, /)
+NATIVE_INTERVAL_OPERATION(UDiv, .UDiv)
+NATIVE_INTERVAL_OPERATION(SRem, .SRem)
+NATIVE_INTERVAL_OPERATION(URem, .URem)
+NATIVE_INTERVAL_OPERATION(And, .And)
+NATIVE_INTERVAL_OPERATION(Or, .Or)
+NATIVE_INTERVAL_OPERATION(Xor, .Xor)
+NATIVE_INTERVAL_OPERATION(Shl, .Shl)
+NATIVE_INTERVAL_OPERATION(LShr, .LShr)
+NATIVE_INTERVAL_OPERATION(AShr, .AShr)
+
+#undef NATIVE_INTERVAL_OPERATION
+
+} // namespace ikos
+
+namespace crab {
+namespace domains {
+
+template <typename NativeDomain>
+class native_number_domain final
+    : public abstract_domain_api<native_number_domain<NativeDomain>> {
+
+public:
+  using number_t = ikos::z_number;
+  using varname_t = typename NativeDomain::varname_t;
+
+private:
+  using native_number_domain_t = native_number_domain<NativeDomain>;
+  using abstract_domain_t = abstract_domain_api<native_number_domain_t>;
+
+public:
+  using typename abstract_domain_t::disjunctive_linear_constraint_system_t;
+  using typename abstract_domain_t::interval_t;
+  using typename abstract_domain_t::linear_constraint_system_t;
+  using typename abstract_domain_t::linear_constraint_t;
+  using typename abstract_domain_t::linear_expression_t;
+  using typename abstract_domain_t::reference_constraint_t;
+  using typename abstract_domain_t::variable_or_constant_t;
+  using typename abstract_domain_t::variable_t;
+  using typename abstract_domain_t::variable_vector_t;
+  using typename abstract_domain_t::variable_or_constant_vector_t;
+  using content_domain_t = NativeDomain;
+
+private:
+  using native_t = typename NativeDomain::number_t;
+  using nvariable_t = typename NativeDomain::variable_t;
+  using nvariable_vector_t = typename NativeDomain::variable_vector_t;
+  using nlinear_expression_t = typename NativeDomain::linear_expression_t;
+  using nlinear_constraint_t = typename NativeDomain::linear_constraint_t;
+  using nlinear_constraint_system_t =
+      typename NativeDomain::linear_constraint_system_t;
+
+  NativeDomain _inv;
+
+  explicit native_number_domain(NativeDomain inv) : _inv(std::move(inv)) {}
+
+  /* Conversions */
+
+  static native_t convert(const number_t &n) {
+    return native_number_impl::to_native(n);
+  }
+
+  static number_t convert(const native_t &n) {
+    return native_number_impl::to_z(n);
+  }
+
+  static nvariable_t convert(const variable_t &v) {
+    return nvariable_t(v.name(), v.get_type());
+  }
+
+  static variable_t convert(const nvariable_t &v) {
+    return variable_t(v.name(), v.get_type());
+  }
+
+  static nvariable_vector_t convert(const variable_vector_t &vs) {
+    nvariable_vector_t res;
+    for (const variable_t &v : vs) {
+      res.push_back(convert(v));
+    }
+    return res;
+  }
+
+  static nlinear_expression_t convert(const linear_expression_t &e) {
+    nlinear_expression_t res(convert(e.constant()));
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      res = res + convert(it->first) * convert(it->second);
+    }
+    return res;
+  }
+
+  static linear_expression_t convert(const nlinear_expression_t &e) {
+    linear_expression_t res(convert(e.constant()));
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      res = res + convert(it->first) * convert(it->second);
+    }
+    return res;
+  }
+
+  template <typename To, typename From>
+  static typename To::kind_t convert_kind(const From &cst) {
+    if (cst.is_equality()) {
+      return To::EQUALITY;
+    } else if (cst.is_disequation()) {
+      return To::DISEQUATION;
+    } else if (cst.is_strict_inequality()) {
+      return To::STRICT_INEQUALITY;
+    } else {
+      return To::INEQUALITY;
+    }
+  }
+
+  static nlinear_constraint_t convert(const linear_constraint_t &cst) {
+    return nlinear_constraint_t(convert(cst.expression()),
+                                convert_kind<nlinear_constraint_t>(cst));
+  }
+
+  static linear_constraint_t convert(const nlinear_constraint_t &cst) {
+    return linear_constraint_t(convert(cst.expression()),
+                               convert_kind<linear_constraint_t>(cst));
+  }
+
+  void backward_forget(const variable_t &x,
+                       const native_number_domain_t &inv) {
+    _inv -= convert(x);
+    _inv = _inv & inv._inv;
+  }
+
+public:
+  native_number_domain() { _inv.set_to_top(); }
+
+  native_number_domain_t make_top() const override {
+    return native_number_domain_t(_inv.make_top());
+  }
+
+  native_number_domain_t make_bottom() const override {
+    return native_number_domain_t(_inv.make_bottom());
+  }
+
+  void set_to_top() override { _inv.set_to_top(); }
+
+  void set_to_bottom() override { _inv.set_to_bottom(); }
+
+  bool is_bottom() const override { return _inv.is_bottom(); }
+
+  bool is_top() const override { return _inv.is_top(); }
+
+  bool operator<=(const native_number_domain_t &other) const override {
+    return _inv <= other._inv;
+  }
+
+  void operator|=(const native_number_domain_t &other) override {
+    _inv |= other._inv;
+  }
+
+  native_number_domain_t
+  operator|(const native_number_domain_t &other) const override {
+    return native_number_domain_t(_inv | other._inv);
+  }
+
+  native_number_domain_t
+  operator&(const native_number_domain_t &other) const override {
+    return native_number_domain_t(_inv & other._inv);
+  }
+
+  native_number_domain_t
+  operator||(const native_number_domain_t &other) const override {
+    return native_number_domain_t(_inv || other._inv);
+  }
+
+  native_number_domain_t
+  widening_thresholds(const native_number_domain_t &other,
+                      const thresholds<number_t> &ts) const override {
+    return native_number_domain_t(
+        _inv.widening_thresholds(other._inv, native_number_impl::to_native(ts)));
+  }
+
+  native_number_domain_t
+  operator&&(const native_number_domain_t &other) const override {
+    return native_number_domain_t(_inv && other._inv);
+  }
+
+  void forget(const variable_vector_t &variables) override {
+    _inv.forget(convert(variables));
+  }
+
+  void project(const variable_vector_t &variables) override {
+    _inv.project(convert(variables));
+  }
+
+  void expand(const variable_t &var, const variable_t &new_var) override {
+    _inv.expand(convert(var), convert(new_var));
+  }
+
+  void normalize() override { _inv.normalize(); }
+
+  void minimize() override { _inv.minimize(); }
+
+  void operator+=(const linear_constraint_system_t &csts) override {
+    crab::CrabStats::count(domain_name() + ".count.add_constraints");
+    crab::ScopedCrabStats __st__(domain_name() + ".add_constraints");
+    nlinear_constraint_system_t ncsts;
+    for (const linear_constraint_t &cst : csts) {
+      ncsts += convert(cst);
+    }
+    _inv += ncsts;
+  }
+
+  void operator-=(const variable_t &var) override { _inv -= convert(var); }
+
+  void assign(const variable_t &x, const linear_expression_t &e) override {
+    crab::CrabStats::count(domain_name() + ".count.assign");
+    crab::ScopedCrabStats __st__(domain_name() + ".assign");
+    _inv.assign(convert(x), convert(e));
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             number_t z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, convert(x), convert(y), convert(z));
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, convert(x), convert(y), convert(z));
+  }
+
+  void apply(int_conv_operation_t op, const variable_t &dst,
+             const variable_t &src) override {
+    _inv.apply(op, convert(dst), convert(src));
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, convert(x), convert(y), convert(z));
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             number_t k) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, convert(x), convert(y), convert(k));
+  }
+
+  void select(const variable_t &lhs, const linear_constraint_t &cond,
+              const linear_expression_t &e1,
+              const linear_expression_t &e2) override {
+    _inv.select(convert(lhs), convert(cond), convert(e1), convert(e2));
+  }
+
+  void backward_assign(const variable_t &x, const linear_expression_t &e,
+                       const native_number_domain_t &inv) override {
+    _inv.backward_assign(convert(x), convert(e), inv._inv);
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, number_t z,
+                      const native_number_domain_t &inv) override {
+    _inv.backward_apply(op, convert(x), convert(y), convert(z), inv._inv);
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, const variable_t &z,
+                      const native_number_domain_t &inv) override {
+    _inv.backward_apply(op, convert(x), convert(y), convert(z), inv._inv);
+  }
+
+  // boolean operators: booleans are not tracked
+  virtual void assign_bool_cst(const variable_t &lhs,
+                               const linear_constraint_t &rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void assign_bool_ref_cst(const variable_t &lhs,
+                                   const reference_constraint_t &rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                               bool is_not_rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void apply_binary_bool(bool_operation_t op, const variable_t &x,
+                                 const variable_t &y,
+                                 const variable_t &z) override {
+    *this -= x;
+  }
+
+  virtual void assume_bool(const variable_t &v, bool is_negated) override {}
+
+  virtual void select_bool(const variable_t &lhs, const variable_t &cond,
+                           const variable_t &b1, const variable_t &b2) override {
+    *this -= lhs;
+  }
+
+  // backward boolean operators
+  virtual void
+  backward_assign_bool_cst(const variable_t &lhs,
+                           const linear_constraint_t &rhs,
+                           const native_number_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_assign_bool_ref_cst(const variable_t &lhs,
+                               const reference_constraint_t &rhs,
+                               const native_number_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                           bool is_not_rhs,
+                           const native_number_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_apply_binary_bool(bool_operation_t op, const variable_t &x,
+                             const variable_t &y, const variable_t &z,
+                             const native_number_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  /// native_number_domain is a scalar domain: arrays are handled by the
+  /// array domain on top of it.
+  ARRAY_OPERATIONS_NOT_IMPLEMENTED(native_number_domain_t)
+  REGION_AND_REFERENCE_OPERATIONS_NOT_IMPLEMENTED(native_number_domain_t)
+
+  linear_constraint_system_t to_linear_constraint_system() const override {
+    linear_constraint_system_t csts;
+    for (const nlinear_constraint_t &cst : _inv.to_linear_constraint_system()) {
+      csts += convert(cst);
+    }
+    return csts;
+  }
+
+  disjunctive_linear_constraint_system_t
+  to_disjunctive_linear_constraint_system() const override {
+    auto lin_csts = to_linear_constraint_system();
+    if (lin_csts.is_false()) {
+      return disjunctive_linear_constraint_system_t(true /*is_false*/);
+    } else if (lin_csts.is_true()) {
+      return disjunctive_linear_constraint_system_t(false /*is_false*/);
+    } else {
+      return disjunctive_linear_constraint_system_t(lin_csts);
+    }
+  }
+
+  virtual interval_t operator[](const variable_t &v) override {
+    return native_number_impl::to_z(_inv[convert(v)]);
+  }
+
+  /* begin intrinsics operations */
+  void intrinsic(std::string name, const variable_or_constant_vector_t &inputs,
+                 const variable_vector_t &outputs) override {
+    CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+  }
+
+  void backward_intrinsic(std::string name,
+                          const variable_or_constant_vector_t &inputs,
+                          const variable_vector_t &outputs,
+                          const native_number_domain_t &invariant) override {
+    CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+  }
+  /* end intrinsics operations */
+
+  void write(crab_os &o) const override { o << _inv; }
+
+  std::string domain_name() const override {
+    return "Native(" + _inv.domain_name() + ")";
+  }
+
+  void rename(const variable_vector_t &from,
+              const variable_vector_t &to) override {
+    _inv.rename(convert(from), convert(to));
+  }
+}; // end native_number_domain
+
+template <typename NativeDomain>
+struct abstract_domain_traits<native_number_domain<NativeDomain>> {
+  using number_t = ikos::z_number;
+  using varname_t = typename NativeDomain::varname_t;
+};
+
+} // namespace domains
+} // namespace crab
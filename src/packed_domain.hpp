@@ -0,0 +1,652 @@
+/*******************************************************************************
+ * Packed domain
+ *
+ * Product of intervals over all variables with one relational domain per
+ * variable pack (see packing.hpp). The packs are those of global_packing,
+ * computed from the cfg before the analysis.
+ *
+ * An operation whose variables all belong to one pack is also applied to
+ * that pack, and the result is used to tighten the intervals of the
+ * variables it assigns or constrains. Otherwise only the intervals are
+ * updated, and a variable assigned outside of its pack is bounded in its
+ * pack by its new interval. A pack that was never constrained is not
+ * stored.
+ *
+ * Backward operations are coarse: the assigned variable is forgotten and
+ * the result is met with the forward invariant.
+ ******************************************************************************/
+
+#pragma once
+
+#include <crab/domains/abstract_domain.hpp>
+#include <crab/domains/abstract_domain_specialized_traits.hpp>
+#include <crab/domains/intervals.hpp>
+#include <crab/support/debug.hpp>
+#include <crab/support/stats.hpp>
+
+#include <boost/optional.hpp>
+#include <map>
+#include <vector>
+
+#include "packing.hpp"
+
+namespace crab {
+namespace domains {
+
+template <typename RelDomain>
+class packed_domain final
+    : public abstract_domain_api<packed_domain<RelDomain>> {
+
+public:
+  using number_t = typename RelDomain::number_t;
+  using varname_t = typename RelDomain::varname_t;
+
+private:
+  using packed_domain_t = packed_domain<RelDomain>;
+  using abstract_domain_t = abstract_domain_api<packed_domain_t>;
+
+public:
+  using typename abstract_domain_t::disjunctive_linear_constraint_system_t;
+  using typename abstract_domain_t::interval_t;
+  using typename abstract_domain_t::linear_constraint_system_t;
+  using typename abstract_domain_t::linear_constraint_t;
+  using typename abstract_domain_t::linear_expression_t;
+  using typename abstract_domain_t::reference_constraint_t;
+  using typename abstract_domain_t::variable_or_constant_t;
+  using typename abstract_domain_t::variable_t;
+  using typename abstract_domain_t::variable_vector_t;
+  using typename abstract_domain_t::variable_or_constant_vector_t;
+
+private:
+  using intervals_t = ikos::interval_domain<number_t, varname_t>;
+  using pack_map_t = std::map<size_t, RelDomain>;
+
+  intervals_t _intervals;
+  // a missing pack is top
+  pack_map_t _packs;
+
+  packed_domain(intervals_t intervals, pack_map_t packs)
+      : _intervals(std::move(intervals)), _packs(std::move(packs)) {}
+
+  static boost::optional<size_t> pack_of(const variable_t &v) {
+    if (auto p = global_packing.pack_of(v.index())) {
+      return *p;
+    }
+    return boost::none;
+  }
+
+  // The pack of x, if it also holds all the other variables.
+  static boost::optional<size_t> pack_of(const variable_t &x,
+                                         const linear_expression_t &e) {
+    auto p = pack_of(x);
+    for (auto it = e.begin(); p && it != e.end(); ++it) {
+      if (pack_of(it->second) != p) {
+        return boost::none;
+      }
+    }
+    return p;
+  }
+
+  static boost::optional<size_t> pack_of(const variable_vector_t &vars) {
+    if (vars.empty()) {
+      return boost::none;
+    }
+    auto p = pack_of(vars[0]);
+    for (const variable_t &v : vars) {
+      if (pack_of(v) != p) {
+        return boost::none;
+      }
+    }
+    return p;
+  }
+
+  RelDomain &get_pack(size_t p) {
+    auto it = _packs.find(p);
+    if (it == _packs.end()) {
+      it = _packs.emplace(p, RelDomain()).first;
+    }
+    return it->second;
+  }
+
+  static linear_constraint_system_t bounds(const variable_t &x,
+                                           const interval_t &i) {
+    linear_constraint_system_t csts;
+    if (auto ub = i.ub().number()) {
+      csts += linear_constraint_t(x - *ub, linear_constraint_t::INEQUALITY);
+    }
+    if (auto lb = i.lb().number()) {
+      csts += linear_constraint_t(*lb - x, linear_constraint_t::INEQUALITY);
+    }
+    return csts;
+  }
+
+  // x was changed outside its pack: bound it there by its interval.
+  void refresh(const variable_t &x) {
+    auto p = pack_of(x);
+    if (!p) {
+      return;
+    }
+    auto it = _packs.find(*p);
+    if (it != _packs.end()) {
+      it->second -= x;
+      it->second += bounds(x, _intervals[x]);
+    }
+  }
+
+  // x was changed in pack p: tighten its interval.
+  void reduce(size_t p, const variable_t &x) {
+    RelDomain &pack = get_pack(p);
+    if (pack.is_bottom()) {
+      set_to_bottom();
+      return;
+    }
+    interval_t i = _intervals[x] & pack[x];
+    if (i.is_bottom()) {
+      set_to_bottom();
+    } else {
+      _intervals.set(x, i);
+    }
+  }
+
+  void backward_forget(const variable_t &x, const packed_domain_t &inv) {
+    *this -= x;
+    *this = *this & inv;
+  }
+
+  template <typename Op>
+  static pack_map_t common_packs(const pack_map_t &a, const pack_map_t &b,
+                                 Op op) {
+    pack_map_t res;
+    for (auto const &[p, inv] : a) {
+      auto it = b.find(p);
+      if (it != b.end()) {
+        res.emplace(p, op(inv, it->second));
+      }
+    }
+    return res;
+  }
+
+  template <typename Op>
+  static pack_map_t all_packs(const pack_map_t &a, const pack_map_t &b,
+                              Op op) {
+    pack_map_t res = a;
+    for (auto const &[p, inv] : b) {
+      auto it = res.find(p);
+      if (it == res.end()) {
+        res.emplace(p, inv);
+      } else {
+        it->second = op(it->second, inv);
+      }
+    }
+    return res;
+  }
+
+public:
+  packed_domain() { _intervals.set_to_top(); }
+
+  packed_domain_t make_top() const override { return packed_domain_t(); }
+
+  packed_domain_t make_bottom() const override {
+    packed_domain_t res;
+    res.set_to_bottom();
+    return res;
+  }
+
+  void set_to_top() override {
+    _intervals.set_to_top();
+    _packs.clear();
+  }
+
+  void set_to_bottom() override {
+    _intervals.set_to_bottom();
+    _packs.clear();
+  }
+
+  bool is_bottom() const override { return _intervals.is_bottom(); }
+
+  bool is_top() const override {
+    if (!_intervals.is_top()) {
+      return false;
+    }
+    for (auto const &[p, inv] : _packs) {
+      if (!inv.is_top()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator<=(const packed_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.leq");
+    crab::ScopedCrabStats __st__(domain_name() + ".leq");
+    if (is_bottom()) {
+      return true;
+    }
+    if (other.is_bottom() || !(_intervals <= other._intervals)) {
+      return false;
+    }
+    for (auto const &[p, inv] : other._packs) {
+      auto it = _packs.find(p);
+      if (!(it == _packs.end() ? RelDomain() <= inv : it->second <= inv)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void operator|=(const packed_domain_t &other) override {
+    *this = *this | other;
+  }
+
+  packed_domain_t operator|(const packed_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.join");
+    crab::ScopedCrabStats __st__(domain_name() + ".join");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return packed_domain_t(
+        _intervals | other._intervals,
+        common_packs(_packs, other._packs,
+                     [](const RelDomain &a, const RelDomain &b) { return a | b; }));
+  }
+
+  packed_domain_t operator&(const packed_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.meet");
+    crab::ScopedCrabStats __st__(domain_name() + ".meet");
+    packed_domain_t res(
+        _intervals & other._intervals,
+        all_packs(_packs, other._packs,
+                  [](const RelDomain &a, const RelDomain &b) { return a & b; }));
+    for (auto const &[p, inv] : res._packs) {
+      if (inv.is_bottom()) {
+        return make_bottom();
+      }
+    }
+    return res;
+  }
+
+  packed_domain_t operator||(const packed_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.widening");
+    crab::ScopedCrabStats __st__(domain_name() + ".widening");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return packed_domain_t(
+        _intervals || other._intervals,
+        common_packs(_packs, other._packs,
+                     [](const RelDomain &a, const RelDomain &b) { return a || b; }));
+  }
+
+  packed_domain_t widening_thresholds(
+      const packed_domain_t &other,
+      const thresholds<number_t> &ts) const override {
+    crab::CrabStats::count(domain_name() + ".count.widening");
+    crab::ScopedCrabStats __st__(domain_name() + ".widening");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return packed_domain_t(
+        _intervals.widening_thresholds(other._intervals, ts),
+        common_packs(_packs, other._packs,
+                     [&ts](const RelDomain &a, const RelDomain &b) {
+                       return a.widening_thresholds(b, ts);
+                     }));
+  }
+
+  // A pack missing on one side is top, and narrowing top gives the other.
+  packed_domain_t operator&&(const packed_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.narrowing");
+    crab::ScopedCrabStats __st__(domain_name() + ".narrowing");
+    if (is_bottom() || other.is_bottom()) {
+      return make_bottom();
+    }
+    return packed_domain_t(
+        _intervals && other._intervals,
+        all_packs(_packs, other._packs,
+                  [](const RelDomain &a, const RelDomain &b) { return a && b; }));
+  }
+
+  void forget(const variable_vector_t &variables) override {
+    _intervals.forget(variables);
+    for (const variable_t &v : variables) {
+      if (auto p = pack_of(v)) {
+        auto it = _packs.find(*p);
+        if (it != _packs.end()) {
+          it->second -= v;
+        }
+      }
+    }
+  }
+
+  void project(const variable_vector_t &variables) override {
+    _intervals.project(variables);
+    for (auto &[p, inv] : _packs) {
+      variable_vector_t kept;
+      for (const variable_t &v : variables) {
+        if (pack_of(v) == boost::optional<size_t>(p)) {
+          kept.push_back(v);
+        }
+      }
+      inv.project(kept);
+    }
+  }
+
+  void expand(const variable_t &var, const variable_t &new_var) override {
+    _intervals.expand(var, new_var);
+    auto p = pack_of(var);
+    if (p && pack_of(new_var) == p) {
+      get_pack(*p).expand(var, new_var);
+    } else {
+      refresh(new_var);
+    }
+  }
+
+  void normalize() override {
+    for (auto &[p, inv] : _packs) {
+      inv.normalize();
+    }
+  }
+
+  void minimize() override {
+    for (auto &[p, inv] : _packs) {
+      inv.minimize();
+    }
+  }
+
+  void operator+=(const linear_constraint_system_t &csts) override {
+    crab::CrabStats::count(domain_name() + ".count.add_constraints");
+    crab::ScopedCrabStats __st__(domain_name() + ".add_constraints");
+    for (const linear_constraint_t &cst : csts) {
+      if (is_bottom()) {
+        return;
+      }
+      _intervals += linear_constraint_system_t(cst);
+      const linear_expression_t &e = cst.expression();
+      if (e.size() == 0 || is_bottom()) {
+        continue;
+      }
+      const variable_t &first = e.begin()->second;
+      if (auto p = pack_of(first, e)) {
+        get_pack(*p) += linear_constraint_system_t(cst);
+        for (auto it = e.begin(); it != e.end() && !is_bottom(); ++it) {
+          reduce(*p, it->second);
+        }
+      }
+    }
+  }
+
+  void operator-=(const variable_t &var) override {
+    _intervals -= var;
+    if (auto p = pack_of(var)) {
+      auto it = _packs.find(*p);
+      if (it != _packs.end()) {
+        it->second -= var;
+      }
+    }
+  }
+
+  void assign(const variable_t &x, const linear_expression_t &e) override {
+    crab::CrabStats::count(domain_name() + ".count.assign");
+    crab::ScopedCrabStats __st__(domain_name() + ".assign");
+    if (is_bottom()) {
+      return;
+    }
+    _intervals.assign(x, e);
+    if (auto p = pack_of(x, e)) {
+      get_pack(*p).assign(x, e);
+      reduce(*p, x);
+    } else {
+      refresh(x);
+    }
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             number_t z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _intervals.apply(op, x, y, z);
+    if (auto p = pack_of({x, y})) {
+      get_pack(*p).apply(op, x, y, z);
+      reduce(*p, x);
+    } else {
+      refresh(x);
+    }
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _intervals.apply(op, x, y, z);
+    if (auto p = pack_of({x, y, z})) {
+      get_pack(*p).apply(op, x, y, z);
+      reduce(*p, x);
+    } else {
+      refresh(x);
+    }
+  }
+
+  void apply(int_conv_operation_t op, const variable_t &dst,
+             const variable_t &src) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _intervals.apply(op, dst, src);
+    if (auto p = pack_of({dst, src})) {
+      get_pack(*p).apply(op, dst, src);
+      reduce(*p, dst);
+    } else {
+      refresh(dst);
+    }
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _intervals.apply(op, x, y, z);
+    if (auto p = pack_of({x, y, z})) {
+      get_pack(*p).apply(op, x, y, z);
+      reduce(*p, x);
+    } else {
+      refresh(x);
+    }
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             number_t k) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _intervals.apply(op, x, y, k);
+    if (auto p = pack_of({x, y})) {
+      get_pack(*p).apply(op, x, y, k);
+      reduce(*p, x);
+    } else {
+      refresh(x);
+    }
+  }
+
+  void select(const variable_t &lhs, const linear_constraint_t &cond,
+              const linear_expression_t &e1,
+              const linear_expression_t &e2) override {
+    _intervals.select(lhs, cond, e1, e2);
+    auto p = pack_of(lhs, cond.expression());
+    if (p && pack_of(lhs, e1) == p && pack_of(lhs, e2) == p) {
+      get_pack(*p).select(lhs, cond, e1, e2);
+      reduce(*p, lhs);
+    } else {
+      refresh(lhs);
+    }
+  }
+
+  void backward_assign(const variable_t &x, const linear_expression_t &e,
+                       const packed_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, number_t z,
+                      const packed_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, const variable_t &z,
+                      const packed_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  // boolean operators: booleans are not tracked
+  virtual void assign_bool_cst(const variable_t &lhs,
+                               const linear_constraint_t &rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void assign_bool_ref_cst(const variable_t &lhs,
+                                   const reference_constraint_t &rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                               bool is_not_rhs) override {
+    *this -= lhs;
+  }
+
+  virtual void apply_binary_bool(bool_operation_t op, const variable_t &x,
+                                 const variable_t &y,
+                                 const variable_t &z) override {
+    *this -= x;
+  }
+
+  virtual void assume_bool(const variable_t &v, bool is_negated) override {}
+
+  virtual void select_bool(const variable_t &lhs, const variable_t &cond,
+                           const variable_t &b1, const variable_t &b2) override {
+    *this -= lhs;
+  }
+
+  // backward boolean operators
+  virtual void
+  backward_assign_bool_cst(const variable_t &lhs,
+                           const linear_constraint_t &rhs,
+                           const packed_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_assign_bool_ref_cst(const variable_t &lhs,
+                               const reference_constraint_t &rhs,
+                               const packed_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                           bool is_not_rhs,
+                           const packed_domain_t &inv) override {
+    backward_forget(lhs, inv);
+  }
+
+  virtual void
+  backward_apply_binary_bool(bool_operation_t op, const variable_t &x,
+                             const variable_t &y, const variable_t &z,
+                             const packed_domain_t &inv) override {
+    backward_forget(x, inv);
+  }
+
+  /// packed_domain is a scalar domain: arrays are handled by the array
+  /// domain on top of it.
+  ARRAY_OPERATIONS_NOT_IMPLEMENTED(packed_domain_t)
+  REGION_AND_REFERENCE_OPERATIONS_NOT_IMPLEMENTED(packed_domain_t)
+
+  linear_constraint_system_t to_linear_constraint_system() const override {
+    linear_constraint_system_t csts = _intervals.to_linear_constraint_system();
+    if (is_bottom()) {
+      return csts;
+    }
+    for (auto const &[p, inv] : _packs) {
+      csts += inv.to_linear_constraint_system();
+    }
+    return csts;
+  }
+
+  disjunctive_linear_constraint_system_t
+  to_disjunctive_linear_constraint_system() const override {
+    auto lin_csts = to_linear_constraint_system();
+    if (lin_csts.is_false()) {
+      return disjunctive_linear_constraint_system_t(true /*is_false*/);
+    } else if (lin_csts.is_true()) {
+      return disjunctive_linear_constraint_system_t(false /*is_false*/);
+    } else {
+      return disjunctive_linear_constraint_system_t(lin_csts);
+    }
+  }
+
+  virtual interval_t operator[](const variable_t &v) override {
+    return _intervals[v];
+  }
+
+  /* begin intrinsics operations */
+  void intrinsic(std::string name, const variable_or_constant_vector_t &inputs,
+                 const variable_vector_t &outputs) override {
+    CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+  }
+
+  void backward_intrinsic(std::string name,
+                          const variable_or_constant_vector_t &inputs,
+                          const variable_vector_t &outputs,
+                          const packed_domain_t &invariant) override {
+    CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+  }
+  /* end intrinsics operations */
+
+  void write(crab_os &o) const override {
+    o << _intervals;
+    if (is_bottom()) {
+      return;
+    }
+    for (auto const &[p, inv] : _packs) {
+      o << " pack" << p << "=" << inv;
+    }
+  }
+
+  std::string domain_name() const override {
+    return "Packed(" + RelDomain().domain_name() + ")";
+  }
+
+  void rename(const variable_vector_t &from,
+              const variable_vector_t &to) override {
+    _intervals.rename(from, to);
+    for (size_t i = 0; i < from.size(); i++) {
+      auto p = pack_of(from[i]);
+      if (p && pack_of(to[i]) == p) {
+        get_pack(*p).rename({from[i]}, {to[i]});
+        continue;
+      }
+      if (p) {
+        auto it = _packs.find(*p);
+        if (it != _packs.end()) {
+          it->second -= from[i];
+        }
+      }
+      refresh(to[i]);
+    }
+  }
+}; // end packed_domain
+
+template <typename RelDomain>
+struct abstract_domain_traits<packed_domain<RelDomain>> {
+  using number_t = typename RelDomain::number_t;
+  using varname_t = typename RelDomain::varname_t;
+};
+
+} // namespace domains
+} // namespace crab
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+#include "packing.hpp"
+
+variable_packing global_packing;
+
+void variable_packing::clear()
+{
+    pair_weights.clear();
+    variables.clear();
+    packs.clear();
+    pack_index.clear();
+}
+
+void variable_packing::add_occurrence(const std::vector<var_id>& vars)
+{
+    std::vector<var_id> sorted = vars;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    variables.insert(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); i++)
+        for (size_t j = i + 1; j < sorted.size(); j++)
+            pair_weights[{sorted[i], sorted[j]}]++;
+}
+
+void variable_packing::build(size_t max_size)
+{
+    // union-find over the variables seen, with the size of each set
+    std::map<var_id, var_id> parent;
+    std::map<var_id, size_t> size;
+    for (var_id v : variables) {
+        parent[v] = v;
+        size[v] = 1;
+    }
+    auto find = [&](var_id v) {
+        while (parent[v] != v)
+            v = parent[v] = parent[parent[v]];
+        return v;
+    };
+
+    std::vector<std::pair<std::pair<var_id, var_id>, size_t>> pairs(pair_weights.begin(), pair_weights.end());
+    std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    for (const auto& [pair, weight] : pairs) {
+        var_id a = find(pair.first);
+        var_id b = find(pair.second);
+        if (a == b || size[a] + size[b] > max_size)
+            continue;
+        if (size[a] < size[b])
+            std::swap(a, b);
+        parent[b] = a;
+        size[a] += size[b];
+    }
+
+    std::map<var_id, std::vector<var_id>> groups;
+    for (var_id v : variables)
+        groups[find(v)].push_back(v);
+    packs.clear();
+    pack_index.clear();
+    for (auto& [root, vars] : groups) {
+        if (vars.size() < 2)
+            continue;
+        packs.push_back(std::move(vars));
+    }
+    std::sort(packs.begin(), packs.end());
+    for (size_t i = 0; i < packs.size(); i++)
+        for (var_id v : packs[i])
+            pack_index.emplace(v, i);
+}
+
+void variable_packing::write_stats(std::ostream& o) const
+{
+    std::map<size_t, size_t> histogram;
+    size_t largest = 0;
+    for (const auto& pack : packs) {
+        histogram[pack.size()]++;
+        largest = std::max(largest, pack.size());
+    }
+    o << "packs: " << packs.size() << " packs of " << pack_index.size() << "/" << variables.size() << " variables";
+    if (!packs.empty()) {
+        o << ", max size " << largest << ", mean size " << std::fixed << std::setprecision(2)
+          << (double)pack_index.size() / packs.size() << std::defaultfloat << ", sizes";
+        for (auto [size, count] : histogram)
+            o << " " << size << "x" << count;
+    }
+    o << "\n";
+}
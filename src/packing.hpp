@@ -0,0 +1,58 @@
+#pragma once
+
+/**
+ *  Variable packing, as in Astrée.
+ *
+ *  Relational domains are run on small packs of variables rather than on all
+ *  the variables of the program at once. Packs come from a syntactic
+ *  pre-analysis: variables that occur together in an assignment, assumption
+ *  or assertion are related. Each pair of variables is weighed by the number
+ *  of statements it occurs in, and pairs are merged heaviest first as long
+ *  as the resulting pack does not exceed the size limit. Variables that end
+ *  up alone are not packed.
+ **/
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class variable_packing {
+public:
+    using var_id = uint64_t;
+
+private:
+    std::map<std::pair<var_id, var_id>, size_t> pair_weights;
+    std::set<var_id> variables;
+
+    std::vector<std::vector<var_id>> packs;
+    std::unordered_map<var_id, size_t> pack_index;
+
+public:
+    void clear();
+
+    /** Record that vars occur in the same statement. */
+    void add_occurrence(const std::vector<var_id>& vars);
+
+    /** Compute the packs from the occurrences recorded so far. */
+    void build(size_t max_size);
+
+    std::optional<size_t> pack_of(var_id v) const {
+        auto it = pack_index.find(v);
+        if (it == pack_index.end())
+            return {};
+        return it->second;
+    }
+
+    /** Packs, each sorted, in order of their smallest variable. */
+    const std::vector<std::vector<var_id>>& get_packs() const { return packs; }
+
+    /** Number of packs, packed and seen variables, and the distribution of
+     *  pack sizes. */
+    void write_stats(std::ostream& o) const;
+};
+
+extern variable_packing global_packing;
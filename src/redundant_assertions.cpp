@@ -0,0 +1,193 @@
+#include <bitset>
+#include <map>
+#include <optional>
+#include <utility>
+#include <variant>
+
+#include "redundant_assertions.hpp"
+
+using std::vector;
+
+using regs = std::bitset<16>;
+
+// An assertion, by its block and its position in the block
+using origin = std::pair<Label, size_t>;
+
+// The available assertions
+using facts = std::map<origin, const Assertion*>;
+
+static bool subset(const Types& a, const Types& b) { return (a & ~b).none(); }
+
+static std::optional<int64_t> extent(const LinearConstraint& c) {
+    if (!std::holds_alternative<Imm>(c.width))
+        return {};
+    return c.offset + static_cast<int64_t>(std::get<Imm>(c.width).v);
+}
+
+static bool lower(Condition::Op op) { return op == Condition::Op::GE || op == Condition::Op::GT; }
+
+// Whether a holds whenever b holds
+static bool implied(const Assertion& a, const Assertion& b) {
+    if (a == b)
+        return true;
+    return std::visit(overloaded{
+        [&](const TypeConstraint& ta, const TypeConstraint& tb) {
+            if (!(ta.then.reg == tb.then.reg) || !subset(tb.then.types, ta.then.types))
+                return false;
+            if (!tb.given)
+                return true;
+            return ta.given && ta.given->reg == tb.given->reg && subset(ta.given->types, tb.given->types);
+        },
+        [&](const LinearConstraint& la, const LinearConstraint& lb) {
+            if (!(la.reg == lb.reg) || la.op != lb.op || !(la.v == lb.v) || !subset(la.when_types, lb.when_types))
+                return false;
+            if (la.width == lb.width)
+                return la.offset == lb.offset
+                    || (lower(la.op) && la.offset >= lb.offset)
+                    || (la.op == Condition::Op::LE && la.offset <= lb.offset);
+            auto ea = extent(la);
+            auto eb = extent(lb);
+            if (!ea || !eb)
+                return false;
+            return *ea == *eb
+                || (lower(la.op) && *ea >= *eb)
+                || (la.op == Condition::Op::LE && *ea <= *eb);
+        },
+        [](const auto&, const auto&) { return false; },
+    }, a.cst, b.cst);
+}
+
+static void add(regs& rs, const Value& v) {
+    if (std::holds_alternative<Reg>(v))
+        rs.set(std::get<Reg>(v).v);
+}
+
+static regs mentioned(const Assertion& a) {
+    regs res;
+    std::visit(overloaded{
+        [&](const TypeConstraint& tc) {
+            res.set(tc.then.reg.v);
+            if (tc.given)
+                res.set(tc.given->reg.v);
+        },
+        [&](const LinearConstraint& lc) {
+            res.set(lc.reg.v);
+            add(res, lc.width);
+            add(res, lc.v);
+        },
+    }, a.cst);
+    return res;
+}
+
+static regs written(const Instruction& ins) {
+    regs res;
+    std::visit(overloaded{
+        [&](const Bin& a) { res.set(a.dst.v); },
+        [&](const Un& a) { res.set(a.dst.v); },
+        [&](const LoadMapFd& a) { res.set(a.dst.v); },
+        [&](const Mem& a) {
+            if (a.is_load)
+                add(res, a.value);
+        },
+        [&](const Call&) { res |= 0x3f; },
+        [&](const Packet&) { res |= 0x3f; },
+        [](const auto&) {},
+    }, ins);
+    return res;
+}
+
+// The available assertion that implies a, if any
+static const origin* implying(const facts& available, const Assertion& a) {
+    for (const auto& [o, b] : available) {
+        if (implied(a, *b))
+            return &o;
+    }
+    return nullptr;
+}
+
+// Transfer of the available assertions over the block. If removed is not
+// null, the redundant assertions are added to it instead of being checked.
+static void run(const Label& label, const BasicBlock& bb, facts& available,
+                std::map<size_t, origin>* removed) {
+    for (size_t i = 0; i < bb.insts.size(); i++) {
+        const Instruction& ins = bb.insts[i];
+        if (std::holds_alternative<Assert>(ins)) {
+            const Assertion& a = *std::get<Assert>(ins).p;
+            if (const origin* o = implying(available, a)) {
+                if (removed)
+                    removed->emplace(i, *o);
+            } else {
+                available.emplace(origin{label, i}, &a);
+            }
+            continue;
+        }
+        regs w = written(ins);
+        if (w.none())
+            continue;
+        for (auto it = available.begin(); it != available.end();) {
+            if ((mentioned(*it->second) & w).any())
+                it = available.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+vector<redundant_assertion> remove_redundant_assertions(Cfg& cfg) {
+    const vector<Label>& labels = cfg.keys();
+    if (labels.empty())
+        return {};
+
+    // Assertions available on entry to each reachable block
+    std::map<Label, facts> in;
+    in[labels.front()] = {};
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const Label& l : labels) {
+            auto it = in.find(l);
+            if (it == in.end())
+                continue;
+            facts available = it->second;
+            run(l, cfg.at(l), available, nullptr);
+            for (const Label& next : cfg.at(l).nextlist) {
+                auto [next_in, inserted] = in.try_emplace(next, available);
+                if (inserted) {
+                    changed = true;
+                    continue;
+                }
+                for (auto f = next_in->second.begin(); f != next_in->second.end();) {
+                    if (available.count(f->first)) {
+                        ++f;
+                    } else {
+                        f = next_in->second.erase(f);
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+    std::map<Label, std::map<size_t, origin>> removed;
+    for (const Label& l : labels) {
+        auto it = in.find(l);
+        if (it == in.end())
+            continue;
+        run(l, cfg.at(l), it->second, &removed[l]);
+    }
+
+    vector<redundant_assertion> res;
+    for (const Label& l : labels) {
+        auto it = removed.find(l);
+        if (it == removed.end() || it->second.empty())
+            continue;
+        vector<Instruction>& insts = cfg[l].insts;
+        for (const auto& [i, o] : it->second)
+            res.push_back({l, std::get<Assert>(insts[i]), o.first});
+        vector<Instruction> kept;
+        for (size_t i = 0; i < insts.size(); i++) {
+            if (!it->second.count(i))
+                kept.push_back(std::move(insts[i]));
+        }
+        insts = std::move(kept);
+    }
+    return res;
+}
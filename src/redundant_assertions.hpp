@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ *  Removal of explicated assertions that earlier assertions imply.
+ *
+ *  An assertion is available at a point if on every path to it from the
+ *  entry the assertion was checked and none of the registers it mentions
+ *  was written since. Since every path goes through it, an available
+ *  assertion dominates the point. An assertion is redundant if an available
+ *  one implies it: the same check, a type check for fewer types, or a bound
+ *  on a larger part of the same region.
+ *
+ *  A redundant assertion holds whenever the assertion that implies it
+ *  holds, so the analysis only has to check the latter. A failure is
+ *  reported once, at the assertion that implies it; the removed one is
+ *  listed as implied by it.
+ **/
+#include <vector>
+
+#include "asm_cfg.hpp"
+#include "spec_assertions.hpp"
+
+struct redundant_assertion {
+    /** The block the assertion was removed from. */
+    Label label;
+    Assert assertion;
+    /** The block of the assertion that implies it. */
+    Label implied_by;
+};
+
+/** Remove the redundant assertions of the blocks reachable from the entry,
+ *  in the order of the blocks. */
+std::vector<redundant_assertion> remove_redundant_assertions(Cfg& cfg);
@@ -0,0 +1,968 @@
+/*******************************************************************************
+ * Region domain
+ *
+ * Reduced product of a numerical domain with a finite-set domain for region
+ * tags.
+ *
+ * The translation models every register as a value, an offset and a region
+ * tag (rN, offN, tN), and the stack as three arrays (S_r, S_off, S_t). Tags
+ * range over a handful of constants (see region_tags.hpp), so keeping them in
+ * a relational domain only makes its graph larger. This domain keeps the tag
+ * variables (tN and the cells of S_t) as tag sets and passes only the other
+ * variables to the numerical domain, which never sees a tag variable.
+ *
+ * Constraints mixing tags and numbers, like `off <= t - width` for shared
+ * regions, are handled by case splitting over the tags involved: the
+ * numerical domain is constrained once per combination of tag values and the
+ * results are joined. Values flowing between tags and numerical temporaries
+ * (e.g., through the sign extension after loading a tag from the stack) are
+ * converted through intervals.
+ *
+ * Backward operations are only precise on the numerical part.
+ ******************************************************************************/
+
+#pragma once
+
+#include <crab/domains/abstract_domain.hpp>
+#include <crab/domains/abstract_domain_specialized_traits.hpp>
+#include <crab/support/debug.hpp>
+#include <crab/support/stats.hpp>
+
+#include <algorithm>
+#include <boost/optional.hpp>
+#include <cctype>
+#include <functional>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "region_tags.hpp"
+
+namespace crab {
+namespace domains {
+
+template <typename NumDomain>
+class region_domain final
+    : public abstract_domain_api<region_domain<NumDomain>> {
+
+public:
+  using number_t = typename NumDomain::number_t;
+  using varname_t = typename NumDomain::varname_t;
+
+private:
+  using region_domain_t = region_domain<NumDomain>;
+  using abstract_domain_t = abstract_domain_api<region_domain_t>;
+
+public:
+  using typename abstract_domain_t::disjunctive_linear_constraint_system_t;
+  using typename abstract_domain_t::interval_t;
+  using typename abstract_domain_t::linear_constraint_system_t;
+  using typename abstract_domain_t::linear_constraint_t;
+  using typename abstract_domain_t::linear_expression_t;
+  using typename abstract_domain_t::reference_constraint_t;
+  using typename abstract_domain_t::variable_or_constant_t;
+  using typename abstract_domain_t::variable_t;
+  using typename abstract_domain_t::variable_vector_t;
+  using typename abstract_domain_t::variable_or_constant_vector_t;
+  using content_domain_t = NumDomain;
+
+private:
+  using tag_env_t = std::map<variable_t, tag_set>;
+  using term_t = std::pair<number_t, variable_t>;
+
+  // Most combinations of tag values an operation is split over; past it,
+  // the tags involved are treated as unknown.
+  static constexpr size_t max_cases = 16;
+
+  // numerical part, over non-tag variables only
+  NumDomain _inv;
+  // tag part; a missing variable is unconstrained
+  tag_env_t _tags;
+
+  region_domain(NumDomain inv, tag_env_t tags)
+      : _inv(std::move(inv)), _tags(std::move(tags)) {}
+
+  // whether the variable of each index is a tag, for the variable factory
+  // of the current analysis
+  static std::unordered_map<ikos::index_t, bool> &tag_cache() {
+    static std::unordered_map<ikos::index_t, bool> cache;
+    return cache;
+  }
+
+public:
+  /** Forget which variables are tags: the next analysis has another
+   *  variable factory, which gives the same indices to other names. */
+  static void clear_global_state() { tag_cache().clear(); }
+
+  /** Tag variables are the region of a register (t0..t10) and the
+   *  region array of the stack (S_t) with its cells. */
+  static bool is_tag(const variable_t &v) {
+    auto &cache = tag_cache();
+    auto it = cache.find(v.index());
+    if (it != cache.end()) {
+      return it->second;
+    }
+    std::string name = v.name().str();
+    bool res = name.compare(0, 3, "S_t") == 0 ||
+               (name.size() > 1 && name[0] == 't' &&
+                std::all_of(name.begin() + 1, name.end(), ::isdigit));
+    cache.emplace(v.index(), res);
+    return res;
+  }
+
+private:
+  static tag_set tag_top() { return tag_set::top(); }
+
+  tag_set get_tags(const variable_t &v) const {
+    auto it = _tags.find(v);
+    return it == _tags.end() ? tag_top() : it->second;
+  }
+
+  // The tags of the join of this and other, neither being bottom
+  tag_env_t join_tags(const region_domain_t &other) const {
+    tag_env_t tags;
+    for (auto const &[v, s] : _tags) {
+      auto it = other._tags.find(v);
+      if (it != other._tags.end()) {
+        tag_set j = s | it->second;
+        if (!j.is_top()) {
+          tags.emplace(v, j);
+        }
+      }
+    }
+    return tags;
+  }
+
+  void set_tags(const variable_t &v, const tag_set &s) {
+    if (s.is_bottom()) {
+      set_to_bottom();
+    } else if (s.is_top()) {
+      _tags.erase(v);
+    } else {
+      _tags[v] = s;
+    }
+  }
+
+  static boost::optional<int64_t> to_int64(const boost::optional<number_t> &n) {
+    if (!n || !n->fits_int64()) {
+      return boost::none;
+    }
+    return (int64_t)*n;
+  }
+
+  static tag_set tags_of_interval(const interval_t &i) {
+    auto lb = to_int64(i.lb().number());
+    auto ub = to_int64(i.ub().number());
+    if (!lb || !ub) {
+      return tag_top();
+    }
+    return tag_set::range(*lb, *ub);
+  }
+
+  static interval_t interval_of_tags(const tag_set &s) {
+    if (s.is_top()) {
+      return interval_t::top();
+    }
+    if (s.is_bottom()) {
+      return interval_t::bottom();
+    }
+    return interval_t(number_t(s.min()), number_t(s.max()));
+  }
+
+  // Split the terms of e into tag and numerical terms.
+  static void split(const linear_expression_t &e, std::vector<term_t> &tags,
+                    std::vector<term_t> &nums) {
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      (is_tag(it->second) ? tags : nums).push_back(*it);
+    }
+  }
+
+  // Enumerate all combinations of values of the given tag variables, or
+  // return false if some is top or there are too many.
+  bool for_each_case(const std::vector<term_t> &terms,
+                     std::function<void(const std::vector<int64_t> &)> f) const {
+    size_t cases = 1;
+    std::vector<std::vector<int64_t>> values;
+    for (const term_t &t : terms) {
+      tag_set s = get_tags(t.second);
+      if (s.is_top()) {
+        return false;
+      }
+      cases *= s.size();
+      if (cases > max_cases) {
+        return false;
+      }
+      values.emplace_back();
+      s.for_each([&](int64_t v) { values.back().push_back(v); });
+    }
+    std::vector<int64_t> current(terms.size());
+    std::function<void(size_t)> rec = [&](size_t i) {
+      if (i == terms.size()) {
+        f(current);
+        return;
+      }
+      for (int64_t v : values[i]) {
+        current[i] = v;
+        rec(i + 1);
+      }
+    };
+    rec(0);
+    return true;
+  }
+
+  // e with the tag terms replaced by the given values
+  static linear_expression_t substitute(const linear_expression_t &e,
+                                        const std::vector<term_t> &tags,
+                                        const std::vector<int64_t> &values) {
+    linear_expression_t res(e.constant());
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      if (!is_tag(it->second)) {
+        res = res + it->first * it->second;
+      }
+    }
+    for (size_t i = 0; i < tags.size(); i++) {
+      res = res + tags[i].first * number_t(values[i]);
+    }
+    return res;
+  }
+
+  // Interval of e, with tag variables replaced by their hull.
+  interval_t to_interval(const linear_expression_t &e) {
+    interval_t r(e.constant());
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      interval_t c(it->first);
+      if (is_tag(it->second)) {
+        r += c * interval_of_tags(get_tags(it->second));
+      } else {
+        r += c * _inv[it->second];
+      }
+    }
+    return r;
+  }
+
+  // Tags denoted by e.
+  tag_set eval_tags(const linear_expression_t &e) {
+    std::vector<term_t> tags, nums;
+    split(e, tags, nums);
+    if (nums.empty()) {
+      tag_set res = tag_set::bottom();
+      bool finite = for_each_case(tags, [&](const std::vector<int64_t> &vals) {
+        auto v = to_int64(substitute(e, tags, vals).constant());
+        res = v ? res | tag_set::singleton(*v) : tag_top();
+      });
+      if (finite) {
+        return res;
+      }
+    }
+    return tags_of_interval(to_interval(e));
+  }
+
+  // Bind the non-tag variable x in the numerical domain to the hull of the
+  // tags of t.
+  void assign_hull(const variable_t &x, const tag_set &t) {
+    _inv -= x;
+    if (auto v = t.singleton_value()) {
+      _inv.assign(x, linear_expression_t(number_t(*v)));
+    } else if (!t.is_top() && !t.is_bottom()) {
+      _inv += linear_constraint_t(linear_expression_t(number_t(t.min())) - x,
+                                  linear_constraint_t::INEQUALITY);
+      _inv += linear_constraint_t(x - number_t(t.max()),
+                                  linear_constraint_t::INEQUALITY);
+    }
+  }
+
+  static bool holds(const linear_expression_t &constant,
+                    typename linear_constraint_t::kind_t kind) {
+    linear_constraint_t c(constant, kind);
+    return !c.is_contradiction();
+  }
+
+  void add_constraint(const linear_constraint_t &cst,
+                      linear_constraint_system_t &numerical) {
+    std::vector<term_t> tags, nums;
+    split(cst.expression(), tags, nums);
+    if (tags.empty()) {
+      numerical += cst;
+      return;
+    }
+    std::vector<tag_set> kept(tags.size(), tag_set::bottom());
+    bool feasible = false;
+    NumDomain cases = _inv.make_bottom();
+    bool finite = for_each_case(tags, [&](const std::vector<int64_t> &vals) {
+      linear_expression_t e = substitute(cst.expression(), tags, vals);
+      if (nums.empty()) {
+        if (!holds(e, cst.kind())) {
+          return;
+        }
+      } else {
+        NumDomain tmp(_inv);
+        tmp += linear_constraint_t(e, cst.kind());
+        if (tmp.is_bottom()) {
+          return;
+        }
+        cases |= tmp;
+      }
+      feasible = true;
+      for (size_t i = 0; i < tags.size(); i++) {
+        kept[i] = kept[i] | tag_set::singleton(vals[i]);
+      }
+    });
+    if (!finite) {
+      // Only a bound on a single unconstrained tag is kept.
+      if (nums.empty() && tags.size() == 1) {
+        set_tags(tags[0].second, restrict_top(cst, tags[0].first));
+      }
+      return;
+    }
+    if (!feasible) {
+      set_to_bottom();
+      return;
+    }
+    if (!nums.empty()) {
+      _inv = cases;
+    }
+    for (size_t i = 0; i < tags.size(); i++) {
+      set_tags(tags[i].second, kept[i]);
+    }
+  }
+
+  // Constraint a*t + k op 0 on a tag t that is top. Only unit coefficients
+  // give a bound that a tag set can represent.
+  static tag_set restrict_top(const linear_constraint_t &cst,
+                              const number_t &a) {
+    auto k = to_int64(boost::optional<number_t>(cst.expression().constant()));
+    if (!k || (a != number_t(1) && a != number_t(-1))) {
+      return tag_top();
+    }
+    // t + k op 0, or -t + k op 0
+    int64_t bound = a == number_t(1) ? -*k : *k;
+    std::optional<int64_t> lb, ub;
+    if (cst.is_equality()) {
+      lb = ub = bound;
+    } else if (cst.is_inequality() || cst.is_strict_inequality()) {
+      int64_t strict = cst.is_strict_inequality() ? 1 : 0;
+      if (a == number_t(1)) {
+        ub = bound - strict;
+      } else {
+        lb = bound + strict;
+      }
+    }
+    return tag_top().restrict(lb, ub);
+  }
+
+public:
+  region_domain() { _inv.set_to_top(); }
+
+  region_domain make_top() const override {
+    NumDomain inv;
+    return region_domain(inv.make_top(), {});
+  }
+
+  region_domain make_bottom() const override {
+    NumDomain inv;
+    return region_domain(inv.make_bottom(), {});
+  }
+
+  void set_to_top() override {
+    _inv.set_to_top();
+    _tags.clear();
+  }
+
+  void set_to_bottom() override {
+    _inv.set_to_bottom();
+    _tags.clear();
+  }
+
+  region_domain(const region_domain_t &other)
+      : _inv(other._inv), _tags(other._tags) {
+    crab::CrabStats::count(domain_name() + ".count.copy");
+    crab::ScopedCrabStats __st__(domain_name() + ".copy");
+  }
+
+  region_domain(const region_domain_t &&other)
+      : _inv(std::move(other._inv)), _tags(std::move(other._tags)) {
+    crab::CrabStats::count(domain_name() + ".count.copy");
+    crab::ScopedCrabStats __st__(domain_name() + ".copy");
+  }
+
+  region_domain_t &operator=(const region_domain_t &other) {
+    crab::CrabStats::count(domain_name() + ".count.copy");
+    crab::ScopedCrabStats __st__(domain_name() + ".copy");
+    if (this != &other) {
+      _inv = other._inv;
+      _tags = other._tags;
+    }
+    return *this;
+  }
+
+  region_domain_t &operator=(const region_domain_t &&other) {
+    crab::CrabStats::count(domain_name() + ".count.copy");
+    crab::ScopedCrabStats __st__(domain_name() + ".copy");
+    if (this != &other) {
+      _inv = std::move(other._inv);
+      _tags = std::move(other._tags);
+    }
+    return *this;
+  }
+
+  bool is_bottom() const override { return _inv.is_bottom(); }
+
+  bool is_top() const override { return _inv.is_top() && _tags.empty(); }
+
+  bool operator<=(const region_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.leq");
+    crab::ScopedCrabStats __st__(domain_name() + ".leq");
+    if (is_bottom()) {
+      return true;
+    }
+    if (other.is_bottom()) {
+      return false;
+    }
+    for (auto const &[v, s] : other._tags) {
+      if (!(get_tags(v) <= s)) {
+        return false;
+      }
+    }
+    return _inv <= other._inv;
+  }
+
+  void operator|=(const region_domain_t &other) override {
+    *this = *this | other;
+  }
+
+  region_domain_t operator|(const region_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.join");
+    crab::ScopedCrabStats __st__(domain_name() + ".join");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return region_domain_t(_inv | other._inv, join_tags(other));
+  }
+
+  region_domain_t operator&(const region_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.meet");
+    crab::ScopedCrabStats __st__(domain_name() + ".meet");
+    region_domain_t res(_inv & other._inv, _tags);
+    for (auto const &[v, s] : other._tags) {
+      if (res.is_bottom()) {
+        break;
+      }
+      res.set_tags(v, res.get_tags(v) & s);
+    }
+    return res;
+  }
+
+  // Tag sets form a finite lattice, so joining them is enough to stabilize.
+  region_domain_t operator||(const region_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.widening");
+    crab::ScopedCrabStats __st__(domain_name() + ".widening");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return region_domain_t(_inv || other._inv, join_tags(other));
+  }
+
+  region_domain_t widening_thresholds(
+      const region_domain_t &other,
+      const thresholds<number_t> &ts) const override {
+    crab::CrabStats::count(domain_name() + ".count.widening");
+    crab::ScopedCrabStats __st__(domain_name() + ".widening");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return region_domain_t(_inv.widening_thresholds(other._inv, ts),
+                           join_tags(other));
+  }
+
+  region_domain_t operator&&(const region_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.narrowing");
+    crab::ScopedCrabStats __st__(domain_name() + ".narrowing");
+    region_domain_t res = *this & other;
+    if (!res.is_bottom()) {
+      res._inv = _inv && other._inv;
+    }
+    return res;
+  }
+
+  void forget(const variable_vector_t &variables) override {
+    variable_vector_t nums;
+    for (const variable_t &v : variables) {
+      if (is_tag(v)) {
+        _tags.erase(v);
+      } else {
+        nums.push_back(v);
+      }
+    }
+    _inv.forget(nums);
+  }
+
+  void project(const variable_vector_t &variables) override {
+    variable_vector_t nums;
+    tag_env_t tags;
+    for (const variable_t &v : variables) {
+      if (is_tag(v)) {
+        auto it = _tags.find(v);
+        if (it != _tags.end()) {
+          tags.insert(*it);
+        }
+      } else {
+        nums.push_back(v);
+      }
+    }
+    _inv.project(nums);
+    std::swap(_tags, tags);
+  }
+
+  void expand(const variable_t &var, const variable_t &new_var) override {
+    if (is_tag(var)) {
+      set_tags(new_var, get_tags(var));
+    } else {
+      _inv.expand(var, new_var);
+    }
+  }
+
+  void normalize() override { _inv.normalize(); }
+
+  void minimize() override { _inv.minimize(); }
+
+  void operator+=(const linear_constraint_system_t &csts) override {
+    crab::CrabStats::count(domain_name() + ".count.add_constraints");
+    crab::ScopedCrabStats __st__(domain_name() + ".add_constraints");
+    linear_constraint_system_t numerical;
+    for (const linear_constraint_t &cst : csts) {
+      if (is_bottom()) {
+        return;
+      }
+      add_constraint(cst, numerical);
+    }
+    if (!is_bottom()) {
+      _inv += numerical;
+    }
+    CRAB_LOG("region", crab::outs() << "assume(" << csts << ")  " << *this << "\n";);
+  }
+
+  void operator-=(const variable_t &var) override {
+    if (is_tag(var)) {
+      _tags.erase(var);
+    } else {
+      _inv -= var;
+    }
+  }
+
+  void assign(const variable_t &x, const linear_expression_t &e) override {
+    crab::CrabStats::count(domain_name() + ".count.assign");
+    crab::ScopedCrabStats __st__(domain_name() + ".assign");
+    if (is_bottom()) {
+      return;
+    }
+    std::vector<term_t> tags, nums;
+    split(e, tags, nums);
+    if (is_tag(x)) {
+      set_tags(x, eval_tags(e));
+    } else if (tags.empty()) {
+      _inv.assign(x, e);
+    } else if (nums.empty() && tags.size() == 1 &&
+               tags[0].first == number_t(1) && e.constant() == number_t(0)) {
+      assign_hull(x, get_tags(tags[0].second));
+    } else {
+      std::vector<int64_t> values;
+      for (const term_t &t : tags) {
+        auto v = get_tags(t.second).singleton_value();
+        if (!v) {
+          _inv -= x;
+          return;
+        }
+        values.push_back(*v);
+      }
+      _inv.assign(x, substitute(e, tags, values));
+    }
+  }
+
+private:
+  // x := f(y, z) where some operand is a tag. A tag result is computed on
+  // the tag sets when it is cheap, otherwise x is forgotten.
+  tag_set tags_of(const variable_t &v) {
+    return is_tag(v) ? get_tags(v) : tags_of_interval(_inv[v]);
+  }
+
+  static tag_set tags_of(const number_t &n) {
+    return n.fits_int64() ? tag_set::singleton((int64_t)n) : tag_top();
+  }
+
+  template <typename Op>
+  void apply_mixed(const variable_t &x, const tag_set &ys, const tag_set &zs,
+                   bool additive, Op op) {
+    tag_set res = tag_set::bottom();
+    if (additive && !ys.is_top() && !zs.is_top() &&
+        ys.size() * zs.size() <= max_cases) {
+      ys.for_each([&](int64_t a) {
+        zs.for_each([&](int64_t b) { res.insert(op(a, b)); });
+      });
+    } else {
+      res = tag_top();
+    }
+    if (is_tag(x)) {
+      set_tags(x, res);
+    } else {
+      assign_hull(x, res);
+    }
+  }
+
+  static bool is_additive(arith_operation_t op) {
+    return op == OP_ADDITION || op == OP_SUBTRACTION;
+  }
+
+  static int64_t eval_additive(arith_operation_t op, int64_t a, int64_t b) {
+    return op == OP_ADDITION ? a + b : a - b;
+  }
+
+public:
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             number_t z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (!is_tag(x) && !is_tag(y)) {
+      _inv.apply(op, x, y, z);
+    } else {
+      apply_mixed(x, tags_of(y), tags_of(z), is_additive(op),
+                  [op](int64_t a, int64_t b) { return eval_additive(op, a, b); });
+    }
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (!is_tag(x) && !is_tag(y) && !is_tag(z)) {
+      _inv.apply(op, x, y, z);
+    } else {
+      apply_mixed(x, tags_of(y), tags_of(z), is_additive(op),
+                  [op](int64_t a, int64_t b) { return eval_additive(op, a, b); });
+    }
+  }
+
+  void select(const variable_t &lhs, const linear_constraint_t &cond,
+              const linear_expression_t &e1,
+              const linear_expression_t &e2) override {
+    std::vector<term_t> tags, nums;
+    split(cond.expression(), tags, nums);
+    split(e1, tags, nums);
+    split(e2, tags, nums);
+    if (!is_tag(lhs) && tags.empty()) {
+      _inv.select(lhs, cond, e1, e2);
+    } else if (is_tag(lhs)) {
+      set_tags(lhs, eval_tags(e1) | eval_tags(e2));
+    } else {
+      _inv -= lhs;
+    }
+  }
+
+  void backward_assign(const variable_t &x, const linear_expression_t &e,
+                       const region_domain_t &inv) override {
+    std::vector<term_t> tags, nums;
+    split(e, tags, nums);
+    if (!is_tag(x) && tags.empty()) {
+      _inv.backward_assign(x, e, inv._inv);
+    } else {
+      *this -= x;
+      *this = *this & inv;
+    }
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, number_t z,
+                      const region_domain_t &inv) override {
+    if (!is_tag(x) && !is_tag(y)) {
+      _inv.backward_apply(op, x, y, z, inv._inv);
+    } else {
+      *this -= x;
+      *this = *this & inv;
+    }
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, const variable_t &z,
+                      const region_domain_t &inv) override {
+    if (!is_tag(x) && !is_tag(y) && !is_tag(z)) {
+      _inv.backward_apply(op, x, y, z, inv._inv);
+    } else {
+      *this -= x;
+      *this = *this & inv;
+    }
+  }
+
+  // Tags are small, so conversions between bit widths preserve them.
+  void apply(int_conv_operation_t op, const variable_t &dst,
+             const variable_t &src) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (!is_tag(dst) && !is_tag(src)) {
+      _inv.apply(op, dst, src);
+    } else if (is_tag(dst)) {
+      set_tags(dst, is_tag(src) ? get_tags(src) : tags_of_interval(_inv[src]));
+    } else {
+      assign_hull(dst, get_tags(src));
+    }
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (!is_tag(x) && !is_tag(y) && !is_tag(z)) {
+      _inv.apply(op, x, y, z);
+    } else {
+      apply_mixed(x, tags_of(y), tags_of(z), false,
+                  [](int64_t a, int64_t) { return a; });
+    }
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             number_t k) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    if (!is_tag(x) && !is_tag(y)) {
+      _inv.apply(op, x, y, k);
+    } else {
+      apply_mixed(x, tags_of(y), tags_of(k), false,
+                  [](int64_t a, int64_t) { return a; });
+    }
+  }
+
+  // boolean operators
+  virtual void assign_bool_cst(const variable_t &lhs,
+                               const linear_constraint_t &rhs) override {
+    _inv.assign_bool_cst(lhs, rhs);
+  }
+
+  virtual void assign_bool_ref_cst(const variable_t &lhs,
+                                   const reference_constraint_t &rhs) override {
+    _inv.assign_bool_ref_cst(lhs, rhs);
+  }
+
+  virtual void assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                               bool is_not_rhs) override {
+    _inv.assign_bool_var(lhs, rhs, is_not_rhs);
+  }
+
+  virtual void apply_binary_bool(bool_operation_t op, const variable_t &x,
+                                 const variable_t &y,
+                                 const variable_t &z) override {
+    _inv.apply_binary_bool(op, x, y, z);
+  }
+
+  virtual void assume_bool(const variable_t &v, bool is_negated) override {
+    _inv.assume_bool(v, is_negated);
+  }
+
+  virtual void select_bool(const variable_t &lhs, const variable_t &cond,
+                           const variable_t &b1, const variable_t &b2) override {
+    _inv.select_bool(lhs, cond, b1, b2);
+  }
+
+  // backward boolean operators
+  virtual void
+  backward_assign_bool_cst(const variable_t &lhs,
+                           const linear_constraint_t &rhs,
+                           const region_domain_t &inv) override {
+    _inv.backward_assign_bool_cst(lhs, rhs, inv._inv);
+  }
+
+  virtual void
+  backward_assign_bool_ref_cst(const variable_t &lhs,
+                               const reference_constraint_t &rhs,
+                               const region_domain_t &inv) override {
+    _inv.backward_assign_bool_ref_cst(lhs, rhs, inv._inv);
+  }
+
+  virtual void
+  backward_assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                           bool is_not_rhs,
+                           const region_domain_t &inv) override {
+    _inv.backward_assign_bool_var(lhs, rhs, is_not_rhs, inv._inv);
+  }
+
+  virtual void
+  backward_apply_binary_bool(bool_operation_t op, const variable_t &x,
+                             const variable_t &y, const variable_t &z,
+                             const region_domain_t &inv) override {
+    _inv.backward_apply_binary_bool(op, x, y, z, inv._inv);
+  }
+
+  /// region_domain is a scalar domain: arrays are handled by the array
+  /// domain on top of it.
+  ARRAY_OPERATIONS_NOT_IMPLEMENTED(region_domain_t)
+  REGION_AND_REFERENCE_OPERATIONS_NOT_IMPLEMENTED(region_domain_t)
+
+  linear_constraint_system_t to_linear_constraint_system() const override {
+    linear_constraint_system_t csts = _inv.to_linear_constraint_system();
+    if (is_bottom()) {
+      return csts;
+    }
+    for (auto const &[v, s] : _tags) {
+      if (auto k = s.singleton_value()) {
+        csts += linear_constraint_t(v - number_t(*k),
+                                    linear_constraint_t::EQUALITY);
+      } else {
+        csts += linear_constraint_t(linear_expression_t(number_t(s.min())) - v,
+                                    linear_constraint_t::INEQUALITY);
+        csts += linear_constraint_t(v - number_t(s.max()),
+                                    linear_constraint_t::INEQUALITY);
+      }
+    }
+    return csts;
+  }
+
+  // Only the numerical part.
+  disjunctive_linear_constraint_system_t
+  to_disjunctive_linear_constraint_system() const override {
+    return _inv.to_disjunctive_linear_constraint_system();
+  }
+
+  NumDomain get_content_domain() const { return _inv; }
+
+  NumDomain &get_content_domain() { return _inv; }
+
+  virtual interval_t operator[](const variable_t &v) override {
+    if (is_bottom()) {
+      return interval_t::bottom();
+    }
+    if (is_tag(v)) {
+      return interval_of_tags(get_tags(v));
+    }
+    return _inv[v];
+  }
+
+  /* begin intrinsics operations */
+  void intrinsic(std::string name, const variable_or_constant_vector_t &inputs,
+                 const variable_vector_t &outputs) override {
+    _inv.intrinsic(name, inputs, outputs);
+  }
+
+  void backward_intrinsic(std::string name,
+                          const variable_or_constant_vector_t &inputs,
+                          const variable_vector_t &outputs,
+                          const region_domain_t &invariant) override {
+    _inv.backward_intrinsic(name, inputs, outputs, invariant._inv);
+  }
+  /* end intrinsics operations */
+
+  void write(crab_os &o) const override {
+    o << _inv;
+    if (is_bottom() || _tags.empty()) {
+      return;
+    }
+    std::ostringstream os;
+    os << " tags={";
+    const char *sep = "";
+    for (auto const &[v, s] : _tags) {
+      os << sep << v.name().str() << " -> " << s;
+      sep = "; ";
+    }
+    os << "}";
+    o << os.str();
+  }
+
+  std::string domain_name() const override {
+    return "RegionTags(" + _inv.domain_name() + ")";
+  }
+
+  void rename(const variable_vector_t &from,
+              const variable_vector_t &to) override {
+    variable_vector_t nfrom, nto;
+    for (size_t i = 0; i < from.size(); i++) {
+      if (is_tag(from[i])) {
+        tag_set s = get_tags(from[i]);
+        _tags.erase(from[i]);
+        set_tags(to[i], s);
+      } else {
+        nfrom.push_back(from[i]);
+        nto.push_back(to[i]);
+      }
+    }
+    _inv.rename(nfrom, nto);
+  }
+
+  /** Whether inv implies cst. A constraint on tags must hold for every
+   *  combination of their values. */
+  bool entails(const linear_constraint_t &cst) {
+    if (is_bottom()) {
+      return true;
+    }
+    std::vector<term_t> tags, nums;
+    split(cst.expression(), tags, nums);
+    if (tags.empty()) {
+      return checker_domain_traits<NumDomain>::entail(_inv, cst);
+    }
+    bool all = true;
+    bool finite = for_each_case(tags, [&](const std::vector<int64_t> &vals) {
+      linear_constraint_t c(substitute(cst.expression(), tags, vals), cst.kind());
+      if (nums.empty()) {
+        all = all && c.is_tautology();
+      } else {
+        all = all && checker_domain_traits<NumDomain>::entail(_inv, c);
+      }
+    });
+    return finite && all;
+  }
+}; // end region_domain
+
+template <typename NumDomain>
+struct abstract_domain_traits<region_domain<NumDomain>> {
+  using number_t = typename NumDomain::number_t;
+  using varname_t = typename NumDomain::varname_t;
+};
+
+template <typename NumDomain>
+class checker_domain_traits<region_domain<NumDomain>> {
+public:
+  using this_type = region_domain<NumDomain>;
+  using linear_constraint_t = typename this_type::linear_constraint_t;
+  using disjunctive_linear_constraint_system_t =
+      typename this_type::disjunctive_linear_constraint_system_t;
+
+  static bool entail(this_type &lhs,
+                     const disjunctive_linear_constraint_system_t &rhs) {
+    NumDomain &lhs_dom = lhs.get_content_domain();
+    return checker_domain_traits<NumDomain>::entail(lhs_dom, rhs);
+  }
+
+  static bool entail(const disjunctive_linear_constraint_system_t &lhs,
+                     this_type &rhs) {
+    NumDomain &rhs_dom = rhs.get_content_domain();
+    return checker_domain_traits<NumDomain>::entail(lhs, rhs_dom);
+  }
+
+  static bool entail(this_type &lhs, const linear_constraint_t &rhs) {
+    return lhs.entails(rhs);
+  }
+
+  static bool intersect(this_type &inv, const linear_constraint_t &cst) {
+    this_type tmp(inv);
+    tmp += typename this_type::linear_constraint_system_t(cst);
+    return !tmp.is_bottom();
+  }
+};
+
+template <typename NumDomain>
+class special_domain_traits<region_domain<NumDomain>> {
+public:
+  static void clear_global_state(void) {
+    region_domain<NumDomain>::clear_global_state();
+    special_domain_traits<NumDomain>::clear_global_state();
+  }
+};
+
+} // namespace domains
+} // namespace crab
@@ -0,0 +1,220 @@
+#pragma once
+
+/**
+ *  Finite sets of region tags.
+ *
+ *  A register or stack cell is tagged with the region it points to:
+ *  T_UNINIT..T_SHARED (-6..0, see crab_constraints.cpp), or, for pointers into
+ *  map values, the positive size of the value. The fixed tags are kept in a
+ *  bitset, so the usual region checks (is_pointer, is_shared, ...) are mask
+ *  operations; a few distinct value sizes are kept in a small sorted vector.
+ *  Sets that would hold more sizes, or values below T_UNINIT, are top.
+ **/
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+class tag_set {
+public:
+    static constexpr int64_t MIN_FIXED = -6;  // T_UNINIT
+    static constexpr int64_t MAX_FIXED = 0;   // T_SHARED
+    static constexpr size_t NFIXED = MAX_FIXED - MIN_FIXED + 1;
+    static constexpr size_t MAX_SIZES = 8;
+
+private:
+    using bits_t = std::bitset<NFIXED>;
+
+    bool _top = false;
+    bits_t _fixed;
+    std::vector<int64_t> _sizes;  // sorted, positive
+
+    // fixed tags in [lb, ub]
+    static bits_t fixed_range(int64_t lb, int64_t ub) {
+        bits_t res;
+        for (int64_t v = std::max(lb, MIN_FIXED); v <= std::min(ub, MAX_FIXED); v++)
+            res.set(v - MIN_FIXED);
+        return res;
+    }
+
+    void normalize() {
+        if (_sizes.size() > MAX_SIZES)
+            *this = top();
+    }
+
+public:
+    static tag_set top() {
+        tag_set res;
+        res._top = true;
+        return res;
+    }
+
+    static tag_set bottom() { return tag_set(); }
+
+    static tag_set singleton(int64_t v) {
+        tag_set res;
+        res.insert(v);
+        return res;
+    }
+
+    /** All tags in [lb, ub]; top if that is not representable. */
+    static tag_set range(int64_t lb, int64_t ub) {
+        if (lb > ub)
+            return bottom();
+        if (lb < MIN_FIXED || (ub > MAX_FIXED && (uint64_t)(ub - std::max<int64_t>(lb, 1)) >= MAX_SIZES))
+            return top();
+        tag_set res;
+        res._fixed = fixed_range(lb, ub);
+        for (int64_t v = std::max<int64_t>(lb, 1); v <= ub; v++)
+            res._sizes.push_back(v);
+        return res;
+    }
+
+    bool is_top() const { return _top; }
+    bool is_bottom() const { return !_top && _fixed.none() && _sizes.empty(); }
+    size_t size() const { return _fixed.count() + _sizes.size(); }
+
+    void insert(int64_t v) {
+        if (_top)
+            return;
+        if (v < MIN_FIXED) {
+            *this = top();
+        } else if (v <= MAX_FIXED) {
+            _fixed.set(v - MIN_FIXED);
+        } else {
+            auto it = std::lower_bound(_sizes.begin(), _sizes.end(), v);
+            if (it == _sizes.end() || *it != v)
+                _sizes.insert(it, v);
+            normalize();
+        }
+    }
+
+    /** Call f on every tag of a finite set. */
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t i = 0; i < NFIXED; i++) {
+            if (_fixed.test(i))
+                f(MIN_FIXED + (int64_t)i);
+        }
+        for (int64_t v : _sizes)
+            f(v);
+    }
+
+    /** The tags of a finite set that satisfy pred. */
+    template <typename P>
+    tag_set filter(P pred) const {
+        if (_top)
+            return *this;
+        tag_set res;
+        for_each([&](int64_t v) {
+            if (pred(v))
+                res.insert(v);
+        });
+        return res;
+    }
+
+    /** Intersection with [lb, ub]. Bounds are inclusive. */
+    tag_set restrict(std::optional<int64_t> lb, std::optional<int64_t> ub) const {
+        if (_top) {
+            if (lb && *lb >= MIN_FIXED && ub)
+                return range(*lb, *ub);
+            return *this;
+        }
+        int64_t lo = lb ? *lb : INT64_MIN;
+        int64_t hi = ub ? *ub : INT64_MAX;
+        tag_set res;
+        res._fixed = _fixed & fixed_range(lo, hi);
+        for (int64_t v : _sizes) {
+            if (lo <= v && v <= hi)
+                res._sizes.push_back(v);
+        }
+        return res;
+    }
+
+    tag_set remove(int64_t v) const {
+        return filter([v](int64_t w) { return w != v; });
+    }
+
+    std::optional<int64_t> singleton_value() const {
+        if (_top || size() != 1)
+            return {};
+        std::optional<int64_t> res;
+        for_each([&](int64_t v) { res = v; });
+        return res;
+    }
+
+    /** Smallest and largest tag of a finite, non-empty set. */
+    int64_t min() const {
+        for (size_t i = 0; i < NFIXED; i++) {
+            if (_fixed.test(i))
+                return MIN_FIXED + (int64_t)i;
+        }
+        return _sizes.front();
+    }
+
+    int64_t max() const {
+        if (!_sizes.empty())
+            return _sizes.back();
+        for (size_t i = NFIXED; i > 0; i--) {
+            if (_fixed.test(i - 1))
+                return MIN_FIXED + (int64_t)i - 1;
+        }
+        return MIN_FIXED;
+    }
+
+    tag_set operator|(const tag_set& o) const {
+        if (_top || o._top)
+            return top();
+        tag_set res;
+        res._fixed = _fixed | o._fixed;
+        std::set_union(_sizes.begin(), _sizes.end(), o._sizes.begin(), o._sizes.end(),
+                       std::back_inserter(res._sizes));
+        res.normalize();
+        return res;
+    }
+
+    tag_set operator&(const tag_set& o) const {
+        if (_top)
+            return o;
+        if (o._top)
+            return *this;
+        tag_set res;
+        res._fixed = _fixed & o._fixed;
+        std::set_intersection(_sizes.begin(), _sizes.end(), o._sizes.begin(), o._sizes.end(),
+                              std::back_inserter(res._sizes));
+        return res;
+    }
+
+    bool operator<=(const tag_set& o) const {
+        if (o._top)
+            return true;
+        if (_top)
+            return false;
+        return (_fixed & ~o._fixed).none() &&
+               std::includes(o._sizes.begin(), o._sizes.end(), _sizes.begin(), _sizes.end());
+    }
+
+    bool operator==(const tag_set& o) const {
+        return _top == o._top && _fixed == o._fixed && _sizes == o._sizes;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const tag_set& s) {
+        static const char* names[NFIXED] = {"T_UNINIT", "T_NUM", "T_MAP", "T_CTX", "T_STACK", "T_DATA", "T_SHARED"};
+        if (s._top)
+            return os << "T_*";
+        os << "{";
+        const char* sep = "";
+        s.for_each([&](int64_t v) {
+            os << sep;
+            if (v <= MAX_FIXED)
+                os << names[v - MIN_FIXED];
+            else
+                os << "T_SHARED(" << v << ")";
+            sep = ",";
+        });
+        return os << "}";
+    }
+};
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <variant>
+
+#include "spec_type_descriptors.hpp"
+#include "slicing.hpp"
+
+using std::vector;
+
+// Registers r0 to r10, then the bytes of the stack, then the rest of the
+// memory
+constexpr int NREGS = 11;
+constexpr int MEMORY = NREGS + STACK_SIZE;
+using vars = std::bitset<MEMORY + 1>;
+
+static vars reg(Reg r) {
+    vars res;
+    if (r.v < NREGS)
+        res.set(r.v);
+    return res;
+}
+
+static vars value(const Value& v) {
+    return std::holds_alternative<Reg>(v) ? reg(std::get<Reg>(v)) : vars{};
+}
+
+static vars scratched() {
+    vars res;
+    for (uint8_t r = 0; r <= 5; r++)
+        res.set(r);
+    return res;
+}
+
+static vars all_memory() {
+    vars res;
+    for (int i = NREGS; i <= MEMORY; i++)
+        res.set(i);
+    return res;
+}
+
+// The bytes an access may touch. Byte b of the stack is at r10 - STACK_SIZE + b.
+static vars accessed(const Deref& access) {
+    if (access.basereg.v != 10)
+        return all_memory();
+    vars res;
+    for (int i = std::max(STACK_SIZE + access.offset, 0); i < std::min(STACK_SIZE + access.offset + access.width, STACK_SIZE); i++)
+        res.set(NREGS + i);
+    return res;
+}
+
+static bool reads_memory(const Call& call) {
+    for (const ArgSingle& arg : call.singles) {
+        if (arg.kind == ArgSingle::Kind::PTR_TO_MAP_KEY || arg.kind == ArgSingle::Kind::PTR_TO_MAP_VALUE)
+            return true;
+    }
+    for (const ArgPair& arg : call.pairs) {
+        if (arg.kind != ArgPair::Kind::PTR_TO_UNINIT_MEM)
+            return true;
+    }
+    return false;
+}
+
+static bool writes_memory(const Call& call) {
+    for (const ArgPair& arg : call.pairs) {
+        if (arg.kind == ArgPair::Kind::PTR_TO_UNINIT_MEM)
+            return true;
+    }
+    return false;
+}
+
+namespace {
+
+struct effect {
+    // Variables the instruction may define
+    vars defs;
+    // Variables it overwrites on every execution
+    vars kills;
+    vars uses;
+    // Variables it uses only to compute its defs, so that a criterion whose
+    // result is dead does not need them
+    vars value_uses;
+    // Kept whatever is relevant
+    bool always = false;
+    // Kept if it uses a relevant variable
+    bool assumption = false;
+};
+
+}
+
+static effect effect_of(const Instruction& ins) {
+    effect e;
+    std::visit(overloaded{
+        [&](const Undefined&) { e.always = true; },
+        [&](const LoadMapFd& a) { e.defs = e.kills = reg(a.dst); },
+        [&](const Bin& a) {
+            e.defs = e.kills = reg(a.dst);
+            e.uses = value(a.v);
+            if (a.op != Bin::Op::MOV)
+                e.uses |= reg(a.dst);
+        },
+        [&](const Un& a) { e.defs = e.kills = e.uses = reg(a.dst); },
+        [&](const Call& a) {
+            for (const ArgSingle& arg : a.singles)
+                e.uses |= reg(arg.reg);
+            for (const ArgPair& arg : a.pairs)
+                e.uses |= reg(arg.mem) | reg(arg.size);
+            if (reads_memory(a))
+                e.uses |= all_memory();
+            e.defs = e.kills = scratched();
+            if (writes_memory(a))
+                e.defs |= all_memory();
+        },
+        [&](const Exit&) { e.uses = reg(Reg{0}); },
+        [&](const Jmp& a) {
+            e.always = true;
+            if (a.cond)
+                e.uses = reg(a.cond->left) | value(a.cond->right);
+        },
+        [&](const Mem& a) {
+            e.uses = reg(a.access.basereg);
+            if (a.is_load) {
+                e.defs = e.kills = value(a.value);
+                e.value_uses = accessed(a.access);
+            } else {
+                e.uses |= value(a.value);
+                e.defs = accessed(a.access);
+                if (a.access.basereg.v == 10)
+                    e.kills = e.defs;
+            }
+        },
+        [&](const Packet& a) {
+            e.defs = e.kills = scratched();
+            e.uses = reg(Reg{6}) | all_memory();
+            if (a.regoffset)
+                e.uses |= reg(*a.regoffset);
+        },
+        [&](const LockAdd& a) {
+            e.defs = accessed(a.access);
+            e.uses = reg(a.access.basereg) | reg(a.valreg) | e.defs;
+        },
+        [&](const Assume& a) {
+            e.assumption = true;
+            e.uses = reg(a.cond.left) | value(a.cond.right);
+        },
+        [](const Assert&) { },
+    }, ins);
+    return e;
+}
+
+// The relevant variables before a block, given those after it. If kept is
+// not null, the kept instructions are marked in it.
+static vars transfer(const vector<effect>& effects, const vector<char>& forced, vars relevant, vector<char>* kept) {
+    for (size_t i = effects.size(); i-- > 0;) {
+        const effect& e = effects[i];
+        bool needed = (e.defs & relevant).any();
+        bool keep = forced[i] || e.always || (e.assumption ? (e.uses & relevant).any() : needed);
+        if (keep)
+            relevant = (relevant & ~e.kills) | e.uses | (needed ? e.value_uses : vars{});
+        if (kept)
+            (*kept)[i] = keep;
+    }
+    return relevant;
+}
+
+// Immediate postdominators of the blocks, with n as a virtual exit that
+// follows the blocks without successors and the blocks that never reach one.
+static vector<size_t> postdominators(const vector<vector<size_t>>& succ, const vector<vector<size_t>>& pred) {
+    size_t n = succ.size();
+    vector<char> reaches_exit(n);
+    vector<size_t> stack;
+    for (size_t b = 0; b < n; b++) {
+        if (succ[b].empty()) {
+            reaches_exit[b] = 1;
+            stack.push_back(b);
+        }
+    }
+    while (!stack.empty()) {
+        size_t b = stack.back();
+        stack.pop_back();
+        for (size_t p : pred[b]) {
+            if (!reaches_exit[p]) {
+                reaches_exit[p] = 1;
+                stack.push_back(p);
+            }
+        }
+    }
+    // Successors in the graph with the virtual exit
+    vector<vector<size_t>> out = succ;
+    vector<size_t> into_exit;
+    for (size_t b = 0; b < n; b++) {
+        if (succ[b].empty() || !reaches_exit[b]) {
+            out[b].push_back(n);
+            into_exit.push_back(b);
+        }
+    }
+
+    // Postorder of the reverse graph from the exit
+    vector<size_t> order(n + 1, 0);
+    vector<size_t> postorder;
+    vector<char> visited(n + 1);
+    vector<std::pair<size_t, size_t>> dfs{{n, 0}};
+    visited[n] = 1;
+    while (!dfs.empty()) {
+        auto& [b, i] = dfs.back();
+        const vector<size_t>& next = b == n ? into_exit : pred[b];
+        if (i < next.size()) {
+            size_t p = next[i++];
+            if (!visited[p]) {
+                visited[p] = 1;
+                dfs.emplace_back(p, 0);
+            }
+            continue;
+        }
+        order[b] = postorder.size();
+        postorder.push_back(b);
+        dfs.pop_back();
+    }
+
+    constexpr size_t NONE = SIZE_MAX;
+    vector<size_t> ipdom(n + 1, NONE);
+    ipdom[n] = n;
+    auto intersect = [&](size_t a, size_t b) {
+        while (a != b) {
+            while (order[a] < order[b])
+                a = ipdom[a];
+            while (order[b] < order[a])
+                b = ipdom[b];
+        }
+        return a;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t k = postorder.size(); k-- > 0;) {
+            size_t b = postorder[k];
+            if (b == n)
+                continue;
+            size_t res = NONE;
+            for (size_t s : out[b]) {
+                if (ipdom[s] != NONE)
+                    res = res == NONE ? s : intersect(s, res);
+            }
+            if (res != ipdom[b]) {
+                ipdom[b] = res;
+                changed = true;
+            }
+        }
+    }
+    return ipdom;
+}
+
+vector<slice_criterion> unproven_instructions(const Cfg& cfg) {
+    vector<slice_criterion> res;
+    for (const Label& l : cfg.keys()) {
+        size_t index = 0;
+        bool unproven = false;
+        for (const Instruction& ins : cfg.at(l).insts) {
+            if (std::holds_alternative<Assert>(ins)) {
+                unproven |= !std::get<Assert>(ins).satisfied;
+                continue;
+            }
+            if (unproven)
+                res.emplace_back(l, index);
+            unproven = false;
+            index++;
+        }
+    }
+    return res;
+}
+
+size_t slice(Cfg& cfg, const vector<slice_criterion>& criteria) {
+    const vector<Label>& labels = cfg.keys();
+    size_t n = labels.size();
+    std::map<Label, size_t> index;
+    for (size_t b = 0; b < n; b++)
+        index.emplace(labels[b], b);
+
+    vector<vector<size_t>> succ(n);
+    vector<vector<size_t>> pred(n);
+    for (size_t b = 0; b < n; b++) {
+        std::set<size_t> next;
+        for (const Label& l : cfg.at(labels[b]).nextlist)
+            next.insert(index.at(l));
+        for (size_t s : next) {
+            succ[b].push_back(s);
+            pred[s].push_back(b);
+        }
+    }
+
+    std::set<slice_criterion> is_criterion(criteria.begin(), criteria.end());
+    vector<vector<effect>> effects(n);
+    vector<vector<char>> forced(n);
+    for (size_t b = 0; b < n; b++) {
+        const vector<Instruction>& insts = cfg.at(labels[b]).insts;
+        for (size_t i = 0; i < insts.size(); i++) {
+            effects[b].push_back(effect_of(insts[i]));
+            forced[b].push_back(is_criterion.count({labels[b], i}));
+        }
+    }
+
+    // The branches each block is control dependent on, by the block that
+    // starts the branch
+    vector<size_t> ipdom = postdominators(succ, pred);
+    vector<vector<size_t>> control(n);
+    for (size_t p = 0; p < n; p++) {
+        if (succ[p].size() < 2)
+            continue;
+        for (size_t s : succ[p]) {
+            for (size_t runner = s; runner != ipdom[p] && runner != n; runner = ipdom[runner])
+                control[runner].push_back(s);
+        }
+    }
+
+    vector<vars> in(n);
+    vector<vector<char>> kept(n);
+    for (size_t b = 0; b < n; b++)
+        kept[b].resize(effects[b].size());
+    for (bool changed = true; changed;) {
+        for (bool flow = true; flow;) {
+            flow = false;
+            for (size_t b = n; b-- > 0;) {
+                vars out;
+                for (size_t s : succ[b])
+                    out |= in[s];
+                vars before = transfer(effects[b], forced[b], out, nullptr);
+                if (before != in[b]) {
+                    in[b] = before;
+                    flow = true;
+                }
+            }
+        }
+
+        // Keep the assumptions of the branches that kept instructions depend on
+        changed = false;
+        for (size_t b = 0; b < n; b++) {
+            vars out;
+            for (size_t s : succ[b])
+                out |= in[s];
+            transfer(effects[b], forced[b], out, &kept[b]);
+            bool any = false;
+            for (char k : kept[b])
+                any |= k;
+            if (!any)
+                continue;
+            for (size_t s : control[b]) {
+                const vector<Instruction>& insts = cfg.at(labels[s]).insts;
+                for (size_t i = 0; i < insts.size() && std::holds_alternative<Assume>(insts[i]); i++) {
+                    if (!forced[s][i]) {
+                        forced[s][i] = 1;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    size_t removed = 0;
+    for (size_t b = 0; b < n; b++) {
+        vector<Instruction>& insts = cfg[labels[b]].insts;
+        vector<Instruction> res;
+        for (size_t i = 0; i < insts.size(); i++) {
+            if (kept[b][i])
+                res.push_back(std::move(insts[i]));
+            else
+                removed++;
+        }
+        insts = std::move(res);
+    }
+    return removed;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+/**
+ *  Backward slicing of a nondeterministic CFG.
+ *
+ *  The slice for a set of instructions, the criteria, is the instructions
+ *  whose results the criteria may depend on. The variables are the
+ *  registers, the bytes of the stack accessed through r10, and the rest of
+ *  the memory as one variable. Accesses through other registers may use or
+ *  update any byte of the stack, and never overwrite a byte for certain.
+ *
+ *  An instruction is kept if it is a criterion, if it defines a variable
+ *  that is relevant after it, or if it is an assumption on a relevant
+ *  variable. The assumptions that start a branch are also kept if a kept
+ *  instruction is control dependent on that branch, as computed from the
+ *  postdominators. Every kept instruction makes its uses relevant, so the
+ *  assertions of kept instructions keep everything they depend on. The
+ *  memory a load reads is relevant only if the loaded register is, which
+ *  matters for criteria: a criterion whose result is dead needs its address,
+ *  not the value it loads.
+ *
+ *  Removing the other instructions is sound: no kept instruction reads what
+ *  they define, and a removed assumption only adds paths. An analysis that
+ *  proves the sliced program safe therefore proves the criteria safe in the
+ *  original program.
+ **/
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "asm_cfg.hpp"
+
+/** An instruction, by its block and its position in the block. */
+using slice_criterion = std::pair<Label, size_t>;
+
+/** The instructions of cfg that follow an assertion that does not hold. The
+ *  positions do not count the assertions, so they are those of the same
+ *  instructions in cfg before explicate_assertions. */
+std::vector<slice_criterion> unproven_instructions(const Cfg& cfg);
+
+/** Remove from cfg, which has no assertions yet, the instructions that are
+ *  not in the slice for criteria. Blocks and edges are kept. Returns the
+ *  number of removed instructions. */
+size_t slice(Cfg& cfg, const std::vector<slice_criterion>& criteria);
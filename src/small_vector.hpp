@@ -0,0 +1,93 @@
+#pragma once
+
+/**
+ *  Vector of trivially copyable elements that stores up to N of them inline
+ *  and only moves to the heap when it grows past N. Copying a small vector
+ *  that fits inline does not allocate.
+ **/
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+template <typename T, size_t N>
+class small_vector {
+    // The elements are in _inline while _size <= N, in _heap otherwise.
+    T _inline[N]{};
+    std::vector<T> _heap;
+    size_t _size = 0;
+
+    bool on_heap() const { return _size > N; }
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    small_vector() = default;
+    small_vector(std::initializer_list<T> elems) {
+        reserve(elems.size());
+        for (const T& e : elems)
+            push_back(e);
+    }
+
+    T* data() { return on_heap() ? _heap.data() : _inline; }
+    const T* data() const { return on_heap() ? _heap.data() : _inline; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + _size; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + _size; }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+    const T& front() const { return data()[0]; }
+    const T& back() const { return data()[_size - 1]; }
+
+    void reserve(size_t n) {
+        if (n > N)
+            _heap.reserve(n);
+    }
+
+    void clear() {
+        _size = 0;
+        _heap.clear();
+    }
+
+    void push_back(const T& e) {
+        if (_size < N) {
+            _inline[_size++] = e;
+            return;
+        }
+        if (_size == N)
+            _heap.assign(_inline, _inline + N);
+        _heap.push_back(e);
+        _size++;
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        size_t i = first - begin();
+        size_t j = last - begin();
+        if (on_heap()) {
+            _heap.erase(_heap.begin() + i, _heap.begin() + j);
+            _size = _heap.size();
+            if (!on_heap()) {
+                std::copy(_heap.begin(), _heap.end(), _inline);
+                _heap.clear();
+            }
+        } else {
+            std::copy(_inline + j, _inline + _size, _inline + i);
+            _size -= j - i;
+        }
+        return begin() + i;
+    }
+
+    bool operator==(const small_vector& o) const {
+        return _size == o._size && std::equal(begin(), end(), o.begin());
+    }
+    bool operator!=(const small_vector& o) const { return !(*this == o); }
+};
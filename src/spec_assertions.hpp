@@ -3,6 +3,7 @@
 #include <bitset>
 
 #include "asm_cfg.hpp"
+#include "map_set.hpp"
 #include "spec_type_descriptors.hpp"
 
 enum {
@@ -15,15 +16,51 @@ enum {
     T_MAP = 0,
 };
 
-using Types = std::bitset<NMAPS + NONMAPS>;
+/** A set of types: the maps by their index, the other types by their
+ *  negative code. */
+class Types {
+    MapSet _maps;
+    std::bitset<NONMAPS> others;
+
+public:
+    Types() = default;
+    /** The maps in maps, and no other type. */
+    explicit Types(const MapSet& maps) : _maps{maps} { }
+
+    bool operator[](int t) const { return t < 0 ? others[NONMAPS + t] : _maps[t]; }
+    const MapSet& maps() const { return _maps; }
+
+    Types& set(int t) {
+        if (t < 0)
+            others.set(NONMAPS + t);
+        else
+            _maps.set(t);
+        return *this;
+    }
+    Types& set() { _maps.set(); others.set(); return *this; }
+
+    bool none() const { return _maps.none() && others.none(); }
+    bool any() const { return !none(); }
+    bool all() const { return _maps.all() && others.all(); }
+    /** The number of types, SIZE_MAX if infinitely many maps. */
+    size_t count() const {
+        size_t maps = _maps.count();
+        return maps == SIZE_MAX ? maps : maps + others.count();
+    }
+
+    Types operator~() const { Types res; res._maps = ~_maps; res.others = ~others; return res; }
+    Types& operator&=(const Types& o) { _maps &= o._maps; others &= o.others; return *this; }
+    Types& operator|=(const Types& o) { _maps |= o._maps; others |= o.others; return *this; }
+    friend Types operator&(Types a, const Types& b) { return a &= b; }
+    friend Types operator|(Types a, const Types& b) { return a |= b; }
+
+    bool operator==(const Types& o) const { return _maps == o._maps && others == o.others; }
+    bool operator!=(const Types& o) const { return !(*this == o); }
+};
 
 namespace TypeSet {
     static Types single(int n) {
-        Types res;
-        if (n < 0)
-            return res.set(res.size()+n);
-        else 
-            return res.set(n);
+        return Types{}.set(n);
     }
 
     const Types all = Types{}.set();
@@ -32,7 +69,7 @@ namespace TypeSet {
     const Types ctx = single(T_CTX); 
     const Types packet = single(T_DATA); 
     const Types stack = single(T_STACK);
-    const Types maps =  (num | fd | ctx | packet | stack).flip();
+    const Types maps =  ~(num | fd | ctx | packet | stack);
     const Types mem = maps | packet | stack;
     const Types ptr = mem | ctx;
     const Types nonfd = ptr | num;
@@ -66,6 +103,9 @@ struct Assertion {
     std::variant<LinearConstraint, TypeConstraint> cst;
 };
 
+// The assertions that explicate_assertions puts before ins
+std::vector<Assertion> assertions_of(const Instruction& ins, const program_info& info);
+
 #define DECLARE_EQ6(T, f1, f2, f3, f4, f5, f6) \
     inline bool operator==(T const& a, T const& b){ return a.f1 == b.f1 && a.f2 == b.f2 && a.f3 == b.f3 && a.f4 == b.f4 && a.f5 == b.f5 && a.f6 == b.f6; }
 #define DECLARE_EQ5(T, f1, f2, f3, f4, f5) \
@@ -0,0 +1,994 @@
+/*******************************************************************************
+ * Stack array domain
+ *
+ * Array domain specialized to the eBPF stack: the arrays S_r, S_off and S_t
+ * span STACK_SIZE bytes and are nearly always accessed at constant offsets
+ * with widths 1, 2, 4 or 8. Each array has a fixed layout (stack_layout.hpp)
+ * recording the cell starting at every byte, and each (offset, width) pair
+ * has one scalar in a fixed table, so a constant-offset load or store costs a
+ * few byte lookups instead of a search in a patricia tree.
+ *
+ * Bytes of the region array S_t that hold a fixed tag are kept as per-byte
+ * tag bitmaps instead of scalars, which keeps up to STACK_SIZE variables out
+ * of the numerical domain. Tags of map values (positive sizes) are kept in
+ * cells.
+ *
+ * Unlike array_expansion, layouts are part of the abstract state: a join
+ * keeps the cells present on both sides with the same width. A store with a
+ * non-constant offset kills the cells its range may overlap and weakly updates
+ * the tags; a load with a non-constant offset gives top, or the tags of its
+ * range for S_t.
+ *
+ * The forget_cells intrinsic drops the cells and tags of stack bytes that
+ * are dead (stack_liveness.hpp), so scratch slots do not stay in the state.
+ *
+ * Backward array operations are coarse: the affected scalars are forgotten
+ * and the result is met with the forward invariant.
+ ******************************************************************************/
+
+#pragma once
+
+#include <crab/domains/abstract_domain.hpp>
+#include <crab/domains/abstract_domain_specialized_traits.hpp>
+#include <crab/support/debug.hpp>
+#include <crab/support/stats.hpp>
+
+#include <algorithm>
+#include <boost/optional.hpp>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "cell_keys.hpp"
+#include "stack_layout.hpp"
+
+namespace crab {
+namespace domains {
+
+template <typename NumDomain>
+class stack_array_domain final
+    : public abstract_domain_api<stack_array_domain<NumDomain>> {
+
+public:
+  using number_t = typename NumDomain::number_t;
+  using varname_t = typename NumDomain::varname_t;
+
+private:
+  using stack_array_domain_t = stack_array_domain<NumDomain>;
+  using abstract_domain_t = abstract_domain_api<stack_array_domain_t>;
+
+public:
+  using typename abstract_domain_t::disjunctive_linear_constraint_system_t;
+  using typename abstract_domain_t::interval_t;
+  using typename abstract_domain_t::linear_constraint_system_t;
+  using typename abstract_domain_t::linear_constraint_t;
+  using typename abstract_domain_t::linear_expression_t;
+  using typename abstract_domain_t::reference_constraint_t;
+  using typename abstract_domain_t::variable_or_constant_t;
+  using typename abstract_domain_t::variable_t;
+  using typename abstract_domain_t::variable_vector_t;
+  using typename abstract_domain_t::variable_or_constant_vector_t;
+  using content_domain_t = NumDomain;
+
+private:
+  using layout_map_t = std::map<variable_t, stack_layout>;
+  using cell_table_t = std::vector<boost::optional<variable_t>>;
+
+  // scalar domain
+  NumDomain _inv;
+  // layout of each array; a missing array has no cells
+  layout_map_t _layouts;
+
+  stack_array_domain(NumDomain inv, layout_map_t layouts)
+      : _inv(std::move(inv)), _layouts(std::move(layouts)) {}
+
+  // The scalar of each (array, offset, width), created on first use. The
+  // table is dropped when the variables come from another factory.
+  static std::map<ikos::index_t, cell_table_t> &get_cell_tables() {
+    static std::map<ikos::index_t, cell_table_t> *tables =
+        new std::map<ikos::index_t, cell_table_t>();
+    return *tables;
+  }
+
+  // The factory of the scalars in the tables, or null once they are cleared.
+  static const void *&get_cell_factory() {
+    static const void *factory = nullptr;
+    return factory;
+  }
+
+  static size_t slot(int w) { return __builtin_ctz(w); }
+
+  static variable_t cell_scalar(const variable_t &a, int o, int w) {
+    auto &vfac = const_cast<varname_t *>(&(a.name()))->get_var_factory();
+    auto &tables = get_cell_tables();
+    if (get_cell_factory() != &vfac) {
+      tables.clear();
+      get_cell_factory() = &vfac;
+    }
+    cell_table_t &table = tables[a.index()];
+    if (table.empty()) {
+      table.resize(stack_layout::SIZE * 4);
+    }
+    boost::optional<variable_t> &v = table[o * 4 + slot(w)];
+    if (!v) {
+      crab::crab_string_os os;
+      os << a << "[";
+      if (w == 1) {
+        os << o;
+      } else {
+        os << o << "..." << o + w - 1;
+      }
+      os << "]";
+      v = variable_t(vfac.get(next_cell_key(), os.str()), INT_TYPE, 8 * w);
+    }
+    return *v;
+  }
+
+  static bool is_region_array(const variable_t &a) {
+    return a.name().str().compare(0, 3, "S_t") == 0;
+  }
+
+  interval_t to_interval(const linear_expression_t &e,
+                         const NumDomain &inv) const {
+    NumDomain &dom = const_cast<NumDomain &>(inv);
+    interval_t r(e.constant());
+    for (auto it = e.begin(); it != e.end(); ++it) {
+      r += interval_t(it->first) * dom[it->second];
+    }
+    return r;
+  }
+
+  interval_t to_interval(const linear_expression_t &e) const {
+    return to_interval(e, _inv);
+  }
+
+  static bool fits(const number_t &n) {
+    return number_t(INT32_MIN) <= n && n <= number_t(INT32_MAX);
+  }
+
+  static boost::optional<int64_t> to_int(const interval_t &i) {
+    if (auto n = i.singleton()) {
+      if (fits(*n)) {
+        return static_cast<int64_t>(*n);
+      }
+    }
+    return boost::none;
+  }
+
+  static int constant_width(const interval_t &i) {
+    auto w = to_int(i);
+    if (!w || !stack_layout::valid_width(*w)) {
+      CRAB_ERROR("stack array domain expects widths of 1, 2, 4 or 8 bytes");
+    }
+    return (int)*w;
+  }
+
+  // Bytes [lb, ub) of the stack an access of w bytes at an offset in i may
+  // touch, or none if i is unbounded.
+  static boost::optional<std::pair<int, int>> byte_range(const interval_t &i,
+                                                         int w) {
+    auto lb = i.lb().number();
+    auto ub = i.ub().number();
+    if (!lb || !ub) {
+      return boost::none;
+    }
+    number_t lo = std::max(*lb, number_t(0));
+    number_t hi = std::min(*ub + w, number_t(stack_layout::SIZE));
+    if (lo >= hi) {
+      return std::make_pair(0, 0);
+    }
+    return std::make_pair((int)static_cast<int64_t>(lo),
+                          (int)static_cast<int64_t>(hi));
+  }
+
+  // Tag bits of the value stored, or 0 if it is not a fixed tag.
+  stack_layout::tag_bits tags_of(const linear_expression_t &val) const {
+    interval_t i = to_interval(val);
+    auto lb = i.lb().number();
+    auto ub = i.ub().number();
+    if (!lb || !ub || !fits(*lb) || !fits(*ub)) {
+      return 0;
+    }
+    return stack_layout::tag_range(static_cast<int64_t>(*lb),
+                                   static_cast<int64_t>(*ub));
+  }
+
+  void kill_cells(const variable_t &a, stack_layout &layout, int lb, int ub) {
+    variable_vector_t dead;
+    layout.remove_cells(lb, ub, [&](int o, int w) {
+      dead.push_back(cell_scalar(a, o, w));
+    });
+    if (!dead.empty()) {
+      _inv.forget(dead);
+    }
+  }
+
+  void kill_array(const variable_t &a) {
+    auto it = _layouts.find(a);
+    if (it != _layouts.end()) {
+      kill_cells(a, it->second, 0, stack_layout::SIZE);
+      _layouts.erase(it);
+    }
+  }
+
+  // Forget the scalars of the cells of from that are not in to.
+  static void forget_dropped(const variable_t &a, const stack_layout &from,
+                             const stack_layout &to, variable_vector_t &dead) {
+    from.for_each_cell([&](int o, int w) {
+      if (to.cell_at(o) != w) {
+        dead.push_back(cell_scalar(a, o, w));
+      }
+    });
+  }
+
+  static stack_layout top_layout() { return stack_layout(); }
+
+  const stack_layout &get_layout(const variable_t &a) const {
+    static const stack_layout top;
+    auto it = _layouts.find(a);
+    return it == _layouts.end() ? top : it->second;
+  }
+
+  void assign_tags(const variable_t &lhs, stack_layout::tag_bits bits) {
+    int64_t lb = stack_layout::min_tag(bits);
+    int64_t ub = stack_layout::max_tag(bits);
+    if (lb == ub) {
+      _inv.assign(lhs, number_t(lb));
+    } else {
+      _inv -= lhs;
+      linear_constraint_system_t csts;
+      csts += linear_constraint_t(lhs - number_t(ub),
+                                  linear_constraint_t::INEQUALITY);
+      csts += linear_constraint_t(number_t(lb) - lhs,
+                                  linear_constraint_t::INEQUALITY);
+      _inv += csts;
+    }
+  }
+
+  template <typename Op>
+  stack_array_domain_t join_with(const stack_array_domain_t &other,
+                                 NumDomain inv, Op op) const {
+    layout_map_t layouts;
+    variable_vector_t dead;
+    for (auto const &[a, layout] : _layouts) {
+      auto it = other._layouts.find(a);
+      if (it == other._layouts.end()) {
+        forget_dropped(a, layout, top_layout(), dead);
+        continue;
+      }
+      stack_layout res = op(layout, it->second);
+      forget_dropped(a, layout, res, dead);
+      forget_dropped(a, it->second, res, dead);
+      if (!res.is_top()) {
+        layouts.emplace(a, std::move(res));
+      }
+    }
+    for (auto const &[a, layout] : other._layouts) {
+      if (!_layouts.count(a)) {
+        forget_dropped(a, layout, top_layout(), dead);
+      }
+    }
+    if (!dead.empty()) {
+      inv.forget(dead);
+    }
+    return stack_array_domain_t(std::move(inv), std::move(layouts));
+  }
+
+  stack_array_domain_t meet_with(const stack_array_domain_t &other,
+                                 NumDomain inv) const {
+    if (inv.is_bottom()) {
+      return make_bottom();
+    }
+    layout_map_t layouts = _layouts;
+    variable_vector_t dead;
+    for (auto const &[a, layout] : other._layouts) {
+      auto it = layouts.find(a);
+      if (it == layouts.end()) {
+        layouts.emplace(a, layout);
+        continue;
+      }
+      auto res = meet(it->second, layout);
+      if (!res) {
+        return make_bottom();
+      }
+      forget_dropped(a, layout, *res, dead);
+      it->second = std::move(*res);
+    }
+    if (!dead.empty()) {
+      inv.forget(dead);
+    }
+    return stack_array_domain_t(std::move(inv), std::move(layouts));
+  }
+
+  void backward_forget(const variable_t &lhs,
+                       const stack_array_domain_t &invariant) {
+    _inv -= lhs;
+    *this = *this & invariant;
+  }
+
+public:
+  stack_array_domain() { _inv.set_to_top(); }
+
+  stack_array_domain make_top() const override {
+    NumDomain inv;
+    return stack_array_domain_t(inv.make_top(), {});
+  }
+
+  stack_array_domain make_bottom() const override {
+    NumDomain inv;
+    return stack_array_domain_t(inv.make_bottom(), {});
+  }
+
+  void set_to_top() override {
+    _inv.set_to_top();
+    _layouts.clear();
+  }
+
+  void set_to_bottom() override {
+    _inv.set_to_bottom();
+    _layouts.clear();
+  }
+
+  /**
+      The cell scalars refer to the variable factory of the program
+      being analyzed, so they are dropped between runs.
+  **/
+  static void clear_global_state() {
+    get_cell_tables().clear();
+    get_cell_factory() = nullptr;
+  }
+
+  bool is_bottom() const override { return _inv.is_bottom(); }
+
+  bool is_top() const override { return _inv.is_top() && _layouts.empty(); }
+
+  bool operator<=(const stack_array_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.leq");
+    crab::ScopedCrabStats __st__(domain_name() + ".leq");
+    if (is_bottom()) {
+      return true;
+    }
+    if (other.is_bottom()) {
+      return false;
+    }
+    for (auto const &[a, layout] : other._layouts) {
+      if (!(get_layout(a) <= layout)) {
+        return false;
+      }
+    }
+    return _inv <= other._inv;
+  }
+
+  void operator|=(const stack_array_domain_t &other) override {
+    *this = *this | other;
+  }
+
+  stack_array_domain_t
+  operator|(const stack_array_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.join");
+    crab::ScopedCrabStats __st__(domain_name() + ".join");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return join_with(other, _inv | other._inv,
+                     [](const stack_layout &a, const stack_layout &b) {
+                       return a | b;
+                     });
+  }
+
+  stack_array_domain_t
+  operator&(const stack_array_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.meet");
+    crab::ScopedCrabStats __st__(domain_name() + ".meet");
+    return meet_with(other, _inv & other._inv);
+  }
+
+  // Layouts form a finite lattice, so their join is also a widening.
+  stack_array_domain_t
+  operator||(const stack_array_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.widening");
+    crab::ScopedCrabStats __st__(domain_name() + ".widening");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return join_with(other, _inv || other._inv,
+                     [](const stack_layout &a, const stack_layout &b) {
+                       return a | b;
+                     });
+  }
+
+  stack_array_domain_t widening_thresholds(
+      const stack_array_domain_t &other,
+      const thresholds<number_t> &ts) const override {
+    crab::CrabStats::count(domain_name() + ".count.widening");
+    crab::ScopedCrabStats __st__(domain_name() + ".widening");
+    if (is_bottom()) {
+      return other;
+    }
+    if (other.is_bottom()) {
+      return *this;
+    }
+    return join_with(other, _inv.widening_thresholds(other._inv, ts),
+                     [](const stack_layout &a, const stack_layout &b) {
+                       return a | b;
+                     });
+  }
+
+  stack_array_domain_t
+  operator&&(const stack_array_domain_t &other) const override {
+    crab::CrabStats::count(domain_name() + ".count.narrowing");
+    crab::ScopedCrabStats __st__(domain_name() + ".narrowing");
+    return meet_with(other, _inv && other._inv);
+  }
+
+  void forget(const variable_vector_t &variables) override {
+    crab::CrabStats::count(domain_name() + ".count.forget");
+    crab::ScopedCrabStats __st__(domain_name() + ".forget");
+    if (is_bottom()) {
+      return;
+    }
+    for (const variable_t &v : variables) {
+      if (v.get_type().is_array()) {
+        kill_array(v);
+      }
+    }
+    _inv.forget(variables);
+  }
+
+  void project(const variable_vector_t &variables) override {
+    CRAB_WARN("stack array project not implemented");
+  }
+
+  void expand(const variable_t &var, const variable_t &new_var) override {
+    CRAB_WARN("stack array expand not implemented");
+  }
+
+  void normalize() override { _inv.normalize(); }
+
+  void minimize() override { _inv.minimize(); }
+
+  void operator+=(const linear_constraint_system_t &csts) override {
+    crab::CrabStats::count(domain_name() + ".count.add_constraints");
+    crab::ScopedCrabStats __st__(domain_name() + ".add_constraints");
+    _inv += csts;
+  }
+
+  void operator-=(const variable_t &var) override {
+    crab::CrabStats::count(domain_name() + ".count.forget");
+    crab::ScopedCrabStats __st__(domain_name() + ".forget");
+    if (var.get_type().is_array()) {
+      kill_array(var);
+    } else {
+      _inv -= var;
+    }
+  }
+
+  void assign(const variable_t &x, const linear_expression_t &e) override {
+    crab::CrabStats::count(domain_name() + ".count.assign");
+    crab::ScopedCrabStats __st__(domain_name() + ".assign");
+    _inv.assign(x, e);
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             number_t z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, x, y, z);
+  }
+
+  void apply(arith_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, x, y, z);
+  }
+
+  void select(const variable_t &lhs, const linear_constraint_t &cond,
+              const linear_expression_t &e1,
+              const linear_expression_t &e2) override {
+    _inv.select(lhs, cond, e1, e2);
+  }
+
+  void backward_assign(const variable_t &x, const linear_expression_t &e,
+                       const stack_array_domain_t &inv) override {
+    _inv.backward_assign(x, e, inv._inv);
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, number_t z,
+                      const stack_array_domain_t &inv) override {
+    _inv.backward_apply(op, x, y, z, inv._inv);
+  }
+
+  void backward_apply(arith_operation_t op, const variable_t &x,
+                      const variable_t &y, const variable_t &z,
+                      const stack_array_domain_t &inv) override {
+    _inv.backward_apply(op, x, y, z, inv._inv);
+  }
+
+  void apply(int_conv_operation_t op, const variable_t &dst,
+             const variable_t &src) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, dst, src);
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             const variable_t &z) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, x, y, z);
+  }
+
+  void apply(bitwise_operation_t op, const variable_t &x, const variable_t &y,
+             number_t k) override {
+    crab::CrabStats::count(domain_name() + ".count.apply");
+    crab::ScopedCrabStats __st__(domain_name() + ".apply");
+    _inv.apply(op, x, y, k);
+  }
+
+  // boolean operators
+  virtual void assign_bool_cst(const variable_t &lhs,
+                               const linear_constraint_t &rhs) override {
+    _inv.assign_bool_cst(lhs, rhs);
+  }
+
+  virtual void assign_bool_ref_cst(const variable_t &lhs,
+                                   const reference_constraint_t &rhs) override {
+    _inv.assign_bool_ref_cst(lhs, rhs);
+  }
+
+  virtual void assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                               bool is_not_rhs) override {
+    _inv.assign_bool_var(lhs, rhs, is_not_rhs);
+  }
+
+  virtual void apply_binary_bool(bool_operation_t op, const variable_t &x,
+                                 const variable_t &y,
+                                 const variable_t &z) override {
+    _inv.apply_binary_bool(op, x, y, z);
+  }
+
+  virtual void assume_bool(const variable_t &v, bool is_negated) override {
+    _inv.assume_bool(v, is_negated);
+  }
+
+  virtual void select_bool(const variable_t &lhs, const variable_t &cond,
+                           const variable_t &b1, const variable_t &b2) override {
+    _inv.select_bool(lhs, cond, b1, b2);
+  }
+
+  // backward boolean operators
+  virtual void
+  backward_assign_bool_cst(const variable_t &lhs,
+                           const linear_constraint_t &rhs,
+                           const stack_array_domain_t &inv) override {
+    _inv.backward_assign_bool_cst(lhs, rhs, inv._inv);
+  }
+
+  virtual void
+  backward_assign_bool_ref_cst(const variable_t &lhs,
+                               const reference_constraint_t &rhs,
+                               const stack_array_domain_t &inv) override {
+    _inv.backward_assign_bool_ref_cst(lhs, rhs, inv._inv);
+  }
+
+  virtual void
+  backward_assign_bool_var(const variable_t &lhs, const variable_t &rhs,
+                           bool is_not_rhs,
+                           const stack_array_domain_t &inv) override {
+    _inv.backward_assign_bool_var(lhs, rhs, is_not_rhs, inv._inv);
+  }
+
+  virtual void
+  backward_apply_binary_bool(bool_operation_t op, const variable_t &x,
+                             const variable_t &y, const variable_t &z,
+                             const stack_array_domain_t &inv) override {
+    _inv.backward_apply_binary_bool(op, x, y, z, inv._inv);
+  }
+
+  /// stack_array_domain is a functor domain that implements all
+  /// operations except region/reference operations.
+  REGION_AND_REFERENCE_OPERATIONS_NOT_IMPLEMENTED(stack_array_domain_t)
+
+  // array_operators_api
+
+  virtual void array_init(const variable_t &a,
+                          const linear_expression_t &elem_size,
+                          const linear_expression_t &lb_idx,
+                          const linear_expression_t &ub_idx,
+                          const linear_expression_t &val) override {
+    crab::CrabStats::count(domain_name() + ".count.array_init");
+    crab::ScopedCrabStats __st__(domain_name() + ".array_init");
+    if (is_bottom()) {
+      return;
+    }
+    kill_array(a);
+    array_store_range(a, elem_size, lb_idx, ub_idx, val);
+  }
+
+  virtual void array_load(const variable_t &lhs, const variable_t &a,
+                          const linear_expression_t &elem_size,
+                          const linear_expression_t &i) override {
+    crab::CrabStats::count(domain_name() + ".count.array_load");
+    crab::ScopedCrabStats __st__(domain_name() + ".array_load");
+    if (is_bottom()) {
+      return;
+    }
+    int w = constant_width(to_interval(elem_size));
+    interval_t ii = to_interval(i);
+    const stack_layout &layout = get_layout(a);
+    if (auto o = to_int(ii)) {
+      if (*o >= 0 && *o + w <= stack_layout::SIZE) {
+        if (layout.cell_at(*o) == w) {
+          _inv.assign(lhs, cell_scalar(a, *o, w));
+          return;
+        }
+        if (auto bits = layout.tags_in(*o, *o + w)) {
+          assign_tags(lhs, bits);
+          return;
+        }
+      }
+    } else if (auto range = byte_range(ii, w)) {
+      if (range->first < range->second) {
+        if (auto bits = layout.tags_in(range->first, range->second)) {
+          assign_tags(lhs, bits);
+          return;
+        }
+      }
+    }
+    _inv -= lhs;
+  }
+
+  virtual void array_store(const variable_t &a,
+                           const linear_expression_t &elem_size,
+                           const linear_expression_t &i,
+                           const linear_expression_t &val,
+                           bool /*is_strong_update*/) override {
+    crab::CrabStats::count(domain_name() + ".count.array_store");
+    crab::ScopedCrabStats __st__(domain_name() + ".array_store");
+    if (is_bottom()) {
+      return;
+    }
+    int w = constant_width(to_interval(elem_size));
+    interval_t ii = to_interval(i);
+    stack_layout &layout = _layouts[a];
+    stack_layout::tag_bits bits = is_region_array(a) ? tags_of(val) : 0;
+    if (auto o = to_int(ii)) {
+      if (*o < 0 || *o + w > stack_layout::SIZE) {
+        CRAB_WARN("stack array store out of the stack ignored: ", a, "[", i,
+                  "]");
+        return;
+      }
+      kill_cells(a, layout, *o, *o + w);
+      if (bits) {
+        layout.set_tags(*o, *o + w, bits);
+      } else {
+        layout.add_cell(*o, w);
+        _inv.assign(cell_scalar(a, *o, w), val);
+      }
+    } else if (auto range = byte_range(ii, w)) {
+      kill_cells(a, layout, range->first, range->second);
+      if (bits) {
+        layout.weaken_tags(range->first, range->second, bits);
+      } else {
+        layout.set_tags(range->first, range->second, 0);
+      }
+    } else {
+      kill_array(a);
+    }
+  }
+
+  virtual void array_store_range(const variable_t &a,
+                                 const linear_expression_t &elem_size,
+                                 const linear_expression_t &lb_idx,
+                                 const linear_expression_t &ub_idx,
+                                 const linear_expression_t &val) override {
+    crab::CrabStats::count(domain_name() + ".count.array_store_range");
+    crab::ScopedCrabStats __st__(domain_name() + ".array_store_range");
+    if (is_bottom()) {
+      return;
+    }
+    int w = constant_width(to_interval(elem_size));
+    interval_t lb_i = to_interval(lb_idx);
+    interval_t ub_i = to_interval(ub_idx);
+    auto lb = to_int(lb_i);
+    auto ub = to_int(ub_i);
+    if (lb && ub && *lb >= 0 && *ub + w <= stack_layout::SIZE) {
+      for (int64_t o = *lb; o <= *ub; o += w) {
+        array_store(a, elem_size, number_t(o), val, false);
+      }
+      return;
+    }
+    // Every cell of [lb, ub] may be written: a weak update of the hull.
+    interval_t hull(lb_i.lb(), ub_i.ub());
+    stack_layout &layout = _layouts[a];
+    if (auto range = byte_range(hull, w)) {
+      kill_cells(a, layout, range->first, range->second);
+      stack_layout::tag_bits bits = is_region_array(a) ? tags_of(val) : 0;
+      if (bits) {
+        layout.weaken_tags(range->first, range->second, bits);
+      } else {
+        layout.set_tags(range->first, range->second, 0);
+      }
+    } else {
+      kill_array(a);
+    }
+  }
+
+  virtual void array_assign(const variable_t &lhs,
+                            const variable_t &rhs) override {
+    CRAB_WARN("array_assign in stack array domain not implemented");
+  }
+
+  // backward array operations
+
+  virtual void
+  backward_array_init(const variable_t &a, const linear_expression_t &elem_size,
+                      const linear_expression_t &lb_idx,
+                      const linear_expression_t &ub_idx,
+                      const linear_expression_t &val,
+                      const stack_array_domain_t &invariant) override {
+    crab::CrabStats::count(domain_name() + ".count.backward_array_init");
+    crab::ScopedCrabStats __st__(domain_name() + ".backward_array_init");
+    if (is_bottom()) {
+      return;
+    }
+    kill_array(a);
+    *this = *this & invariant;
+  }
+
+  virtual void
+  backward_array_load(const variable_t &lhs, const variable_t &a,
+                      const linear_expression_t &elem_size,
+                      const linear_expression_t &i,
+                      const stack_array_domain_t &invariant) override {
+    crab::CrabStats::count(domain_name() + ".count.backward_array_load");
+    crab::ScopedCrabStats __st__(domain_name() + ".backward_array_load");
+    if (is_bottom()) {
+      return;
+    }
+    backward_forget(lhs, invariant);
+  }
+
+  virtual void backward_array_store(
+      const variable_t &a, const linear_expression_t &elem_size,
+      const linear_expression_t &i, const linear_expression_t &val,
+      bool /*is_strong_update*/,
+      const stack_array_domain_t &invariant) override {
+    crab::CrabStats::count(domain_name() + ".count.backward_array_store");
+    crab::ScopedCrabStats __st__(domain_name() + ".backward_array_store");
+    if (is_bottom()) {
+      return;
+    }
+    // XXX: we use the forward invariant to extract the array index
+    int w = constant_width(to_interval(elem_size, invariant._inv));
+    auto it = _layouts.find(a);
+    if (it != _layouts.end()) {
+      if (auto range = byte_range(to_interval(i, invariant._inv), w)) {
+        kill_cells(a, it->second, range->first, range->second);
+        it->second.set_tags(range->first, range->second, 0);
+      } else {
+        kill_array(a);
+      }
+    }
+    *this = *this & invariant;
+  }
+
+  virtual void backward_array_store_range(
+      const variable_t &a, const linear_expression_t &elem_size,
+      const linear_expression_t &lb_idx, const linear_expression_t &ub_idx,
+      const linear_expression_t &val,
+      const stack_array_domain_t &invariant) override {
+    crab::CrabStats::count(domain_name() + ".count.backward_array_store_range");
+    crab::ScopedCrabStats __st__(domain_name() +
+                                 ".backward_array_store_range");
+    if (is_bottom()) {
+      return;
+    }
+    kill_array(a);
+    *this = *this & invariant;
+  }
+
+  virtual void
+  backward_array_assign(const variable_t &lhs, const variable_t &rhs,
+                        const stack_array_domain_t &invariant) override {
+    CRAB_WARN("backward_array_assign in stack array domain not implemented");
+  }
+
+  linear_constraint_system_t to_linear_constraint_system() const override {
+    crab::CrabStats::count(domain_name() +
+                           ".count.to_linear_constraint_system");
+    crab::ScopedCrabStats __st__(domain_name() +
+                                 ".to_linear_constraint_system");
+    return _inv.to_linear_constraint_system();
+  }
+
+  disjunctive_linear_constraint_system_t
+  to_disjunctive_linear_constraint_system() const override {
+    return _inv.to_disjunctive_linear_constraint_system();
+  }
+
+  NumDomain get_content_domain() const { return _inv; }
+
+  NumDomain &get_content_domain() { return _inv; }
+
+  virtual interval_t operator[](const variable_t &v) override {
+    return _inv[v];
+  }
+
+  /* begin intrinsics operations */
+  // forget_cells(a1,...,an,lb1,ub1,...,lbm,ubm): the bytes [lbj, ubj) of
+  // the arrays ai are dead. Their cells and tags are dropped.
+  void intrinsic(std::string name, const variable_or_constant_vector_t &inputs,
+                 const variable_vector_t &outputs) override {
+    if (name != "forget_cells") {
+      CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+      return;
+    }
+    crab::CrabStats::count(domain_name() + ".count.forget_cells");
+    crab::ScopedCrabStats __st__(domain_name() + ".forget_cells");
+    if (is_bottom()) {
+      return;
+    }
+    unsigned i = 0;
+    std::vector<variable_t> arrays;
+    for (; i < inputs.size() && inputs[i].is_variable(); ++i) {
+      arrays.push_back(inputs[i].get_variable());
+    }
+    for (; i + 1 < inputs.size(); i += 2) {
+      const number_t &n_lb = inputs[i].get_constant();
+      const number_t &n_ub = inputs[i + 1].get_constant();
+      if (!fits(n_lb) || !fits(n_ub)) {
+        continue;
+      }
+      int lb = std::max<int64_t>(static_cast<int64_t>(n_lb), 0);
+      int ub = std::min<int64_t>(static_cast<int64_t>(n_ub), stack_layout::SIZE);
+      if (lb >= ub) {
+        continue;
+      }
+      for (const variable_t &a : arrays) {
+        auto it = _layouts.find(a);
+        if (it != _layouts.end()) {
+          kill_cells(a, it->second, lb, ub);
+          it->second.set_tags(lb, ub, 0);
+        }
+      }
+    }
+  }
+
+  // The dropped cells are unconstrained after the intrinsic, so they are
+  // unconstrained before it as well.
+  void backward_intrinsic(std::string name,
+                          const variable_or_constant_vector_t &inputs,
+                          const variable_vector_t &outputs,
+                          const stack_array_domain_t &invariant) override {
+    if (name != "forget_cells") {
+      CRAB_WARN("Intrinsics ", name, " not implemented by ", domain_name());
+      return;
+    }
+    intrinsic(name, inputs, outputs);
+    *this = *this & invariant;
+  }
+  /* end intrinsics operations */
+
+  // Runs of bytes with the same tags are printed as one range.
+  void write(crab_os &o) const override {
+    o << _inv;
+    if (is_bottom()) {
+      return;
+    }
+    for (auto const &[a, layout] : _layouts) {
+      for (int lb = 0; lb < stack_layout::SIZE;) {
+        stack_layout::tag_bits bits = layout.tags_at(lb);
+        int ub = lb + 1;
+        while (ub < stack_layout::SIZE && layout.tags_at(ub) == bits) {
+          ub++;
+        }
+        if (bits) {
+          tag_set tags;
+          for (int64_t v = tag_set::MIN_FIXED; v <= tag_set::MAX_FIXED; v++) {
+            if (bits & stack_layout::tag_range(v, v)) {
+              tags.insert(v);
+            }
+          }
+          std::ostringstream os;
+          os << tags;
+          o << " " << a << "[" << lb << "..." << ub - 1 << "]=" << os.str();
+        }
+        lb = ub;
+      }
+    }
+  }
+
+  std::string domain_name() const override {
+    return "StackArray(" + _inv.domain_name() + ")";
+  }
+
+  // An array takes its layout along, and the scalars of its cells become
+  // those of the same cells of the new array.
+  void rename(const variable_vector_t &from,
+              const variable_vector_t &to) override {
+    if (from.size() != to.size()) {
+      CRAB_ERROR("stack array rename with different sizes");
+    }
+    variable_vector_t old_vars, new_vars;
+    layout_map_t layouts;
+    for (size_t i = 0; i < from.size(); i++) {
+      auto it = _layouts.find(from[i]);
+      if (it == _layouts.end()) {
+        old_vars.push_back(from[i]);
+        new_vars.push_back(to[i]);
+        continue;
+      }
+      if (_layouts.count(to[i])) {
+        CRAB_ERROR("stack array rename to an array already in the state: ",
+                   to[i]);
+      }
+      it->second.for_each_cell([&](int o, int w) {
+        old_vars.push_back(cell_scalar(from[i], o, w));
+        new_vars.push_back(cell_scalar(to[i], o, w));
+      });
+      layouts.emplace(to[i], std::move(it->second));
+      _layouts.erase(it);
+    }
+    _layouts.insert(layouts.begin(), layouts.end());
+    _inv.rename(old_vars, new_vars);
+  }
+
+}; // end stack_array_domain
+
+template <typename BaseDomain>
+struct abstract_domain_traits<stack_array_domain<BaseDomain>> {
+  using number_t = typename BaseDomain::number_t;
+  using varname_t = typename BaseDomain::varname_t;
+};
+
+template <typename BaseDom>
+class checker_domain_traits<stack_array_domain<BaseDom>> {
+public:
+  using this_type = stack_array_domain<BaseDom>;
+  using linear_constraint_t = typename this_type::linear_constraint_t;
+  using disjunctive_linear_constraint_system_t =
+      typename this_type::disjunctive_linear_constraint_system_t;
+
+  static bool entail(this_type &lhs,
+                     const disjunctive_linear_constraint_system_t &rhs) {
+    BaseDom &lhs_dom = lhs.get_content_domain();
+    return checker_domain_traits<BaseDom>::entail(lhs_dom, rhs);
+  }
+
+  static bool entail(const disjunctive_linear_constraint_system_t &lhs,
+                     this_type &rhs) {
+    BaseDom &rhs_dom = rhs.get_content_domain();
+    return checker_domain_traits<BaseDom>::entail(lhs, rhs_dom);
+  }
+
+  static bool entail(this_type &lhs, const linear_constraint_t &rhs) {
+    BaseDom &lhs_dom = lhs.get_content_domain();
+    return checker_domain_traits<BaseDom>::entail(lhs_dom, rhs);
+  }
+
+  static bool intersect(this_type &inv, const linear_constraint_t &cst) {
+    BaseDom &dom = inv.get_content_domain();
+    return checker_domain_traits<BaseDom>::intersect(dom, cst);
+  }
+};
+
+template <typename BaseDom>
+class special_domain_traits<stack_array_domain<BaseDom>> {
+public:
+  static void clear_global_state(void) {
+    stack_array_domain<BaseDom>::clear_global_state();
+    special_domain_traits<BaseDom>::clear_global_state();
+  }
+};
+
+} // namespace domains
+} // namespace crab
@@ -0,0 +1,218 @@
+#pragma once
+
+/**
+ *  Fixed layout of one array over the eBPF stack.
+ *
+ *  The stack is STACK_SIZE bytes and nearly every access has a constant
+ *  offset and a width of 1, 2, 4 or 8 bytes, so the cells of an array are
+ *  kept in two byte maps rather than in a general offset map:
+ *
+ *  - width[o] is the width of the cell starting at byte o, or 0. Cells do not
+ *    overlap, so the cells overlapping an access are found by looking at most
+ *    MAX_WIDTH - 1 bytes before it.
+ *  - tags[o] is the set of fixed region tags (T_UNINIT..T_SHARED, see
+ *    region_tags.hpp) byte o may hold, one bit per tag, or 0 if unknown. It is
+ *    only used for the region array, whose bytes hold the tag of the value
+ *    stored over them; a byte covered by a cell has no tags.
+ *
+ *  The contents of the cells live in the numerical domain. The lattice
+ *  operations below only combine the maps; they run over whole maps and use
+ *  AVX2 when the compiler targets it.
+ **/
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "region_tags.hpp"
+#include "spec_type_descriptors.hpp"
+
+class stack_layout {
+public:
+    static constexpr int SIZE = STACK_SIZE;
+    static constexpr int MAX_WIDTH = 8;
+
+    using tag_bits = uint8_t;
+
+private:
+    static_assert(tag_set::NFIXED <= 8, "fixed tags must fit in a byte");
+
+    std::array<uint8_t, SIZE> _width{};
+    std::array<tag_bits, SIZE> _tags{};
+
+    void clear_tags_under_cells() {
+        for (int o = 0; o < SIZE; o++) {
+            for (int i = 0; i < _width[o]; i++)
+                _tags[o + i] = 0;
+        }
+    }
+
+public:
+    static bool valid_width(int64_t w) { return w == 1 || w == 2 || w == 4 || w == 8; }
+
+    /** The fixed tags in [lb, ub], or 0 if some value in it is not one. */
+    static tag_bits tag_range(int64_t lb, int64_t ub) {
+        if (lb > ub || lb < tag_set::MIN_FIXED || ub > tag_set::MAX_FIXED)
+            return 0;
+        tag_bits res = 0;
+        for (int64_t v = lb; v <= ub; v++)
+            res |= 1 << (v - tag_set::MIN_FIXED);
+        return res;
+    }
+
+    /** Smallest and largest tag of a non-zero set. */
+    static int64_t min_tag(tag_bits bits) { return tag_set::MIN_FIXED + __builtin_ctz(bits); }
+    static int64_t max_tag(tag_bits bits) { return tag_set::MIN_FIXED + 31 - __builtin_clz(bits); }
+
+    bool is_top() const {
+        for (int o = 0; o < SIZE; o++) {
+            if (_width[o] || _tags[o])
+                return false;
+        }
+        return true;
+    }
+
+    /** Width of the cell starting at o, or 0. */
+    int cell_at(int o) const { return _width[o]; }
+
+    /** Whether a cell overlaps [lb, ub). */
+    bool overlaps(int lb, int ub) const {
+        for (int o = std::max(0, lb - MAX_WIDTH + 1); o < std::min(ub, SIZE); o++) {
+            if (_width[o] && o + _width[o] > lb)
+                return true;
+        }
+        return false;
+    }
+
+    /** Remove the cells overlapping [lb, ub), calling f(offset, width) on
+     *  each. */
+    template <typename F>
+    void remove_cells(int lb, int ub, F f) {
+        for (int o = std::max(0, lb - MAX_WIDTH + 1); o < std::min(ub, SIZE); o++) {
+            if (_width[o] && o + _width[o] > lb) {
+                f(o, (int)_width[o]);
+                _width[o] = 0;
+            }
+        }
+    }
+
+    /** Add the cell [o, o + w), which must not overlap another one. */
+    void add_cell(int o, int w) {
+        _width[o] = w;
+        for (int i = o; i < o + w; i++)
+            _tags[i] = 0;
+    }
+
+    template <typename F>
+    void for_each_cell(F f) const {
+        for (int o = 0; o < SIZE; o++) {
+            if (_width[o])
+                f(o, (int)_width[o]);
+        }
+    }
+
+    tag_bits tags_at(int o) const { return _tags[o]; }
+
+    /** Union of the tags of [lb, ub), or 0 if one of them is unknown. */
+    tag_bits tags_in(int lb, int ub) const {
+        tag_bits res = 0;
+        for (int o = lb; o < ub; o++) {
+            if (!_tags[o])
+                return 0;
+            res |= _tags[o];
+        }
+        return res;
+    }
+
+    /** Strong update of the tags of [lb, ub), which must not hold cells. */
+    void set_tags(int lb, int ub, tag_bits bits) {
+        for (int o = lb; o < ub; o++)
+            _tags[o] = bits;
+    }
+
+    /** Weak update: each byte of [lb, ub) may now also hold bits. */
+    void weaken_tags(int lb, int ub, tag_bits bits) {
+        for (int o = lb; o < ub; o++) {
+            if (_tags[o])
+                _tags[o] |= bits;
+        }
+    }
+
+    /** Cells present in both with the same width; tags known in both. */
+    friend stack_layout operator|(const stack_layout& a, const stack_layout& b) {
+        stack_layout res;
+        int o = 0;
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        for (; o + 32 <= SIZE; o += 32) {
+            __m256i wa = _mm256_loadu_si256((const __m256i*)(a._width.data() + o));
+            __m256i wb = _mm256_loadu_si256((const __m256i*)(b._width.data() + o));
+            __m256i w = _mm256_and_si256(wa, _mm256_cmpeq_epi8(wa, wb));
+            _mm256_storeu_si256((__m256i*)(res._width.data() + o), w);
+
+            __m256i ta = _mm256_loadu_si256((const __m256i*)(a._tags.data() + o));
+            __m256i tb = _mm256_loadu_si256((const __m256i*)(b._tags.data() + o));
+            __m256i unknown = _mm256_or_si256(_mm256_cmpeq_epi8(ta, zero), _mm256_cmpeq_epi8(tb, zero));
+            __m256i t = _mm256_andnot_si256(unknown, _mm256_or_si256(ta, tb));
+            _mm256_storeu_si256((__m256i*)(res._tags.data() + o), t);
+        }
+#endif
+        for (; o < SIZE; o++) {
+            res._width[o] = a._width[o] == b._width[o] ? a._width[o] : 0;
+            res._tags[o] = a._tags[o] && b._tags[o] ? a._tags[o] | b._tags[o] : 0;
+        }
+        return res;
+    }
+
+    /** Cells of a, and those of b that do not overlap them; tags known in
+     *  either and not covered by a cell. Empty if a byte can hold no tag. */
+    friend std::optional<stack_layout> meet(const stack_layout& a, const stack_layout& b) {
+        stack_layout res = a;
+        for (int o = 0; o < SIZE; o++) {
+            if (b._width[o] && res._width[o] != b._width[o] && !res.overlaps(o, o + b._width[o]))
+                res._width[o] = b._width[o];
+        }
+        for (int o = 0; o < SIZE; o++) {
+            if (a._tags[o] && b._tags[o]) {
+                res._tags[o] = a._tags[o] & b._tags[o];
+                if (!res._tags[o])
+                    return {};
+            } else {
+                res._tags[o] = a._tags[o] | b._tags[o];
+            }
+        }
+        res.clear_tags_under_cells();
+        return res;
+    }
+
+    /** Inclusion of the tags. Cells are compared in the numerical domain:
+     *  the content of a missing cell is unconstrained there. */
+    friend bool operator<=(const stack_layout& a, const stack_layout& b) {
+        int o = 0;
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        for (; o + 32 <= SIZE; o += 32) {
+            __m256i ta = _mm256_loadu_si256((const __m256i*)(a._tags.data() + o));
+            __m256i tb = _mm256_loadu_si256((const __m256i*)(b._tags.data() + o));
+            // b known and (a unknown or a has a tag b does not)
+            __m256i bad = _mm256_or_si256(_mm256_cmpeq_epi8(ta, zero),
+                                          _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_andnot_si256(tb, ta), zero),
+                                                           _mm256_set1_epi8(-1)));
+            bad = _mm256_andnot_si256(_mm256_cmpeq_epi8(tb, zero), bad);
+            if (!_mm256_testz_si256(bad, bad))
+                return false;
+        }
+#endif
+        for (; o < SIZE; o++) {
+            if (b._tags[o] && (!a._tags[o] || (a._tags[o] & ~b._tags[o])))
+                return false;
+        }
+        return true;
+    }
+
+    bool operator==(const stack_layout& o) const { return _width == o._width && _tags == o._tags; }
+};
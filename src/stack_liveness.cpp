@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <variant>
+
+#include "stack_liveness.hpp"
+
+using std::vector;
+
+using bytes = stack_liveness::bytes;
+
+// The bytes of [lb, ub) that are on the stack.
+static bytes range(int lb, int ub) {
+    bytes res;
+    for (int i = std::max(lb, 0); i < std::min(ub, STACK_SIZE); i++)
+        res.set(i);
+    return res;
+}
+
+static bool on_stack(const Deref& access) { return access.basereg.v == 10; }
+
+static int start(const Deref& access) { return -access.offset - access.width; }
+
+static bytes accessed(const Deref& access) {
+    return range(start(access), -access.offset);
+}
+
+// A store out of bounds is rejected anyway; do not let it kill anything.
+static bytes overwritten(const Deref& access) {
+    if (start(access) < 0 || -access.offset > STACK_SIZE)
+        return {};
+    return accessed(access);
+}
+
+static bool reads_memory(const Call& call) {
+    for (const ArgSingle& arg : call.singles) {
+        if (arg.kind == ArgSingle::Kind::PTR_TO_MAP_KEY || arg.kind == ArgSingle::Kind::PTR_TO_MAP_VALUE)
+            return true;
+    }
+    for (const ArgPair& arg : call.pairs) {
+        if (arg.kind != ArgPair::Kind::PTR_TO_UNINIT_MEM)
+            return true;
+    }
+    return false;
+}
+
+static bool writes_memory(const Call& call) {
+    for (const ArgPair& arg : call.pairs) {
+        if (arg.kind == ArgPair::Kind::PTR_TO_UNINIT_MEM)
+            return true;
+    }
+    return false;
+}
+
+// Live bytes before ins, given those after it.
+static void live_before(const Instruction& ins, bytes& live) {
+    std::visit(overloaded{
+        [&](const Mem& a) {
+            if (!on_stack(a.access)) {
+                if (a.is_load)
+                    live.set();
+            } else if (a.is_load) {
+                live |= accessed(a.access);
+            } else {
+                live &= ~overwritten(a.access);
+            }
+        },
+        [&](const LockAdd& a) {
+            if (on_stack(a.access))
+                live |= accessed(a.access);
+            else
+                live.set();
+        },
+        [&](const Call& a) {
+            if (reads_memory(a))
+                live.set();
+        },
+        [&](const Exit&) { live.reset(); },
+        [](const auto&) {}
+    }, ins);
+}
+
+// Bytes that may hold a value after ins, given those before it.
+static void held_after(const Instruction& ins, bytes& held) {
+    std::visit(overloaded{
+        [&](const Mem& a) {
+            if (a.is_load)
+                return;
+            if (on_stack(a.access))
+                held |= accessed(a.access);
+            else
+                held.set();
+        },
+        [&](const LockAdd& a) {
+            if (on_stack(a.access))
+                held |= accessed(a.access);
+            else
+                held.set();
+        },
+        [&](const Call& a) {
+            if (writes_memory(a))
+                held.set();
+        },
+        [](const auto&) {}
+    }, ins);
+}
+
+stack_liveness::stack_liveness(const Cfg& cfg) {
+    const vector<Label>& labels = cfg.keys();
+
+    for (const Label& l : labels)
+        live_in[l] = {};
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+            const BasicBlock& bb = cfg.at(*it);
+            bytes live;
+            for (const Label& next : bb.nextlist)
+                live |= live_in.at(next);
+            for (auto ins = bb.insts.rbegin(); ins != bb.insts.rend(); ++ins)
+                live_before(*ins, live);
+            if (live != live_in[*it]) {
+                live_in[*it] = live;
+                changed = true;
+            }
+        }
+    }
+
+    // Nothing is held on entry to the program.
+    std::map<Label, bytes> held_in;
+    for (const Label& l : labels)
+        held_in[l] = {};
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const Label& l : labels) {
+            const BasicBlock& bb = cfg.at(l);
+            dead_in[l] = held_in.at(l) & ~live_in.at(l);
+            bytes held = held_in.at(l) & live_in.at(l);
+            for (const Instruction& ins : bb.insts)
+                held_after(ins, held);
+            for (const Label& next : bb.nextlist) {
+                bytes& in = held_in.at(next);
+                if ((held & ~in).any()) {
+                    in |= held;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+vector<std::pair<int, int>> stack_liveness::dead_ranges(const Label& l) const {
+    vector<std::pair<int, int>> res;
+    const bytes& dead = dead_in.at(l);
+    for (int i = 0; i < STACK_SIZE;) {
+        if (!dead[i]) {
+            i++;
+            continue;
+        }
+        int lb = i;
+        while (i < STACK_SIZE && dead[i])
+            i++;
+        res.emplace_back(lb, i);
+    }
+    return res;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+/**
+ *  Liveness of the bytes of the eBPF stack.
+ *
+ *  Bytes are numbered as in the stack arrays of the translation: an access
+ *  of width w at r10 + offset covers the bytes [-offset - w, -offset). A byte
+ *  is live at a point if some path from it loads the byte before storing over
+ *  it. Accesses that do not go through r10, and helpers that read memory, may
+ *  read any byte and store over none.
+ *
+ *  A forward pass then finds the bytes that may have been stored to since
+ *  they were last dead. The bytes that are dead on entry to a block but may
+ *  still be held from an earlier store are the ones whose cells can be
+ *  forgotten there.
+ **/
+#include <bitset>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "asm_cfg.hpp"
+#include "spec_type_descriptors.hpp"
+
+class stack_liveness {
+public:
+    using bytes = std::bitset<STACK_SIZE>;
+
+private:
+    std::map<Label, bytes> live_in;
+    std::map<Label, bytes> dead_in;
+
+public:
+    explicit stack_liveness(const Cfg& cfg);
+
+    const bytes& live_at(const Label& l) const { return live_in.at(l); }
+
+    /** Maximal ranges [lb, ub) of bytes that may hold a value on entry to l
+     *  but are dead there. */
+    std::vector<std::pair<int, int>> dead_ranges(const Label& l) const;
+};
@@ -0,0 +1,91 @@
+#include <algorithm>
+
+#include "state_telemetry.hpp"
+
+state_telemetry global_telemetry;
+
+static state_size max_of(state_size a, const state_size& b)
+{
+    a.variables = std::max(a.variables, b.variables);
+    a.constraints = std::max(a.constraints, b.constraints);
+    a.cells = std::max(a.cells, b.cells);
+    return a;
+}
+
+void state_telemetry::add(size_t step, const std::string& block, const state_size& size)
+{
+    samples.push_back({step, block, size});
+    if (samples.size() <= max_samples)
+        return;
+    period *= 2;
+    samples.erase(std::remove_if(samples.begin(), samples.end(),
+                                 [this](const state_sample& s) { return s.step % period != 0; }),
+                  samples.end());
+}
+
+state_size state_telemetry::max() const
+{
+    state_size res;
+    for (const state_sample& s : samples)
+        res = max_of(res, s.size);
+    return res;
+}
+
+state_size state_telemetry::mean() const
+{
+    state_size res;
+    if (samples.empty())
+        return res;
+    for (const state_sample& s : samples) {
+        res.variables += s.size.variables;
+        res.constraints += s.size.constraints;
+        res.cells += s.size.cells;
+    }
+    res.variables /= samples.size();
+    res.constraints /= samples.size();
+    res.cells /= samples.size();
+    return res;
+}
+
+std::map<std::string, state_size> state_telemetry::per_block() const
+{
+    std::map<std::string, state_size> res;
+    for (const state_sample& s : samples)
+        res[s.block] = max_of(res[s.block], s.size);
+    return res;
+}
+
+std::vector<std::string> state_telemetry::csv_headers()
+{
+    return {"max_vars", "mean_vars", "max_csts", "mean_csts", "max_cells", "mean_cells"};
+}
+
+void state_telemetry::write_csv_summary(std::ostream& out) const
+{
+    state_size hi = max();
+    state_size avg = mean();
+    out << hi.variables << "," << avg.variables << ","
+        << hi.constraints << "," << avg.constraints << ","
+        << hi.cells << "," << avg.cells;
+}
+
+void state_telemetry::write_csv_unmeasured(std::ostream& out)
+{
+    for (size_t i = 0; i < csv_headers().size(); i++)
+        out << (i ? "," : "") << "n/a";
+}
+
+void state_telemetry::write_series(std::ostream& out) const
+{
+    out << "step,block,variables,constraints,cells\n";
+    for (const state_sample& s : samples) {
+        out << s.step << "," << s.block << "," << s.size.variables << "," << s.size.constraints << "," << s.size.cells << "\n";
+    }
+}
+
+void state_telemetry::write_blocks(std::ostream& out) const
+{
+    out << "block,variables,constraints,cells\n";
+    for (const auto& [block, size] : per_block())
+        out << block << "," << size.variables << "," << size.constraints << "," << size.cells << "\n";
+}
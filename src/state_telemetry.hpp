@@ -0,0 +1,78 @@
+#pragma once
+
+/**
+ *  Size of the abstract states over the course of an analysis.
+ *
+ *  The fixpoint iterator samples the post-state of the blocks it visits.
+ *  The samples form a time series, are summarized per block, and their
+ *  maximum and mean are reported with the results of the analysis, together
+ *  with the engine that produced the states.
+ *
+ *  Measuring a state costs about as much as a transfer function, so at most
+ *  max_samples are kept: past that, every other sample is dropped and only
+ *  every other visit is measured from then on. Steps keep counting visits.
+ **/
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct state_size {
+    size_t variables = 0;    // numerical variables constrained by the state
+    size_t constraints = 0;  // linear constraints; for DBMs, about the edges
+    size_t cells = 0;        // scalars standing for array cells
+};
+
+struct state_sample {
+    size_t step;
+    std::string block;
+    state_size size;
+};
+
+class state_telemetry {
+    std::vector<state_sample> samples;
+    std::string engine;
+    // visits so far; every period-th one is measured
+    size_t steps = 0;
+    size_t period = 1;
+
+    void add(size_t step, const std::string& block, const state_size& size);
+
+public:
+    static constexpr size_t max_samples = 4096;
+
+    void clear() { *this = state_telemetry(); }
+
+    /** The analysis whose states are measured; empty if none was. */
+    void set_engine(const std::string& name) { engine = name; }
+    const std::string& get_engine() const { return engine; }
+
+    /** One visit of block, measured as measure() if it is sampled. */
+    template <typename F>
+    void visit(const std::string& block, F measure) {
+        size_t step = steps++;
+        if (step % period == 0)
+            add(step, block, measure());
+    }
+    void record(const std::string& block, const state_size& size) { add(steps++, block, size); }
+    const std::vector<state_sample>& get_samples() const { return samples; }
+
+    state_size max() const;
+    state_size mean() const;
+
+    /** Largest sample of each block. */
+    std::map<std::string, state_size> per_block() const;
+
+    static std::vector<std::string> csv_headers();
+    /** Max and mean of each measure, in the order of csv_headers(). */
+    void write_csv_summary(std::ostream& out) const;
+    /** The summary of an analysis that was not measured. */
+    static void write_csv_unmeasured(std::ostream& out);
+
+    /** One line per sample: step,block,variables,constraints,cells. */
+    void write_series(std::ostream& out) const;
+    /** One line per block with its largest sample. */
+    void write_blocks(std::ostream& out) const;
+};
+
+extern state_telemetry global_telemetry;
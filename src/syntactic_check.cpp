@@ -0,0 +1,225 @@
+#include <array>
+#include <bitset>
+#include <map>
+#include <optional>
+#include <variant>
+
+#include "spec_type_descriptors.hpp"
+#include "interpreter.hpp"
+#include "syntactic_check.hpp"
+
+using std::string;
+using std::vector;
+
+constexpr int NREGS = 11;
+
+static string name(Reg r) { return "r" + std::to_string(r.v); }
+
+namespace {
+
+// The registers r0 to r10 that may have been written, and those that hold
+// the same constant on every path
+struct state {
+    std::bitset<NREGS> written;
+    std::array<std::optional<uint64_t>, NREGS> values;
+
+    bool operator==(const state& o) const { return written == o.written && values == o.values; }
+
+    void operator|=(const state& o) {
+        written |= o.written;
+        for (int i = 0; i < NREGS; i++) {
+            if (values[i] != o.values[i])
+                values[i] = std::nullopt;
+        }
+    }
+};
+
+// Transfer of the state over one instruction. If errors is not null, the
+// errors of the instruction are added to it.
+class checker {
+    state& s;
+    const Label& label;
+    vector<syntactic_error>* errors;
+
+    void error(const string& message) {
+        if (errors)
+            errors->push_back({label, message});
+    }
+
+    void read(Reg r) {
+        if (r.v < NREGS && !s.written[r.v])
+            error(name(r) + " is read before it is written");
+    }
+
+    void read(const Value& v) {
+        if (std::holds_alternative<Reg>(v))
+            read(std::get<Reg>(v));
+    }
+
+    std::optional<uint64_t> value(const Value& v) const {
+        if (std::holds_alternative<Imm>(v))
+            return std::get<Imm>(v).v;
+        Reg r = std::get<Reg>(v);
+        return r.v < NREGS ? s.values[r.v] : std::nullopt;
+    }
+
+    void write(Reg r, std::optional<uint64_t> value = std::nullopt) {
+        if (r.v == 10) {
+            error("r10 is read-only");
+        } else if (r.v < NREGS) {
+            s.written.set(r.v);
+            s.values[r.v] = value;
+        }
+    }
+
+    void scratch() {
+        for (int i = 1; i <= 5; i++) {
+            s.written.reset(i);
+            s.values[i] = std::nullopt;
+        }
+    }
+
+    void access(const Deref& d) {
+        read(d.basereg);
+        if (d.basereg.v == 10 && (d.offset < -STACK_SIZE || d.offset + d.width > 0))
+            error("stack access at r10" + string(d.offset < 0 ? "" : "+") + std::to_string(d.offset) + " of width " + std::to_string(d.width) + " is out of bounds");
+    }
+
+    void condition(const Condition& c) {
+        read(c.left);
+        read(c.right);
+    }
+
+public:
+    checker(state& s, const Label& label, vector<syntactic_error>* errors)
+        : s{s}, label{label}, errors{errors} { }
+
+    void operator()(const Undefined&) { }
+    void operator()(const LoadMapFd& a) { write(a.dst); }
+    void operator()(const Bin& a) {
+        if (a.op != Bin::Op::MOV)
+            read(a.dst);
+        read(a.v);
+        std::optional<uint64_t> dst = a.op == Bin::Op::MOV ? 0 : value(a.dst);
+        std::optional<uint64_t> v = value(a.v);
+        write(a.dst, dst && v ? std::optional{alu(a.op, *dst, *v, a.is64)} : std::nullopt);
+    }
+    void operator()(const Un& a) {
+        read(a.dst);
+        write(a.dst);
+    }
+    void operator()(const Call& a) {
+        for (const ArgSingle& arg : a.singles)
+            read(arg.reg);
+        for (const ArgPair& arg : a.pairs) {
+            read(arg.mem);
+            read(arg.size);
+        }
+        scratch();
+        write(Reg{0});
+    }
+    void operator()(const Exit&) {
+        if (!s.written[0])
+            error("r0 is not set at exit");
+    }
+    void operator()(const Jmp& a) {
+        if (a.cond)
+            condition(*a.cond);
+    }
+    void operator()(const Assume& a) { condition(a.cond); }
+    void operator()(const Mem& a) {
+        access(a.access);
+        if (a.is_load)
+            write(std::get<Reg>(a.value));
+        else
+            read(a.value);
+    }
+    void operator()(const Packet& a) {
+        // the context is implicitly in r6
+        read(Reg{6});
+        if (a.regoffset)
+            read(*a.regoffset);
+        scratch();
+        write(Reg{0});
+    }
+    void operator()(const LockAdd& a) {
+        access(a.access);
+        read(a.valreg);
+    }
+    void operator()(const Assert&) { }
+};
+
+}
+
+static void run(const BasicBlock& bb, state& s, const Label& label, vector<syntactic_error>* errors) {
+    for (const Instruction& ins : bb.insts)
+        std::visit(checker{s, label, errors}, ins);
+}
+
+// The successors of a block, without the edge a branch on constants never
+// takes
+static vector<Label> successors(const BasicBlock& bb, const state& s) {
+    if (bb.insts.empty() || !std::holds_alternative<Jmp>(bb.insts.back()))
+        return bb.nextlist;
+    const Jmp& jmp = std::get<Jmp>(bb.insts.back());
+    if (!jmp.cond || jmp.cond->left.v >= NREGS)
+        return bb.nextlist;
+    std::optional<uint64_t> left = s.values[jmp.cond->left.v];
+    std::optional<uint64_t> right;
+    if (std::holds_alternative<Imm>(jmp.cond->right))
+        right = std::get<Imm>(jmp.cond->right).v;
+    else if (std::get<Reg>(jmp.cond->right).v < NREGS)
+        right = s.values[std::get<Reg>(jmp.cond->right).v];
+    if (!left || !right)
+        return bb.nextlist;
+    bool jumps = taken(jmp.cond->op, *left, *right);
+    vector<Label> res;
+    for (const Label& next : bb.nextlist) {
+        if ((next == jmp.target) == jumps)
+            res.push_back(next);
+    }
+    return res;
+}
+
+vector<syntactic_error> syntactic_errors(const Cfg& cfg) {
+    const vector<Label>& labels = cfg.keys();
+    if (labels.empty())
+        return {};
+
+    // The state on entry to each block reachable through feasible edges
+    std::map<Label, state> in;
+    in[labels.front()].written.set(1).set(10);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const Label& l : labels) {
+            auto it = in.find(l);
+            if (it == in.end())
+                continue;
+            state s = it->second;
+            run(cfg.at(l), s, l, nullptr);
+            for (const Label& next : successors(cfg.at(l), s)) {
+                auto [next_in, inserted] = in.emplace(next, s);
+                if (inserted) {
+                    changed = true;
+                    continue;
+                }
+                state joined = next_in->second;
+                joined |= s;
+                if (!(joined == next_in->second)) {
+                    next_in->second = joined;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    vector<syntactic_error> errors;
+    for (const Label& l : labels) {
+        auto it = in.find(l);
+        if (it == in.end())
+            continue;
+        state s = it->second;
+        run(cfg.at(l), s, l, &errors);
+    }
+    return errors;
+}
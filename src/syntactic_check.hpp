@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ *  Errors that can be found without analyzing values.
+ *
+ *  A forward dataflow over the registers that may have been written finds
+ *  the reads of registers that no path from the entry writes, including r0
+ *  at exit. Writes to r10 and accesses through r10 outside the stack are
+ *  errors on their own. Each such instruction fails on every execution that
+ *  reaches it, so a program with an error in a reachable block can be
+ *  rejected before the abstract interpretation.
+ *
+ *  The same dataflow propagates the registers that hold a constant, and a
+ *  branch whose operands are both constant only follows the edge it takes,
+ *  so blocks that are dead because of a constant condition are not
+ *  checked.
+ **/
+#include <string>
+#include <vector>
+
+#include "asm_cfg.hpp"
+
+struct syntactic_error {
+    Label label;
+    std::string message;
+};
+
+/** The errors in the blocks reachable from the entry through feasible
+ *  edges, in the order of the blocks. */
+std::vector<syntactic_error> syntactic_errors(const Cfg& cfg);
@@ -0,0 +1,52 @@
+#include "catch.hpp"
+
+#include <sstream>
+
+#include "checked_number.hpp"
+
+static const checked_number MAX = INT64_MAX;
+static const checked_number MIN = INT64_MIN;
+
+TEST_CASE( "checked numbers", "[number]" ) {
+    SECTION( "words" ) {
+        checked_number x = 7, y = -2;
+        REQUIRE((x + y) == 5);
+        REQUIRE((x * y) == -14);
+        REQUIRE((x / y) == -3);
+        REQUIRE((x % y) == 1);
+        REQUIRE((-x % 2) == -1);
+        REQUIRE((x & 3) == 3);
+        REQUIRE((y >> 1) == -1);
+        REQUIRE(((x << 2) | 1) == 29);
+        REQUIRE((x + y).fits_int64());
+        REQUIRE(y < x);
+    }
+
+    SECTION( "overflow promotes" ) {
+        checked_number big = MAX + 1;
+        REQUIRE_FALSE(big.fits_int64());
+        REQUIRE(big.get_str() == "9223372036854775808");
+        REQUIRE(big > MAX);
+        REQUIRE(MIN - 1 < MIN);
+        REQUIRE((MAX * 2).get_str() == "18446744073709551614");
+        REQUIRE_FALSE((-MIN).fits_int64());
+        REQUIRE((MIN / -1) == big);
+        REQUIRE((MIN % -1) == 0);
+    }
+
+    SECTION( "results that fit are words again" ) {
+        checked_number big = MAX + 1;
+        REQUIRE((big - 1).fits_int64());
+        REQUIRE((big - 1) == MAX);
+        REQUIRE((big / 2) == checked_number(INT64_C(1) << 62));
+        REQUIRE((big / 2).fits_int64());
+        REQUIRE(checked_number(std::string("-12")) == -12);
+        REQUIRE(checked_number(std::string("-12")).fits_int64());
+    }
+
+    SECTION( "printing" ) {
+        std::ostringstream os;
+        os << checked_number(-3) << " " << MAX * 4;
+        REQUIRE(os.str() == "-3 36893488147419103228");
+    }
+}
@@ -0,0 +1,42 @@
+#include "catch.hpp"
+
+#include "crab_common.hpp"
+#include "crab_domains.hpp"
+#include "crab_fixpoint.hpp"
+
+using var_t = crab::variable<ikos::z_number, varname_t>;
+using interval_t = ikos::interval<ikos::z_number>;
+
+TEST_CASE( "fixpoint iterator in memory-saving mode", "[fixpoint]" ) {
+    variable_factory_t vfac;
+    var_t x{vfac["x"], crab::INT_TYPE, 64};
+
+    // entry -> a -> b: only the entry is a cut point
+    cfg_t cfg("entry");
+    basic_block_t& entry = cfg.insert("entry");
+    basic_block_t& a = cfg.insert("a");
+    basic_block_t& b = cfg.insert("b");
+    entry >> a;
+    a >> b;
+    entry.assign(x, ikos::z_number(1));
+    a.add(x, x, ikos::z_number(1));
+    b.add(x, x, ikos::z_number(1));
+
+    fixpoint_params params;
+    params.retain_all = false;
+    fixpoint_iterator<z_interval_domain_t> engine(cfg, params);
+    engine.run(z_interval_domain_t::top());
+    REQUIRE(engine.retained() == 1);
+
+    SECTION( "the pre-invariant of the replayed block is cached" ) {
+        REQUIRE(engine.get_pre("b")[x] == interval_t(ikos::z_number(2)));
+        REQUIRE(engine.get_pre("b")[x] == interval_t(ikos::z_number(2)));
+        REQUIRE(engine.get_post("b")[x] == interval_t(ikos::z_number(3)));
+    }
+
+    SECTION( "a block right after a cut point" ) {
+        REQUIRE(engine.get_pre("a")[x] == interval_t(ikos::z_number(1)));
+        REQUIRE(engine.get_pre("a")[x] == interval_t(ikos::z_number(1)));
+        REQUIRE(engine.get_pre("b")[x] == interval_t(ikos::z_number(2)));
+    }
+}
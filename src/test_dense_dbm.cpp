@@ -0,0 +1,129 @@
+#include "catch.hpp"
+
+#include <vector>
+
+#include "dense_dbm.hpp"
+
+static constexpr auto INF = dense_dbm::INF;
+
+// x <= ub and lb <= x
+static void bound(dense_dbm& m, size_t x, int64_t lb, int64_t ub) {
+    m.add_edge(0, x, ub);
+    m.add_edge(x, 0, -lb);
+}
+
+TEST_CASE( "dense dbm kernels", "[dbm]" ) {
+    SECTION( "relax saturates and skips infinite weights" ) {
+        std::vector<int64_t> dst{10, 10, 10, 10, 10, INF};
+        std::vector<int64_t> src{1, INF, -5, dense_dbm::MAX_WEIGHT, 7, -2};
+        dbm_kernels::relax(dst.data(), src.data(), 2, dst.size());
+        REQUIRE(dst == std::vector<int64_t>{3, 10, -3, 10, 9, 0});
+    }
+
+    SECTION( "elementwise operations" ) {
+        std::vector<int64_t> a{1, INF, 3, -4, 5}, b{2, 0, INF, -4, 1}, r(5);
+        dbm_kernels::join(r.data(), a.data(), b.data(), 5);
+        REQUIRE(r == std::vector<int64_t>{2, INF, INF, -4, 5});
+        dbm_kernels::meet(r.data(), a.data(), b.data(), 5);
+        REQUIRE(r == std::vector<int64_t>{1, 0, 3, -4, 1});
+        dbm_kernels::widen(r.data(), a.data(), b.data(), 5);
+        REQUIRE(r == std::vector<int64_t>{INF, INF, INF, -4, 5});
+        dbm_kernels::narrow(r.data(), a.data(), b.data(), 5);
+        REQUIRE(r == std::vector<int64_t>{1, 0, 3, -4, 5});
+        REQUIRE(dbm_kernels::leq(r.data(), a.data(), 5));
+        REQUIRE_FALSE(dbm_kernels::leq(a.data(), b.data(), 5));
+    }
+}
+
+TEST_CASE( "dense dbm", "[dbm]" ) {
+    dense_dbm m(3);
+
+    SECTION( "incremental closure derives transitive bounds" ) {
+        bound(m, 1, 0, 10);
+        m.add_edge(1, 2, 4);   // x2 - x1 <= 4
+        m.add_edge(2, 3, -1);  // x3 - x2 <= -1
+        REQUIRE(m.get(0, 2) == 14);
+        REQUIRE(m.get(0, 3) == 13);
+        REQUIRE(m.get(1, 3) == 3);
+        REQUIRE(m.get(3, 0) == INF);
+        REQUIRE_FALSE(m.is_bottom());
+    }
+
+    SECTION( "contradiction" ) {
+        bound(m, 1, 5, 10);
+        REQUIRE_FALSE(m.add_edge(0, 1, 4));
+        REQUIRE(m.is_bottom());
+    }
+
+    SECTION( "full closure agrees with incremental closure" ) {
+        dense_dbm inc(3);
+        bound(inc, 1, 0, 10);
+        inc.add_edge(1, 2, 4);
+        inc.add_edge(2, 3, -1);
+        // an unclosed matrix with the same edges, obtained by widening
+        dense_dbm wide = inc || inc;
+        wide.close();
+        REQUIRE(wide <= inc);
+        REQUIRE(inc <= wide);
+    }
+
+    SECTION( "copy and shift" ) {
+        bound(m, 1, 2, 3);
+        m.assign_copy(2, 1, 5);  // x2 := x1 + 5
+        REQUIRE(m.get(0, 2) == 8);
+        REQUIRE(m.get(2, 0) == -7);
+        REQUIRE(m.get(1, 2) == 5);
+        REQUIRE(m.get(2, 1) == -5);
+        m.shift(2, -5);  // x2 := x2 - 5
+        REQUIRE(m.get(1, 2) == 0);
+        REQUIRE(m.get(0, 2) == 3);
+        m.copy_node(2, 3);
+        REQUIRE(m.get(0, 3) == 3);
+        REQUIRE(m.get(2, 3) == INF);
+        m.forget(1);
+        REQUIRE(m.get(0, 1) == INF);
+        REQUIRE(m.get(1, 2) == INF);
+    }
+
+    SECTION( "lattice" ) {
+        dense_dbm a(m), b(m);
+        bound(a, 1, 0, 2);
+        a.add_edge(1, 2, 0);
+        bound(b, 1, 5, 8);
+        b.add_edge(1, 2, 0);
+        dense_dbm j = a | b;
+        REQUIRE(j.get(0, 1) == 8);
+        REQUIRE(j.get(1, 0) == 0);
+        REQUIRE(j.get(1, 2) == 0);
+        REQUIRE(a <= j);
+        REQUIRE_FALSE(j <= a);
+        REQUIRE((a & b).is_bottom());
+
+        dense_dbm w = a || j;
+        REQUIRE(w.get(0, 1) == INF);
+        REQUIRE(w.get(1, 0) == 0);
+        REQUIRE(j <= w);
+        dense_dbm n = w && j;
+        REQUIRE(n.get(0, 1) == 8);
+
+        REQUIRE(j.is_closed());
+        REQUIRE_FALSE(w.is_closed());
+        REQUIRE_FALSE((w | j).is_closed());
+    }
+
+    SECTION( "nodes can be added and permuted" ) {
+        bound(m, 3, 1, 1);
+        size_t x = m.add_node();
+        size_t y = m.add_node();
+        REQUIRE(x == 4);
+        REQUIRE(m.num_nodes() == 6);
+        m.add_edge(3, y, 2);
+        REQUIRE(m.get(0, y) == 3);
+        dense_dbm p = m.permute({0, 5, -1, 3});
+        REQUIRE(p.num_nodes() == 4);
+        REQUIRE(p.get(0, 1) == 3);
+        REQUIRE(p.get(3, 1) == 2);
+        REQUIRE(p.get(0, 2) == INF);
+        REQUIRE(p.get(2, 2) == 0);
+    }
+}
@@ -2,6 +2,7 @@
 
 #include <iostream>
 
+#include "config.hpp"
 #include "ai_dom_set.hpp"
 #include "ai_dom_rcp.hpp"
 
@@ -175,6 +176,35 @@ TEST_CASE( "rcp_domain", "[dom][domain]" ) {
         }
     }
 
+    SECTION("sparse maps") {
+        auto r = top();
+        D::assume(r, TypeSet::single(3) | TypeSet::num);
+        REQUIRE(r.get_types() == (TypeSet::single(3) | TypeSet::num));
+        REQUIRE(r == D{}.with_map(3, TOP).with_num(TOP));
+
+        auto maps = D{}.with_maps(8);
+        REQUIRE(maps.get_types() == TypeSet::maps);
+        REQUIRE(maps.with_map(2, 4) != maps);
+        REQUIRE(maps + 4 == D{}.with_maps(12));
+        REQUIRE((maps.with_map(2, 4) | maps) == maps.with_map(2, OffsetDomSet(4, 8)));
+        REQUIRE((D{}.with_map(2, 4) - D{}.with_map(2, 0)).get_num() == NumDomSet(4));
+    }
+
+    SECTION("maps past 64") {
+        auto r = top();
+        D::assume(r, TypeSet::single(100) | TypeSet::num);
+        REQUIRE(r.get_types() == (TypeSet::single(100) | TypeSet::num));
+        REQUIRE(r == D{}.with_map(100, TOP).with_num(TOP));
+
+        std::vector<map_def> defs(71, map_def{ .type=MapType::HASH });
+        REQUIRE(D{}.with_fd(70).map_lookup_elem(defs) == D{}.with_num(0).with_map(70, 0));
+
+        auto maps = D{}.with_maps(8);
+        D::assume(maps, ~TypeSet::single(3));
+        REQUIRE(maps.get_types() == (TypeSet::maps & ~TypeSet::single(3)));
+        REQUIRE(maps == D{}.with_maps(8).with_map(3, {}));
+    }
+
     SECTION("other") {
         auto r1 = D{}.with_packet(14);
         auto r9 = D{}.with_packet(TOP);
@@ -207,3 +237,77 @@ TEST_CASE( "rcp_domain", "[dom][domain]" ) {
         REQUIRE(num_top + data == packet_top);
     }
 }
+
+TEST_CASE( "set_domain_widening", "[dom][domain]" ) {
+    NumDomSet n{1, 2};
+    n.widen(NumDomSet{1});
+    REQUIRE(n == NumDomSet(1, 2));
+    n.widen(NumDomSet{1, 3});
+    REQUIRE(n.is_top());
+
+    OffsetDomSet o{4};
+    o.widen(OffsetDomSet{4});
+    REQUIRE(o == OffsetDomSet(4));
+    o.widen(OffsetDomSet{4, 8});
+    REQUIRE(o.is_top());
+
+    auto r = RCP_domain{}.with_num(0).with_stack(8);
+    r.widen(RCP_domain{}.with_num(0).with_stack(12));
+    REQUIRE(r == RCP_domain{}.with_num(0).with_stack(TOP));
+}
+
+TEST_CASE( "set_domain_intervals", "[dom][domain]" ) {
+    const int old_size = global_options.max_set_size;
+    global_options.max_set_size = 4;
+
+    NumDomSet n{1, 2, 3, 4};
+    REQUIRE_FALSE(n.is_range());
+    n |= NumDomSet{9};
+    REQUIRE(n.is_range());
+    REQUIRE(n.contains(6));
+    REQUIRE_FALSE(n.contains(10));
+    REQUIRE((n | NumDomSet{0}).contains(0));
+
+    SECTION("arithmetic") {
+        REQUIRE(n + NumDomSet{10} == (NumDomSet{11} | NumDomSet{12, 13, 14, 15, 16, 17, 18, 19}));
+        REQUIRE((n - NumDomSet{2}).contains((uint64_t)-1));
+        REQUIRE((n - NumDomSet{2}).is_top());
+        REQUIRE((n & NumDomSet{2, 5, 10}) == NumDomSet(2, 5));
+        NumDomSet m = n;
+        m.exec(Bin::Op::MUL, NumDomSet{2});
+        REQUIRE(m.is_top());
+    }
+
+    SECTION("assume") {
+        NumDomSet m = n;
+        m.assume(Condition::Op::GT, NumDomSet{7});
+        REQUIRE(m == NumDomSet(8, 9));
+        m = n;
+        m.assume(Condition::Op::NE, NumDomSet{1});
+        REQUIRE_FALSE(m.contains(1));
+        REQUIRE(m.contains(2));
+        REQUIRE_FALSE(NumDomSet(0, 20).satisfied(Condition::Op::LT, n));
+        REQUIRE(n.satisfied(Condition::Op::LE, NumDomSet{9}));
+    }
+
+    SECTION("widening") {
+        NumDomSet m = n;
+        m.widen(NumDomSet{2, 5});
+        REQUIRE(m == n);
+        m.widen(NumDomSet{10});
+        REQUIRE(m.is_top());
+    }
+
+    SECTION("offsets") {
+        OffsetDomSet o{-16, -12, -8, -4, 0};
+        REQUIRE(o.is_range());
+        REQUIRE(o.contains(-10));
+        REQUIRE(o + NumDomSet{4} == (OffsetDomSet{-12, -8, -4, 0} | OffsetDomSet{4}));
+        REQUIRE(o - OffsetDomSet{-20} == (NumDomSet{4, 5, 6, 7} | NumDomSet{20}));
+        REQUIRE((o - OffsetDomSet{-4}).is_top());
+        o.assume(Condition::Op::LE, OffsetDomSet{-16});
+        REQUIRE(o == OffsetDomSet{-16});
+    }
+
+    global_options.max_set_size = old_size;
+}
@@ -0,0 +1,102 @@
+#include "catch.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "interpreter.hpp"
+
+static const program_info xdp{BpfProgType::XDP, {{0, MapType::HASH, 4, 8, 0}}, xdp_md};
+
+static std::optional<violation> find(const InstructionSeq& prog) {
+    return find_violation(prog, xdp, 100);
+}
+
+static const Call map_lookup{1, "map_lookup_elem", false, true,
+                             {{ArgSingle::Kind::MAP_FD, Reg{1}}, {ArgSingle::Kind::PTR_TO_MAP_KEY, Reg{2}}}, {}};
+
+TEST_CASE( "concrete interpreter", "[interpreter]" ) {
+    SECTION( "a correct program" ) {
+        REQUIRE_FALSE(find({
+            {"0", Mem{Deref{8, Reg{10}, -8}, Reg{1}, false}},
+            {"1", Mem{Deref{8, Reg{10}, -8}, Reg{2}, true}},
+            {"2", Mem{Deref{4, Reg{2}, 12}, Reg{0}, true}},
+            {"3", Exit{}},
+        }));
+    }
+
+    SECTION( "a stack access out of bounds" ) {
+        auto v = find({
+            {"0", Bin{Bin::Op::MOV, true, Reg{2}, Reg{10}}},
+            {"1", Bin{Bin::Op::ADD, true, Reg{2}, Imm{static_cast<uint64_t>(-520)}}},
+            {"2", Mem{Deref{8, Reg{2}, 0}, Imm{0}, false}},
+            {"3", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"4", Exit{}},
+        });
+        REQUIRE(v);
+        REQUIRE(v->label == "2");
+        REQUIRE(v->trace == std::vector<Label>{"0", "1", "2"});
+    }
+
+    SECTION( "an unchecked packet access" ) {
+        InstructionSeq prog{
+            {"0", Mem{Deref{4, Reg{1}, 0}, Reg{2}, true}},
+            {"1", Mem{Deref{4, Reg{1}, 4}, Reg{3}, true}},
+            {"2", Bin{Bin::Op::MOV, true, Reg{4}, Reg{2}}},
+            {"3", Bin{Bin::Op::ADD, true, Reg{4}, Imm{14}}},
+            {"4", Jmp{Condition{Condition::Op::GT, Reg{4}, Reg{3}}, "6"}},
+            {"5", Mem{Deref{2, Reg{2}, 12}, Reg{0}, true}},
+            {"6", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"7", Exit{}},
+        };
+        REQUIRE_FALSE(find(prog));
+
+        prog[4] = {"4", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}};
+        auto v = find(prog);
+        REQUIRE(v);
+        REQUIRE(v->label == "5");
+    }
+
+    SECTION( "a map lookup result is dereferenced without a null check" ) {
+        InstructionSeq prog{
+            {"0", Mem{Deref{4, Reg{10}, -4}, Imm{0}, false}},
+            {"1", LoadMapFd{Reg{1}, 0}},
+            {"2", Bin{Bin::Op::MOV, true, Reg{2}, Reg{10}}},
+            {"3", Bin{Bin::Op::ADD, true, Reg{2}, Imm{static_cast<uint64_t>(-4)}}},
+            {"4", map_lookup},
+            {"5", Jmp{Condition{Condition::Op::EQ, Reg{0}, Imm{0}}, "7"}},
+            {"6", Mem{Deref{8, Reg{0}, 0}, Reg{1}, true}},
+            {"7", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"8", Exit{}},
+        };
+        REQUIRE_FALSE(find(prog));
+
+        prog[5] = {"5", Bin{Bin::Op::MOV, true, Reg{3}, Imm{0}}};
+        auto v = find(prog);
+        REQUIRE(v);
+        REQUIRE(v->label == "6");
+        REQUIRE(v->trace == std::vector<Label>{"0", "1", "2", "3", "4", "5", "6"});
+    }
+
+    SECTION( "a register scratched by a call" ) {
+        auto v = find({
+            {"0", Mem{Deref{4, Reg{10}, -4}, Imm{0}, false}},
+            {"1", LoadMapFd{Reg{1}, 0}},
+            {"2", Bin{Bin::Op::MOV, true, Reg{2}, Reg{10}}},
+            {"3", Bin{Bin::Op::ADD, true, Reg{2}, Imm{static_cast<uint64_t>(-4)}}},
+            {"4", map_lookup},
+            {"5", Bin{Bin::Op::MOV, true, Reg{0}, Reg{2}}},
+            {"6", Exit{}},
+        });
+        REQUIRE(v);
+        REQUIRE(v->label == "5");
+        REQUIRE(v->message == "r2 is uninitialized");
+    }
+
+    SECTION( "runs that leave the model give no verdict" ) {
+        // An unbounded loop runs out of steps
+        REQUIRE_FALSE(find_violation({
+            {"0", Jmp{{}, "0"}},
+        }, xdp, 3, 0, 1000));
+    }
+}
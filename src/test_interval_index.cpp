@@ -0,0 +1,114 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "interval_index.hpp"
+
+using index_t = interval_index<int>;
+
+static std::vector<int> overlapping(const index_t& index, uint64_t lb, uint64_t ub) {
+    std::vector<int> res;
+    index.overlaps(lb, ub, [&](int v) { res.push_back(v); });
+    return res;
+}
+
+TEST_CASE( "interval index", "[index]" ) {
+    index_t index;
+    REQUIRE(index.empty());
+    index.insert(0, 7, 1);
+    index.insert(8, 11, 2);
+    index.insert(8, 15, 3);
+    index.insert(16, 16, 4);
+    index.insert(100, 107, 5);
+    REQUIRE(index.size() == 5);
+
+    SECTION( "overlap queries" ) {
+        REQUIRE(overlapping(index, 4, 4) == std::vector<int>{1});
+        REQUIRE(overlapping(index, 7, 8) == std::vector<int>{1, 2, 3});
+        REQUIRE(overlapping(index, 12, 16) == std::vector<int>{3, 4});
+        REQUIRE(overlapping(index, 17, 99).empty());
+        REQUIRE(overlapping(index, 0, UINT64_MAX).size() == 5);
+    }
+
+    SECTION( "update and erase" ) {
+        index.insert(8, 11, 6);
+        REQUIRE(index.size() == 5);
+        REQUIRE(*index.find(8, 11) == 6);
+        REQUIRE(index.erase(8, 15));
+        REQUIRE_FALSE(index.erase(8, 15));
+        REQUIRE(index.find(8, 15) == nullptr);
+        REQUIRE(overlapping(index, 9, 20) == std::vector<int>{6, 4});
+    }
+
+    SECTION( "copies are independent" ) {
+        index_t copy = index;
+        copy.erase(0, 7);
+        copy.insert(200, 203, 7);
+        REQUIRE(overlapping(index, 0, 300) == std::vector<int>{1, 2, 3, 4, 5});
+        REQUIRE(overlapping(copy, 0, 300) == std::vector<int>{2, 3, 4, 5, 7});
+    }
+
+    SECTION( "union and intersection" ) {
+        index_t other;
+        other.insert(8, 11, 2);
+        other.insert(16, 16, 4);
+        other.insert(200, 203, 6);
+
+        index_t u = index;
+        u.unite(other);
+        REQUIRE(u.size() == 6);
+        REQUIRE(overlapping(u, 0, 300) == std::vector<int>{1, 2, 3, 4, 5, 6});
+        index_t v = other;
+        v.unite(index);
+        REQUIRE(overlapping(v, 0, 300) == overlapping(u, 0, 300));
+
+        index_t i = index;
+        i.intersect(other);
+        REQUIRE(i.size() == 2);
+        REQUIRE(overlapping(i, 0, 300) == std::vector<int>{2, 4});
+        index_t j = other;
+        j.intersect(index);
+        REQUIRE(overlapping(j, 0, 300) == std::vector<int>{2, 4});
+        REQUIRE(overlapping(index, 0, 300) == std::vector<int>{1, 2, 3, 4, 5});
+
+        i.intersect(i);
+        u.unite(u);
+        REQUIRE(i.size() == 2);
+        REQUIRE(u.size() == 6);
+    }
+}
+
+TEST_CASE( "interval index agrees with a linear scan", "[index]" ) {
+    std::mt19937_64 rng(42);
+    index_t index;
+    std::vector<std::tuple<uint64_t, uint64_t, int>> all;
+    for (int i = 0; i < 2000; i++) {
+        uint64_t lb = rng() % 4096;
+        uint64_t ub = lb + rng() % 16;
+        if (rng() % 4 == 0 && !all.empty()) {
+            auto [elb, eub, v] = all[rng() % all.size()];
+            index.erase(elb, eub);
+            all.erase(std::find(all.begin(), all.end(), std::make_tuple(elb, eub, v)));
+            continue;
+        }
+        if (index.find(lb, ub))
+            continue;
+        index.insert(lb, ub, i);
+        all.emplace_back(lb, ub, i);
+    }
+    REQUIRE(index.size() == all.size());
+    std::sort(all.begin(), all.end());
+    for (int q = 0; q < 200; q++) {
+        uint64_t lb = rng() % 4200;
+        uint64_t ub = lb + rng() % 64;
+        std::vector<int> expected;
+        for (auto [clb, cub, v] : all) {
+            if (clb <= ub && cub >= lb)
+                expected.push_back(v);
+        }
+        REQUIRE(overlapping(index, lb, ub) == expected);
+    }
+}
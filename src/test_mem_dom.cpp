@@ -385,3 +385,64 @@ TEST_CASE( "m_dom_two_writes", "[dom][domain][m]" ) {
         }
     }
 }
+
+TEST_CASE( "mem_dom_widen", "[dom][domain][mem]" ) {
+    const RCP_domain n1 = RCP_domain{}.with_num(1);
+    const RCP_domain n2 = RCP_domain{}.with_num(2);
+    const RCP_domain s8 = RCP_domain{}.with_stack(8);
+
+    D m = mem({{0, 8, n1}, {8, 8, s8}});
+    D stable = m;
+    stable.widen(m);
+    REQUIRE(stable == m);
+
+    D grown = m;
+    grown.widen(mem({{0, 8, n2}, {8, 8, s8}}));
+    REQUIRE(grown == mem({{0, 8, NT}, {8, 8, s8}}));
+
+    D b = bot();
+    b.widen(m);
+    REQUIRE(b == m);
+}
+
+TEST_CASE( "mem_dom_copies_share_cells", "[dom][domain][mem]" ) {
+    D m = mem(D::Cell{0, 4, NT}, D::Cell{8, 4, T});
+    D copy = m;
+    REQUIRE(&copy.cells() == &m.cells());
+
+    copy.store(4, 4, NT);
+    REQUIRE(&copy.cells() != &m.cells());
+    REQUIRE(m == mem(D::Cell{0, 4, NT}, D::Cell{8, 4, T}));
+    REQUIRE(copy.cells().size() == 3);
+
+    D joined = m;
+    joined |= m;
+    REQUIRE(&joined.cells() == &m.cells());
+}
+
+TEST_CASE( "mem_dom_meet", "[dom][domain][mem]" ) {
+    const RCP_domain n1 = RCP_domain{}.with_num(1);
+    const RCP_domain n12 = RCP_domain{}.with_num(NumDomSet(1, 2));
+    const RCP_domain s8 = RCP_domain{}.with_stack(8);
+
+    REQUIRE((mem({{0, 8, n12}}) & mem({{8, 8, s8}})) == mem({{0, 8, n12}, {8, 8, s8}}));
+    REQUIRE((mem({{0, 8, n12}}) & mem({{0, 8, n1}})) == mem({{0, 8, n1}}));
+    REQUIRE((mem({{0, 8, n1}}) & mem({{0, 8, s8}})).is_bot());
+    REQUIRE((mem({{0, 8, n1}}) & mem({{4, 8, s8}, {16, 4, n1}})) == mem({{0, 8, n1}, {16, 4, n1}}));
+    REQUIRE((mem({{0, 8, n1}}) & top()) == mem({{0, 8, n1}}));
+}
+
+TEST_CASE( "mem_dom_many_cells", "[dom][domain][mem]" ) {
+    D m;
+    for (int64_t offset = 0; offset < STACK_SIZE; offset += 4)
+        m.store({offset}, 4, RCP_domain{}.with_num(offset));
+    REQUIRE(m.cells().size() == STACK_SIZE / 4);
+    m.store({6}, 4, T);
+    REQUIRE(m.cells().size() == STACK_SIZE / 4 + 1);
+    REQUIRE(m.load({4}, 2) == NT);
+    REQUIRE(m.load({6}, 4) == T);
+    REQUIRE(m.load({10}, 2) == NT);
+    for (int64_t offset = 12; offset < STACK_SIZE; offset += 4)
+        REQUIRE(m.load({offset}, 4) == RCP_domain{}.with_num(offset));
+    REQUIRE(m.load({12}, 8) == NT);
+}
@@ -0,0 +1,51 @@
+#include "catch.hpp"
+
+#include <sstream>
+
+#include "packing.hpp"
+
+using packs_t = std::vector<std::vector<variable_packing::var_id>>;
+
+TEST_CASE( "variable packing", "[packing]" ) {
+    variable_packing packing;
+
+    SECTION( "co-occurring variables share a pack" ) {
+        packing.add_occurrence({1, 2});
+        packing.add_occurrence({2, 3});
+        packing.add_occurrence({4, 5});
+        packing.add_occurrence({6});
+        packing.build(8);
+        REQUIRE(packing.get_packs() == packs_t{{1, 2, 3}, {4, 5}});
+        REQUIRE(packing.pack_of(3) == packing.pack_of(1));
+        REQUIRE(packing.pack_of(4) != packing.pack_of(1));
+        REQUIRE_FALSE(packing.pack_of(6));
+        REQUIRE_FALSE(packing.pack_of(7));
+    }
+
+    SECTION( "frequent pairs are merged first" ) {
+        packing.add_occurrence({1, 2});
+        packing.add_occurrence({3, 4});
+        packing.add_occurrence({3, 4});
+        packing.add_occurrence({2, 3});
+        packing.add_occurrence({2, 3});
+        packing.add_occurrence({2, 3});
+        packing.build(2);
+        REQUIRE(packing.get_packs() == packs_t{{2, 3}});
+        packing.build(3);
+        REQUIRE(packing.get_packs() == packs_t{{2, 3, 4}});
+        packing.build(4);
+        REQUIRE(packing.get_packs() == packs_t{{1, 2, 3, 4}});
+    }
+
+    SECTION( "statistics" ) {
+        packing.add_occurrence({1, 2, 3});
+        packing.add_occurrence({4, 5});
+        packing.add_occurrence({6});
+        packing.build(8);
+        std::ostringstream os;
+        packing.write_stats(os);
+        REQUIRE(os.str() == "packs: 2 packs of 5/6 variables, max size 3, mean size 2.50, sizes 2x1 3x1\n");
+        packing.clear();
+        REQUIRE(packing.get_packs().empty());
+    }
+}
@@ -0,0 +1,49 @@
+#include "catch.hpp"
+
+#include <sstream>
+
+#include "fixpoint_profile.hpp"
+
+TEST_CASE( "fixpoint profile reports", "[profile]" ) {
+    block_profile head{.visits = 3, .widenings = 1, .narrowings = 1, .transfer_time = 0.002, .join_time = 0.001};
+    block_profile body{.visits = 3, .transfer_time = 0.004};
+    block_profile body_exit{.visits = 3, .join_time = 0.0005};
+    std::vector<profile_entry> entries{
+        {"2", 2, 0, "assume", {}, head},
+        {"2:1", 2, 1, "load", {"2"}, body},
+        {"2:1:exit", 2, 1, "load", {"2"}, body_exit},
+        {"7", 7, 0, "other", {}, block_profile{.visits = 1}},
+    };
+
+    SECTION( "json aggregates per instruction and kind" ) {
+        std::ostringstream os;
+        write_profile_json(os, entries);
+        std::string json = os.str();
+        REQUIRE(json.find("{\"block\": \"2:1:exit\", \"pc\": 2, \"visits\": 3") != std::string::npos);
+        REQUIRE(json.find("{\"pc\": 2, \"index\": 1, \"kind\": \"load\", \"visits\": 6, \"widenings\": 0, "
+                          "\"narrowings\": 0, \"transfer_sec\": 0.004000, \"join_sec\": 0.000500}") != std::string::npos);
+        REQUIRE(json.find("\"assume\": {\"visits\": 3, \"widenings\": 1, \"narrowings\": 1") != std::string::npos);
+    }
+
+    SECTION( "folded stacks nest blocks in their loops" ) {
+        std::ostringstream os;
+        write_profile_folded(os, entries);
+        REQUIRE(os.str() ==
+                "program;2/0 assume;2 3000\n"
+                "program;loop 2;2/1 load;2:1 4000\n"
+                "program;loop 2;2/1 load;2:1:exit 500\n");
+    }
+}
+
+TEST_CASE( "fixpoint profile reports widening delays", "[profile]" ) {
+    std::vector<profile_entry> entries{
+        {"2", 2, 0, "assume", {}, block_profile{.visits = 5, .widenings = 1, .delays = 2}},
+        {"2:1", 2, 1, "load", {"2"}, block_profile{.visits = 5}},
+    };
+    std::ostringstream os;
+    write_profile_json(os, entries);
+    std::string json = os.str();
+    REQUIRE(json.find("{\"block\": \"2\", \"pc\": 2, \"visits\": 5, \"widenings\": 1, \"narrowings\": 0, "
+                      "\"transfer_sec\": 0.000000, \"join_sec\": 0.000000, \"delays\": 2}") != std::string::npos);
+    REQUIRE(json.find("\"join_sec\": 0.000000}") != std::string::npos);
+}
@@ -0,0 +1,26 @@
+#include "catch.hpp"
+
+#include "ai.hpp"
+#include "asm_cfg.hpp"
+
+// Count down r1 from 100 with the stored value in a stack slot, then
+// return what is left in the slot.
+static bool verify_loop(Reg stored) {
+    Cfg cfg = Cfg::make({
+        {"0", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+        {"1", Bin{Bin::Op::MOV, true, Reg{1}, Imm{100}}},
+        {"2", Mem{Deref{8, Reg{10}, -8}, stored, false}},
+        {"3", Bin{Bin::Op::SUB, true, Reg{1}, Imm{1}}},
+        {"4", Jmp{Condition{Condition::Op::NE, Reg{1}, Imm{0}}, "2"}},
+        {"5", Mem{Deref{8, Reg{10}, -8}, Reg{0}, true}},
+        {"6", Exit{}},
+    });
+    program_info info{BpfProgType::XDP, {}, xdp_md};
+    Cfg nondet = cfg.to_nondet(false);
+    return std::get<0>(rcp_validate(nondet, info));
+}
+
+TEST_CASE( "rcp analysis of a loop", "[rcp]" ) {
+    REQUIRE(verify_loop(Reg{0}));
+    REQUIRE_FALSE(verify_loop(Reg{10}));
+}
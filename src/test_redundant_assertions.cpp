@@ -0,0 +1,86 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "redundant_assertions.hpp"
+
+static const program_info info{BpfProgType::XDP, {}, xdp_md};
+
+static size_t count_assertions(const Cfg& cfg) {
+    size_t res = 0;
+    for (const Label& l : cfg.keys()) {
+        for (const Instruction& ins : cfg.at(l).insts)
+            res += std::holds_alternative<Assert>(ins);
+    }
+    return res;
+}
+
+// The number of removed assertions of each label
+static std::map<Label, int> removed(Cfg& cfg) {
+    std::map<Label, int> res;
+    for (const redundant_assertion& r : remove_redundant_assertions(cfg)) {
+        const auto& by = cfg.at(r.implied_by).insts;
+        REQUIRE(std::any_of(by.begin(), by.end(), [](const Instruction& ins) { return std::holds_alternative<Assert>(ins); }));
+        res[r.label]++;
+    }
+    return res;
+}
+
+static Cfg explicated(const InstructionSeq& prog) {
+    Cfg cfg = Cfg::make(prog).to_nondet(false);
+    explicate_assertions(cfg, info);
+    return cfg;
+}
+
+static Instruction load(Reg dst, Reg base, int offset, int width) {
+    return Mem{Deref{width, base, offset}, dst, true};
+}
+
+TEST_CASE( "redundant assertions", "[assertions]" ) {
+    SECTION( "accesses within a checked stack access" ) {
+        Cfg cfg = explicated({
+            {"0", load(Reg{2}, Reg{10}, -8, 8)},
+            {"1", load(Reg{3}, Reg{10}, -8, 8)},
+            {"2", load(Reg{0}, Reg{10}, -4, 4)},
+            {"3", load(Reg{0}, Reg{10}, -12, 4)},
+            {"4", Exit{}},
+        });
+        size_t before = count_assertions(cfg);
+        auto r = removed(cfg);
+        REQUIRE(r == std::map<Label, int>{{"1", 2}, {"2", 2}, {"3", 1}});
+        REQUIRE(count_assertions(cfg) == before - 5);
+    }
+
+    SECTION( "an assertion on every path but not before the join" ) {
+        InstructionSeq prog{
+            {"0", Bin{Bin::Op::MOV, true, Reg{2}, Reg{1}}},
+            {"1", load(Reg{3}, Reg{2}, 0, 4)},
+            {"2", Jmp{Condition{Condition::Op::EQ, Reg{3}, Imm{0}}, "4"}},
+            {"3", Bin{Bin::Op::MOV, true, Reg{5}, Imm{1}}},
+            {"4", load(Reg{4}, Reg{2}, 0, 4)},
+            {"5", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"6", Exit{}},
+        };
+        Cfg cfg = explicated(prog);
+        // The two loads have the same checks, exit has one more
+        int checks = (count_assertions(cfg) - 1) / 2;
+        REQUIRE(removed(cfg) == std::map<Label, int>{{"4", checks}});
+
+        // Redefine the base on one path
+        prog[3] = {"3", Bin{Bin::Op::MOV, true, Reg{2}, Reg{10}}};
+        cfg = explicated(prog);
+        REQUIRE(removed(cfg).empty());
+    }
+
+    SECTION( "calls scratch the checked registers" ) {
+        Cfg cfg = explicated({
+            {"0", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"1", Call{1, "f", false, false, {{ArgSingle::Kind::ANYTHING, Reg{1}}}, {}}},
+            {"2", Call{1, "f", false, false, {{ArgSingle::Kind::ANYTHING, Reg{1}}}, {}}},
+            {"3", Exit{}},
+        });
+        REQUIRE(removed(cfg).empty());
+    }
+}
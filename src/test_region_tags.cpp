@@ -0,0 +1,58 @@
+#include "catch.hpp"
+
+#include <sstream>
+
+#include "region_tags.hpp"
+
+static std::string str(const tag_set& s) {
+    std::ostringstream os;
+    os << s;
+    return os.str();
+}
+
+TEST_CASE( "region tag sets", "[tags]" ) {
+    tag_set num = tag_set::singleton(-5);
+    tag_set ctx = tag_set::singleton(-3);
+    tag_set map4 = tag_set::singleton(4);
+
+    SECTION( "lattice" ) {
+        REQUIRE(tag_set::bottom().is_bottom());
+        REQUIRE(num <= (num | ctx));
+        REQUIRE_FALSE((num | ctx) <= num);
+        REQUIRE(((num | ctx) & (ctx | map4)) == ctx);
+        REQUIRE((num | map4) <= tag_set::top());
+        REQUIRE_FALSE(tag_set::top() <= (num | map4));
+        REQUIRE((tag_set::top() & map4) == map4);
+        REQUIRE(str(num | ctx | map4) == "{T_NUM,T_CTX,T_SHARED(4)}");
+    }
+
+    SECTION( "region checks are range restrictions" ) {
+        tag_set any = tag_set::range(-6, 0) | map4;
+        // is_pointer: t >= T_CTX
+        REQUIRE(str(any.restrict(-3, {})) == "{T_CTX,T_STACK,T_DATA,T_SHARED,T_SHARED(4)}");
+        // is_shared: t > T_SHARED
+        REQUIRE(any.restrict(1, {}) == map4);
+        REQUIRE(any.restrict({}, -6) == tag_set::singleton(-6));
+        REQUIRE(any.remove(-5).size() == any.size() - 1);
+        REQUIRE(tag_set::top().restrict(-5, -3) == tag_set::range(-5, -3));
+    }
+
+    SECTION( "bounds and singletons" ) {
+        tag_set s = num | map4;
+        REQUIRE(s.min() == -5);
+        REQUIRE(s.max() == 4);
+        REQUIRE_FALSE(s.singleton_value());
+        REQUIRE(*ctx.singleton_value() == -3);
+    }
+
+    SECTION( "unrepresentable sets are top" ) {
+        REQUIRE(tag_set::singleton(-7).is_top());
+        REQUIRE(tag_set::range(1, 1000).is_top());
+        tag_set sizes;
+        for (int64_t v = 1; v <= (int64_t)tag_set::MAX_SIZES; v++)
+            sizes.insert(v * 8);
+        REQUIRE_FALSE(sizes.is_top());
+        sizes.insert(1000);
+        REQUIRE(sizes.is_top());
+    }
+}
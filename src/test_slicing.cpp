@@ -0,0 +1,97 @@
+#include "catch.hpp"
+
+#include <vector>
+
+#include "spec_assertions.hpp"
+#include "slicing.hpp"
+
+using criteria_t = std::vector<slice_criterion>;
+
+static Cfg nondet(const InstructionSeq& prog) {
+    return Cfg::make(prog).to_nondet(false);
+}
+
+static size_t size(const Cfg& cfg, const Label& l) { return cfg.at(l).insts.size(); }
+
+TEST_CASE( "slicing", "[slicing]" ) {
+    SECTION( "a stack access keeps the computation of its address" ) {
+        Cfg cfg = nondet({
+            {"0", Bin{Bin::Op::MOV, true, Reg{2}, Reg{10}}},
+            {"1", Bin{Bin::Op::ADD, true, Reg{2}, Imm{static_cast<uint64_t>(-8)}}},
+            {"2", Bin{Bin::Op::MOV, true, Reg{3}, Imm{1}}},
+            {"3", Mem{Deref{8, Reg{10}, -16}, Reg{3}, false}},
+            {"4", Mem{Deref{8, Reg{2}, 0}, Reg{4}, true}},
+            {"5", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"6", Exit{}},
+        });
+        REQUIRE(slice(cfg, {{"4", 0}}) == 4);
+        REQUIRE(size(cfg, "0") == 1);
+        REQUIRE(size(cfg, "1") == 1);
+        REQUIRE(size(cfg, "2") == 0);
+        REQUIRE(size(cfg, "3") == 0);
+        REQUIRE(size(cfg, "4") == 1);
+        REQUIRE(size(cfg, "6") == 0);
+    }
+
+    SECTION( "values flow through the stack" ) {
+        Cfg cfg = nondet({
+            {"0", Mem{Deref{8, Reg{10}, -8}, Reg{1}, false}},
+            {"1", Mem{Deref{8, Reg{10}, -16}, Reg{1}, false}},
+            {"2", Mem{Deref{8, Reg{10}, -8}, Reg{0}, true}},
+            {"3", Exit{}},
+        });
+        REQUIRE(slice(cfg, {{"3", 0}}) == 1);
+        REQUIRE(size(cfg, "1") == 0);
+    }
+
+    SECTION( "a criterion load keeps the store it reads if its result is used" ) {
+        InstructionSeq prog{
+            {"0", Mem{Deref{8, Reg{10}, -8}, Reg{1}, false}},
+            {"1", Mem{Deref{8, Reg{10}, -8}, Reg{2}, true}},
+            {"2", Mem{Deref{4, Reg{2}, 0}, Reg{3}, true}},
+            {"3", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"4", Exit{}},
+        };
+        Cfg cfg = nondet(prog);
+        REQUIRE(slice(cfg, {{"1", 0}, {"2", 0}}) == 2);
+        REQUIRE(size(cfg, "0") == 1);
+        REQUIRE(size(cfg, "1") == 1);
+        REQUIRE(size(cfg, "2") == 1);
+
+        cfg = nondet(prog);
+        REQUIRE(slice(cfg, {{"1", 0}}) == 4);
+        REQUIRE(size(cfg, "0") == 0);
+        REQUIRE(size(cfg, "1") == 1);
+    }
+
+    SECTION( "branches that decide a relevant value are kept" ) {
+        Cfg cfg = nondet({
+            {"0", Mem{Deref{4, Reg{1}, 0}, Reg{3}, true}},
+            {"1", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"2", Jmp{Condition{Condition::Op::EQ, Reg{3}, Imm{0}}, "4"}},
+            {"3", Bin{Bin::Op::MOV, true, Reg{0}, Imm{1}}},
+            {"4", Exit{}},
+        });
+        REQUIRE(slice(cfg, {{"4", 0}}) == 1);
+        REQUIRE(size(cfg, "0") == 1);
+        REQUIRE(size(cfg, "2:3") == 1);
+        REQUIRE(size(cfg, "2:4") == 0);
+    }
+
+    SECTION( "the criteria are the instructions with unproven assertions" ) {
+        Cfg cfg = nondet({
+            {"0", Bin{Bin::Op::MOV, true, Reg{2}, Reg{10}}},
+            {"1", Mem{Deref{8, Reg{2}, -8}, Reg{4}, true}},
+            {"2", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"3", Exit{}},
+        });
+        explicate_assertions(cfg, program_info{BpfProgType::XDP, {}, xdp_md});
+        for (const Label& l : cfg.keys()) {
+            for (Instruction& ins : cfg[l].insts) {
+                if (std::holds_alternative<Assert>(ins))
+                    std::get<Assert>(ins).satisfied = l != "1";
+            }
+        }
+        REQUIRE(unproven_instructions(cfg) == criteria_t{{"1", 0}});
+    }
+}
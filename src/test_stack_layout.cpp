@@ -0,0 +1,104 @@
+#include "catch.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "stack_layout.hpp"
+
+using cells_t = std::vector<std::pair<int, int>>;
+
+static cells_t cells(const stack_layout& l) {
+    cells_t res;
+    l.for_each_cell([&](int o, int w) { res.emplace_back(o, w); });
+    return res;
+}
+
+static const stack_layout::tag_bits NUM = stack_layout::tag_range(-5, -5);
+static const stack_layout::tag_bits CTX = stack_layout::tag_range(-3, -3);
+
+TEST_CASE( "stack layout cells", "[stack]" ) {
+    stack_layout l;
+    REQUIRE(l.is_top());
+    l.add_cell(8, 8);
+    l.add_cell(16, 4);
+    REQUIRE(l.cell_at(8) == 8);
+    REQUIRE(l.cell_at(12) == 0);
+    REQUIRE(l.overlaps(15, 16));
+    REQUIRE_FALSE(l.overlaps(20, 24));
+    REQUIRE_FALSE(l.overlaps(0, 8));
+
+    cells_t removed;
+    l.remove_cells(12, 18, [&](int o, int w) { removed.emplace_back(o, w); });
+    REQUIRE(removed == cells_t{{8, 8}, {16, 4}});
+    REQUIRE(l.is_top());
+
+    l.add_cell(stack_layout::SIZE - 8, 8);
+    REQUIRE(l.overlaps(stack_layout::SIZE - 1, stack_layout::SIZE));
+}
+
+TEST_CASE( "stack layout tags", "[stack]" ) {
+    REQUIRE(stack_layout::tag_range(-6, 0) == 0x7f);
+    REQUIRE(stack_layout::tag_range(-3, 1) == 0);
+    REQUIRE(stack_layout::min_tag(NUM | CTX) == -5);
+    REQUIRE(stack_layout::max_tag(NUM | CTX) == -3);
+
+    stack_layout l;
+    l.set_tags(0, 8, CTX);
+    REQUIRE(l.tags_in(0, 8) == CTX);
+    REQUIRE(l.tags_in(4, 12) == 0);
+    l.weaken_tags(4, 12, NUM);
+    REQUIRE(l.tags_at(3) == CTX);
+    REQUIRE(l.tags_at(4) == (CTX | NUM));
+    REQUIRE(l.tags_at(8) == 0);
+    l.add_cell(0, 1);
+    REQUIRE(l.tags_at(0) == 0);
+}
+
+TEST_CASE( "stack layout lattice", "[stack]" ) {
+    stack_layout a, b;
+    a.add_cell(0, 8);
+    a.add_cell(8, 4);
+    a.set_tags(100, 108, NUM);
+    a.set_tags(300, 301, CTX);
+    b.add_cell(0, 8);
+    b.add_cell(8, 8);
+    b.set_tags(100, 104, NUM | CTX);
+
+    SECTION( "join" ) {
+        stack_layout j = a | b;
+        REQUIRE(cells(j) == cells_t{{0, 8}});
+        REQUIRE(j.tags_in(100, 104) == (NUM | CTX));
+        REQUIRE(j.tags_at(104) == 0);
+        REQUIRE(j.tags_at(300) == 0);
+        REQUIRE(a <= j);
+        REQUIRE(b <= j);
+        REQUIRE_FALSE(j <= a);
+    }
+
+    SECTION( "meet" ) {
+        auto m = meet(a, b);
+        REQUIRE(m);
+        REQUIRE(cells(*m) == cells(a));
+        REQUIRE(m->tags_in(100, 108) == NUM);
+        REQUIRE(m->tags_at(300) == CTX);
+        REQUIRE(*m <= a);
+        stack_layout c;
+        c.set_tags(300, 301, NUM);
+        c.add_cell(200, 2);
+        REQUIRE_FALSE(meet(a, c));
+        m = meet(b, c);
+        REQUIRE(cells(*m) == cells_t{{0, 8}, {8, 8}, {200, 2}});
+        REQUIRE(m->tags_at(300) == NUM);
+    }
+
+    SECTION( "last bytes" ) {
+        stack_layout x, y;
+        x.set_tags(stack_layout::SIZE - 3, stack_layout::SIZE, NUM);
+        y.set_tags(stack_layout::SIZE - 2, stack_layout::SIZE, CTX);
+        stack_layout j = x | y;
+        REQUIRE(j.tags_at(stack_layout::SIZE - 3) == 0);
+        REQUIRE(j.tags_at(stack_layout::SIZE - 1) == (NUM | CTX));
+        REQUIRE_FALSE(y <= x);
+        REQUIRE(x <= j);
+    }
+}
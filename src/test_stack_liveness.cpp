@@ -0,0 +1,64 @@
+#include "catch.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "stack_liveness.hpp"
+
+using ranges_t = std::vector<std::pair<int, int>>;
+
+static Instruction store(int offset, int width, uint8_t base = 10) {
+    return Mem{Deref{width, Reg{base}, offset}, Reg{1}, false};
+}
+
+static Instruction load(int offset, int width, uint8_t base = 10) {
+    return Mem{Deref{width, Reg{base}, offset}, Reg{0}, true};
+}
+
+TEST_CASE( "stack liveness", "[liveness]" ) {
+    SECTION( "scratch slots" ) {
+        Cfg cfg = Cfg::make({
+            {"0", store(-8, 8)},
+            {"1", load(-8, 8)},
+            {"2", store(-16, 8)},
+            {"3", Jmp{Condition{Condition::Op::EQ, Reg{0}, Imm{0}}, "6"}},
+            {"4", load(-12, 4)},
+            {"5", Exit{}},
+            {"6", Exit{}},
+        });
+        stack_liveness live(cfg);
+        REQUIRE(live.live_at("1") == stack_liveness::bytes{0xff});
+        REQUIRE(live.dead_ranges("1").empty());
+        REQUIRE(live.dead_ranges("2") == ranges_t{{0, 8}});
+        REQUIRE(live.dead_ranges("3") == ranges_t{{12, 16}});
+        REQUIRE(live.live_at("4").count() == 4);
+        REQUIRE(live.dead_ranges("4").empty());
+        REQUIRE(live.dead_ranges("5") == ranges_t{{8, 12}});
+        REQUIRE(live.dead_ranges("6") == ranges_t{{8, 12}});
+    }
+
+    SECTION( "loads through other registers read everything" ) {
+        Cfg cfg = Cfg::make({
+            {"0", store(-8, 8)},
+            {"1", store(-16, 8)},
+            {"2", load(0, 8, 1)},
+            {"3", Exit{}},
+        });
+        stack_liveness live(cfg);
+        REQUIRE(live.live_at("2").all());
+        REQUIRE(live.dead_ranges("2").empty());
+        REQUIRE(live.dead_ranges("3") == ranges_t{{0, 16}});
+    }
+
+    SECTION( "a partial store keeps the rest live" ) {
+        Cfg cfg = Cfg::make({
+            {"0", store(-8, 8)},
+            {"1", store(-8, 4)},
+            {"2", load(-8, 8)},
+            {"3", Exit{}},
+        });
+        stack_liveness live(cfg);
+        REQUIRE(live.live_at("1") == stack_liveness::bytes{0x0f});
+        REQUIRE(live.dead_ranges("1") == ranges_t{{4, 8}});
+    }
+}
@@ -0,0 +1,91 @@
+#include "catch.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "syntactic_check.hpp"
+
+using errors_t = std::vector<std::pair<Label, std::string>>;
+
+static errors_t errors(const InstructionSeq& prog) {
+    errors_t res;
+    for (const syntactic_error& e : syntactic_errors(Cfg::make(prog)))
+        res.emplace_back(e.label, e.message);
+    return res;
+}
+
+TEST_CASE( "syntactic check", "[precheck]" ) {
+    SECTION( "a correct program" ) {
+        REQUIRE(errors({
+            {"0", Bin{Bin::Op::MOV, true, Reg{2}, Reg{10}}},
+            {"1", Mem{Deref{8, Reg{10}, -8}, Reg{1}, false}},
+            {"2", Mem{Deref{4, Reg{10}, -512}, Reg{0}, true}},
+            {"3", Exit{}},
+        }).empty());
+    }
+
+    SECTION( "uninitialized registers" ) {
+        REQUIRE(errors({
+            {"0", Bin{Bin::Op::ADD, true, Reg{2}, Imm{1}}},
+            {"1", Jmp{Condition{Condition::Op::EQ, Reg{1}, Reg{3}}, "3"}},
+            {"2", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"3", Exit{}},
+        }) == errors_t{
+            {"0", "r2 is read before it is written"},
+            {"1", "r3 is read before it is written"},
+        });
+    }
+
+    SECTION( "r0 is only set on some paths" ) {
+        REQUIRE(errors({
+            {"0", Jmp{Condition{Condition::Op::EQ, Reg{1}, Imm{0}}, "2"}},
+            {"1", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"2", Exit{}},
+        }).empty());
+        REQUIRE(errors({
+            {"0", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"1", Call{1, "f", false, false, {}, {}}},
+            {"2", Bin{Bin::Op::MOV, true, Reg{1}, Reg{2}}},
+            {"3", Exit{}},
+        }) == errors_t{{"2", "r2 is read before it is written"}});
+    }
+
+    SECTION( "stack pointer" ) {
+        REQUIRE(errors({
+            {"0", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"1", Mem{Deref{8, Reg{10}, -4}, Reg{0}, false}},
+            {"2", Mem{Deref{8, Reg{10}, -520}, Reg{0}, false}},
+            {"3", Bin{Bin::Op::ADD, true, Reg{10}, Imm{8}}},
+            {"4", Exit{}},
+        }) == errors_t{
+            {"1", "stack access at r10-4 of width 8 is out of bounds"},
+            {"2", "stack access at r10-520 of width 8 is out of bounds"},
+            {"3", "r10 is read-only"},
+        });
+    }
+
+    SECTION( "unreachable blocks are not checked" ) {
+        REQUIRE(errors({
+            {"0", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"1", Jmp{{}, "3"}},
+            {"2", Bin{Bin::Op::ADD, true, Reg{0}, Reg{7}}},
+            {"3", Exit{}},
+        }).empty());
+    }
+
+    SECTION( "branches on constants follow the edge they take" ) {
+        InstructionSeq prog{
+            {"0", Bin{Bin::Op::MOV, true, Reg{0}, Imm{0}}},
+            {"1", Bin{Bin::Op::MOV, true, Reg{2}, Imm{1}}},
+            {"2", Bin{Bin::Op::ADD, true, Reg{2}, Imm{1}}},
+            {"3", Jmp{Condition{Condition::Op::EQ, Reg{2}, Imm{2}}, "5"}},
+            {"4", Bin{Bin::Op::ADD, true, Reg{0}, Reg{7}}},
+            {"5", Exit{}},
+        };
+        REQUIRE(errors(prog).empty());
+
+        prog[3] = {"3", Jmp{Condition{Condition::Op::EQ, Reg{2}, Reg{1}}, "5"}};
+        REQUIRE(errors(prog) == errors_t{{"4", "r7 is read before it is written"}});
+    }
+}
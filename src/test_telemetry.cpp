@@ -0,0 +1,50 @@
+#include "catch.hpp"
+
+#include <sstream>
+
+#include "state_telemetry.hpp"
+
+TEST_CASE( "state telemetry", "[telemetry]" ) {
+    state_telemetry t;
+    t.record("0", {2, 1, 0});
+    t.record("1", {4, 6, 2});
+    t.record("0", {3, 2, 1});
+
+    REQUIRE(t.max().variables == 4);
+    REQUIRE(t.max().constraints == 6);
+    REQUIRE(t.mean().variables == 3);
+    REQUIRE(t.mean().cells == 1);
+
+    auto blocks = t.per_block();
+    REQUIRE(blocks.size() == 2);
+    REQUIRE(blocks.at("0").variables == 3);
+    REQUIRE(blocks.at("0").constraints == 2);
+
+    std::ostringstream csv;
+    t.write_csv_summary(csv);
+    REQUIRE(csv.str() == "4,3,6,3,2,1");
+    REQUIRE(state_telemetry::csv_headers().size() == 6);
+
+    std::ostringstream series;
+    t.write_series(series);
+    REQUIRE(series.str() == "step,block,variables,constraints,cells\n0,0,2,1,0\n1,1,4,6,2\n2,0,3,2,1\n");
+}
+
+TEST_CASE( "state telemetry keeps a bounded number of samples", "[telemetry]" ) {
+    state_telemetry t;
+    size_t measured = 0;
+    size_t visits = 4 * state_telemetry::max_samples;
+    for (size_t i = 0; i < visits; i++)
+        t.visit(std::to_string(i % 3), [&] { measured++; return state_size{i, 0, 0}; });
+
+    REQUIRE(t.get_samples().size() <= state_telemetry::max_samples);
+    REQUIRE(measured <= 2 * state_telemetry::max_samples);
+    REQUIRE(t.get_samples().front().step == 0);
+    REQUIRE(t.get_samples().back().step >= visits - visits / state_telemetry::max_samples);
+    REQUIRE(t.max().variables == t.get_samples().back().step);
+    REQUIRE(t.get_engine().empty());
+
+    std::ostringstream csv;
+    state_telemetry::write_csv_unmeasured(csv);
+    REQUIRE(csv.str() == "n/a,n/a,n/a,n/a,n/a,n/a");
+}
@@ -0,0 +1,29 @@
+#include "catch.hpp"
+
+#include <algorithm>
+
+#include "widening_thresholds.hpp"
+
+static bool contains(const std::vector<int64_t>& v, int64_t c) {
+    return std::binary_search(v.begin(), v.end(), c);
+}
+
+TEST_CASE( "widening thresholds", "[thresholds]" ) {
+    Cfg cfg = Cfg::make({
+        {"0", Bin{Bin::Op::MOV, false, Reg{1}, Imm{0}, false}},
+        {"1", Bin{Bin::Op::ADD, false, Reg{1}, Imm{1}, false}},
+        {"2", Jmp{Condition{Condition::Op::LT, Reg{1}, Imm{64}}, "1"}},
+        {"3", Jmp{Condition{Condition::Op::SGT, Reg{1}, Imm{static_cast<uint64_t>(-5)}}, "5"}},
+        {"4", Exit{}},
+        {"5", Exit{}},
+    });
+    program_info info{BpfProgType::XDP, {map_def{0, MapType::ARRAY, 4, 48, 0}}, xdp_md};
+    auto ts = collect_thresholds(cfg, info);
+
+    REQUIRE(std::is_sorted(ts.begin(), ts.end()));
+    REQUIRE(std::adjacent_find(ts.begin(), ts.end()) == ts.end());
+    for (int64_t c : {63, 64, 65, -6, -5, -4, 4, 47, 48, 49, STACK_SIZE, -STACK_SIZE, xdp_md.end})
+        REQUIRE(contains(ts, c));
+    // no bound from the immediate of the increment
+    REQUIRE_FALSE(contains(ts, 2));
+}
@@ -0,0 +1,63 @@
+#include "catch.hpp"
+
+#include <map>
+#include <vector>
+
+#include "wto.hpp"
+
+using Graph = std::map<int, std::vector<int>>;
+
+static Wto<int> make_wto(const Graph& g) {
+    return Wto<int>(0, [&](int n) { return g.count(n) ? g.at(n) : std::vector<int>{}; });
+}
+
+TEST_CASE( "wto", "[wto]" ) {
+    SECTION( "straight line" ) {
+        auto wto = make_wto({{0, {1}}, {1, {2}}});
+        REQUIRE(wto.get_components().size() == 3);
+        REQUIRE(wto.position(0) < wto.position(1));
+        REQUIRE(wto.position(1) < wto.position(2));
+        REQUIRE_FALSE(wto.is_head(1));
+        REQUIRE(wto.nesting(2).empty());
+    }
+
+    SECTION( "diamond" ) {
+        auto wto = make_wto({{0, {1, 2}}, {1, {3}}, {2, {3}}});
+        REQUIRE(wto.get_components().size() == 4);
+        REQUIRE(wto.position(0) < wto.position(1));
+        REQUIRE(wto.position(2) < wto.position(3));
+        REQUIRE(wto.position(1) < wto.position(3));
+    }
+
+    SECTION( "loop" ) {
+        // 0 -> 1 -> 2 -> 1, 2 -> 3
+        auto wto = make_wto({{0, {1}}, {1, {2}}, {2, {1, 3}}});
+        auto const& cs = wto.get_components();
+        REQUIRE(cs.size() == 3);
+        REQUIRE(cs[1].is_cycle);
+        REQUIRE(cs[1].head == 1);
+        REQUIRE(wto.is_head(1));
+        REQUIRE(wto.nesting(2) == std::vector<int>{1});
+        REQUIRE(wto.nesting(1).empty());
+        REQUIRE(wto.nesting(3).empty());
+        REQUIRE(wto.position(2) < wto.position(3));
+    }
+
+    SECTION( "nested loops" ) {
+        // 0 -> 1 -> 2 -> 3 -> 2, 3 -> 1, 1 -> 4
+        auto wto = make_wto({{0, {1}}, {1, {2, 4}}, {2, {3}}, {3, {2, 1}}});
+        REQUIRE(wto.is_head(1));
+        REQUIRE(wto.is_head(2));
+        REQUIRE_FALSE(wto.is_head(3));
+        REQUIRE(wto.nesting(3) == std::vector<int>{1, 2});
+        REQUIRE(wto.nesting(2) == std::vector<int>{1});
+        REQUIRE(wto.nesting(4).empty());
+        REQUIRE(wto.position(3) < wto.position(4));
+    }
+
+    SECTION( "unreachable nodes are not ordered" ) {
+        auto wto = make_wto({{0, {1}}, {5, {1}}});
+        REQUIRE(wto.contains(1));
+        REQUIRE_FALSE(wto.contains(5));
+    }
+}
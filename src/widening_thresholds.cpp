@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <variant>
+
+#include "widening_thresholds.hpp"
+
+using std::vector;
+
+static void add_constant(vector<int64_t>& res, int64_t c)
+{
+    res.push_back(c - 1);
+    res.push_back(c);
+    res.push_back(c + 1);
+}
+
+static void add_condition(vector<int64_t>& res, const Condition& cond)
+{
+    if (std::holds_alternative<Imm>(cond.right))
+        add_constant(res, static_cast<int64_t>(std::get<Imm>(cond.right).v));
+}
+
+vector<int64_t> collect_thresholds(const Cfg& cfg, const program_info& info)
+{
+    vector<int64_t> res;
+    for (const Label& label : cfg.keys()) {
+        for (const Instruction& ins : cfg.at(label).insts) {
+            if (std::holds_alternative<Assume>(ins)) {
+                add_condition(res, std::get<Assume>(ins).cond);
+            } else if (std::holds_alternative<Jmp>(ins)) {
+                auto const& cond = std::get<Jmp>(ins).cond;
+                if (cond)
+                    add_condition(res, *cond);
+            }
+        }
+    }
+
+    add_constant(res, 0);
+    add_constant(res, STACK_SIZE);
+    add_constant(res, -STACK_SIZE);
+    for (const map_def& map : info.map_defs) {
+        add_constant(res, map.key_size);
+        add_constant(res, map.value_size);
+    }
+    const ptype_descr& ctx = info.descriptor;
+    for (int offset : {ctx.size, ctx.data, ctx.end, ctx.meta}) {
+        if (offset >= 0)
+            add_constant(res, offset);
+    }
+
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
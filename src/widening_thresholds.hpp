@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ *  Widening thresholds taken from the constants of an eBPF program.
+ *
+ *  Loop bounds are usually compared against an immediate, or against a size
+ *  the verifier knows: the stack size, the size of a map value or key, the
+ *  offsets of the context descriptor. Widening a bound to the next such
+ *  constant instead of to infinity keeps the bound of a counted loop without
+ *  narrowing. Each constant c also gives c - 1 and c + 1, the bounds of the
+ *  loop counter at the head of loops exiting on c with a strict or non-strict
+ *  comparison.
+ **/
+#include <cstdint>
+#include <vector>
+
+#include "asm_cfg.hpp"
+#include "spec_type_descriptors.hpp"
+
+/** The thresholds of a program, sorted and without duplicates. */
+std::vector<int64_t> collect_thresholds(const Cfg& cfg, const program_info& info);
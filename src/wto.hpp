@@ -0,0 +1,123 @@
+#pragma once
+
+/**
+ *  Weak topological ordering (Bourdoncle, "Efficient chaotic iteration
+ *  strategies with widenings", 1993).
+ *
+ *  A WTO is a sequence of components. A component is either a single vertex
+ *  or a cycle: a head followed by the WTO of the rest of the strongly
+ *  connected subgraph. Iterating the components in order, and each cycle
+ *  until its head stabilizes, is the recursive iteration strategy; the heads
+ *  are where widening is needed.
+ *
+ *  The graph is given by an entry node and a successor function, so the same
+ *  code orders both the eBPF Cfg and Crab's cfg_t.
+ **/
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <map>
+#include <vector>
+
+template <typename Node>
+struct WtoComponent {
+    Node head;
+    bool is_cycle;
+    std::vector<WtoComponent> body;  // empty unless is_cycle
+};
+
+template <typename Node>
+class Wto {
+public:
+    using component_t = WtoComponent<Node>;
+    using successors_t = std::function<std::vector<Node>(const Node&)>;
+
+private:
+    std::vector<component_t> components;
+    std::map<Node, std::vector<Node>> nesting_map;
+    std::map<Node, size_t> position_map;
+    std::map<Node, bool> head_map;
+
+    // construction state
+    successors_t succs;
+    std::map<Node, int> dfn;
+    std::vector<Node> stack;
+    int num = 0;
+
+    std::vector<component_t> component(const Node& v) {
+        std::vector<component_t> partition;
+        for (const Node& w : succs(v)) {
+            if (dfn[w] == 0)
+                visit(w, partition);
+        }
+        std::reverse(partition.begin(), partition.end());
+        return partition;
+    }
+
+    int visit(const Node& v, std::vector<component_t>& partition) {
+        stack.push_back(v);
+        int head = dfn[v] = ++num;
+        bool loop = false;
+        for (const Node& w : succs(v)) {
+            int min = dfn[w] == 0 ? visit(w, partition) : dfn[w];
+            if (min <= head) {
+                head = min;
+                loop = true;
+            }
+        }
+        if (head == dfn[v]) {
+            dfn[v] = INT_MAX;
+            Node element = stack.back();
+            stack.pop_back();
+            if (loop) {
+                while (!(element == v)) {
+                    dfn[element] = 0;
+                    element = stack.back();
+                    stack.pop_back();
+                }
+                partition.push_back(component_t{v, true, component(v)});
+            } else {
+                partition.push_back(component_t{v, false, {}});
+            }
+        }
+        return head;
+    }
+
+    void index(const std::vector<component_t>& partition, std::vector<Node>& heads) {
+        for (const component_t& c : partition) {
+            size_t position = position_map.size();
+            position_map[c.head] = position;
+            nesting_map[c.head] = heads;
+            head_map[c.head] = c.is_cycle;
+            if (c.is_cycle) {
+                heads.push_back(c.head);
+                index(c.body, heads);
+                heads.pop_back();
+            }
+        }
+    }
+
+public:
+    Wto(const Node& entry, successors_t succs) : succs(succs) {
+        visit(entry, components);
+        std::reverse(components.begin(), components.end());
+        std::vector<Node> heads;
+        index(components, heads);
+        this->succs = nullptr;
+        dfn.clear();
+    }
+
+    const std::vector<component_t>& get_components() const { return components; }
+
+    /** The heads of the cycles containing n, outermost first. A head is not
+     *  part of its own nesting.
+     */
+    const std::vector<Node>& nesting(const Node& n) const { return nesting_map.at(n); }
+
+    /** Position of n in the flattened ordering. */
+    size_t position(const Node& n) const { return position_map.at(n); }
+
+    bool contains(const Node& n) const { return position_map.count(n) > 0; }
+
+    bool is_head(const Node& n) const { return head_map.at(n); }
+};